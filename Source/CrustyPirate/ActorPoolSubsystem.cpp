@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActorPoolSubsystem.h"
+#include "PooledActor.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "StatusEffectSubsystem.h"
+
+AActor* UActorPoolSubsystem::Acquire(UClass* ActorClass, const FTransform& Transform)
+{
+	if (!ActorClass)	return nullptr;
+
+	if (FActorPoolBucket* Bucket = Pools.Find(ActorClass))
+	{
+		while (Bucket->Actors.Num() > 0)
+		{
+			AActor* Actor = Bucket->Actors.Pop(EAllowShrinking::No);
+			PooledActors.Remove(Actor);
+			if (!IsValid(Actor))	continue;
+			Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+			Actor->SetActorHiddenInGame(false);
+			Actor->SetActorEnableCollision(true);
+			Cast<IPooledActor>(Actor)->OnAcquiredFromPool();
+			return Actor;
+		}
+	}
+
+	return SpawnActor(ActorClass, Transform);
+}
+
+void UActorPoolSubsystem::Release(AActor* Actor)
+{
+	if (!IsValid(Actor) || IsInPool(Actor))	return;
+
+	IPooledActor* PooledActor = Cast<IPooledActor>(Actor);
+	if (!PooledActor)
+	{
+		Actor->Destroy();
+		return;
+	}
+	PooledActor->OnReleasedToPool();
+	GetWorld()->GetTimerManager().ClearAllTimersForObject(Actor);
+	if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+	{
+		StatusEffects->CancelAll(Actor);
+	}
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Pools.FindOrAdd(Actor->GetClass()).Actors.Add(Actor);
+	PooledActors.Add(Actor);
+}
+
+void UActorPoolSubsystem::Prewarm(UClass* ActorClass, int32 Count)
+{
+	if (!ActorClass || !ActorClass->ImplementsInterface(UPooledActor::StaticClass()))	return;
+
+	TArray<AActor*> Spawned;
+	for (int32 i = GetNumPooled(ActorClass); i < Count; i++)
+	{
+		Spawned.Add(SpawnActor(ActorClass, FTransform(PrewarmLocation)));
+	}
+	for (AActor* Actor : Spawned)
+	{
+		Release(Actor);
+	}
+}
+
+int32 UActorPoolSubsystem::GetNumPooled(UClass* ActorClass) const
+{
+	const FActorPoolBucket* Bucket = Pools.Find(ActorClass);
+	return Bucket ? Bucket->Actors.Num() : 0;
+}
+
+void UActorPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	// Actors spawned from here only get BeginPlay when the world dispatches it after this call, so they
+	// would begin play after being released. From the next tick on, SpawnActor begins play right away.
+	InWorld.GetTimerManager().SetTimerForNextTick(this, &UActorPoolSubsystem::PrewarmFromConfig);
+}
+
+bool UActorPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+AActor* UActorPoolSubsystem::SpawnActor(UClass* ActorClass, const FTransform& Transform)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return GetWorld()->SpawnActor<AActor>(ActorClass, Transform, SpawnParams);
+}
+
+void UActorPoolSubsystem::PrewarmFromConfig()
+{
+	for (const FActorPoolPrewarm& Entry : PrewarmCounts)
+	{
+		Prewarm(Entry.ActorClass.TryLoadClass<AActor>(), Entry.Count);
+	}
+}
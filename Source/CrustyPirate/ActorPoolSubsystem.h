@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ActorPoolSubsystem.generated.h"
+
+USTRUCT()
+struct FActorPoolPrewarm
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FSoftClassPath ActorClass;
+
+	UPROPERTY()
+	int32 Count = 0;
+};
+
+USTRUCT()
+struct FActorPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AActor*> Actors;
+};
+
+/**
+ * Keeps released actors hidden and disabled so they can be reused instead of spawned and destroyed.
+ * Only actors implementing IPooledActor are pooled; anything else is destroyed on release.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	TArray<FActorPoolPrewarm> PrewarmCounts;
+
+	UPROPERTY(Config)
+	FVector PrewarmLocation = FVector(0.0f, 0.0f, -50000.0f);
+
+	UPROPERTY()
+	TMap<UClass*, FActorPoolBucket> Pools;
+
+	// Everything currently parked in one of the buckets.
+	TSet<TObjectKey<AActor>> PooledActors;
+
+	AActor* Acquire(UClass* ActorClass, const FTransform& Transform);
+	// Releasing an actor that is already pooled does nothing.
+	void Release(AActor* Actor);
+	bool IsInPool(const AActor* Actor) const { return PooledActors.Contains(Actor); }
+	void Prewarm(UClass* ActorClass, int32 Count);
+	int32 GetNumPooled(UClass* ActorClass) const;
+
+	template<class T>
+	T* Acquire(TSubclassOf<T> ActorClass, const FTransform& Transform)
+	{
+		return Cast<T>(Acquire(ActorClass.Get(), Transform));
+	}
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	AActor* SpawnActor(UClass* ActorClass, const FTransform& Transform);
+	void PrewarmFromConfig();
+};
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActorPoolSubsystem.h"
+#include "CollectableItem.h"
+#include "PlayerCharacter.h"
+#include "PerfScenarioSubsystem.h"
+#include "CrustyPirateTestWorld.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/UObjectArray.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FActorPoolCollectPickupsTest, "CrustyPirate.Pool.CollectPickups",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FActorPoolCollectPickupsTest::RunTest(const FString& Parameters)
+{
+	FCrustyPirateTestWorld TestWorld;
+	UActorPoolSubsystem* Pool = TestWorld.World->GetSubsystem<UActorPoolSubsystem>();
+	UClass* CollectableClass = GetDefault<UPerfScenarioSubsystem>()->CollectableClass.TryLoadClass<ACollectableItem>();
+	APlayerCharacter* Player = TestWorld.SpawnPlayer(FVector::ZeroVector);
+	if (!TestNotNull(TEXT("Pool"), Pool) || !TestNotNull(TEXT("Collectable class"), CollectableClass) || !TestNotNull(TEXT("Player"), Player))
+	{
+		return false;
+	}
+
+	// Prewarming from config happens on the first tick.
+	TestWorld.Tick(1.0f / 60.0f);
+	int32 MaxPooled = 0;
+	for (const FActorPoolPrewarm& Entry : Pool->PrewarmCounts)
+	{
+		MaxPooled += Entry.Count;
+	}
+
+	// Sweeping through a line of diamonds: every pickup spawned in a frame is collected in the same frame.
+	const int32 NumPickups = 100000;
+	const int32 PickupsPerFrame = 32;
+	TSet<ACollectableItem*> Distinct;
+	TArray<ACollectableItem*> Live;
+	int32 StartObjects = 0;
+	int32 NumTicking = 0;
+	for (int32 Collected = 0, Frame = 0; Collected < NumPickups; Frame++)
+	{
+		Live.Reset();
+		for (int32 i = 0; i < PickupsPerFrame; i++)
+		{
+			ACollectableItem* Item = Pool->Acquire<ACollectableItem>(CollectableClass, FTransform(FVector(100.0f * i, 0.0f, 0.0f)));
+			Distinct.Add(Item);
+			Live.Add(Item);
+		}
+		for (ACollectableItem* Item : Live)
+		{
+			Item->OverlapBegin(Item->CapsuleComp, Player, Player->GetCapsuleComponent(), 0, false, FHitResult());
+			// A second overlap queued in the same frame and a second release must both be ignored.
+			Item->OverlapBegin(Item->CapsuleComp, Player, Player->GetCapsuleComponent(), 0, false, FHitResult());
+			Pool->Release(Item);
+			if (Item->IsActorTickEnabled() || Item->ItemFlipbook->IsComponentTickEnabled())
+			{
+				NumTicking++;
+			}
+		}
+		Collected += Live.Num();
+		TestWorld.Tick(1.0f / 60.0f);
+		// The first frames may grow the pool past the prewarmed count; from then on nothing is created.
+		if (Frame == 1)
+		{
+			StartObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+		}
+	}
+	int32 EndObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	AddInfo(FString::Printf(TEXT("%d pickups through %d actors, %d objects after warm-up, %d at the end"),
+		NumPickups, Distinct.Num(), StartObjects, EndObjects));
+	TestTrue(TEXT("Pool stays bounded"), Distinct.Num() <= FMath::Max(MaxPooled, PickupsPerFrame));
+	TestEqual(TEXT("Every actor is back in the pool"), Pool->GetNumPooled(CollectableClass), Distinct.Num());
+	TestEqual(TEXT("Released pickups do not tick"), NumTicking, 0);
+	TestTrue(TEXT("No objects created after warm-up"), EndObjects <= StartObjects);
+	for (ACollectableItem* Item : Distinct)
+	{
+		if (!TestTrue(TEXT("Pooled pickups are hidden"), Item->IsInPool && Item->IsHidden()))	break;
+	}
+	return true;
+}
+
+#endif
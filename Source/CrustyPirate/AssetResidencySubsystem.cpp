@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AssetResidencySubsystem.h"
+#include "CrustyPirate.h"
+#include "InputReplaySubsystem.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/Texture2D.h"
+#include "Kismet/GameplayStatics.h"
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+#include "PaperZDAnimSequence.h"
+#include "Sound/SoundBase.h"
+
+static FAutoConsoleCommandWithWorld ResidencyStatsCommand(
+	TEXT("CrustyPirate.ResidencyStats"),
+	TEXT("Logs assets and memory kept resident per level and how many first-use hitches were avoided."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UAssetResidencySubsystem* Residency = GameInstance ? GameInstance->GetSubsystem<UAssetResidencySubsystem>() : nullptr)
+		{
+			Residency->LogStats();
+		}
+	}));
+
+void UAssetResidencySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	// Residency changes when assets finish loading, which differs between a recording and its replay.
+	if (UInputReplaySubsystem::IsDeterministicRun())
+	{
+		UseResidencyManager = false;
+	}
+}
+
+void UAssetResidencySubsystem::Deinitialize()
+{
+	// Drops the handles and the full mip force on every texture still held.
+	TArray<int32> LevelIndices;
+	Levels.GetKeys(LevelIndices);
+	for (int32 LevelIndex : LevelIndices)
+	{
+		ReleaseLevel(LevelIndex);
+	}
+	Super::Deinitialize();
+}
+
+void UAssetResidencySubsystem::RequestLevel(int32 LevelIndex)
+{
+	if (!UseResidencyManager || LevelIndex <= 0 || Levels.Contains(LevelIndex))	return;
+
+	// The registry walk can take several milliseconds for a big level, so Tick spreads it over frames.
+	FLevelResidency& Level = Levels.Add(LevelIndex);
+	FName LevelPackage(*FString::Printf(TEXT("/Game/Levels/Level_%d"), LevelIndex));
+	Level.PackagesToVisit.Emplace(LevelPackage, 0);
+	Level.VisitedPackages.Add(LevelPackage);
+	Level.GatherStartTime = FPlatformTime::Seconds();
+	GatheringLevels.Add(LevelIndex);
+}
+
+void UAssetResidencySubsystem::ReleaseLevel(int32 LevelIndex)
+{
+	FLevelResidency Level;
+	if (!Levels.RemoveAndCopyValue(LevelIndex, Level))	return;
+
+	GatheringLevels.Remove(LevelIndex);
+	PendingRequests.RemoveAll([LevelIndex](const TPair<int32, FSoftObjectPath>& Request) { return Request.Key == LevelIndex; });
+	PendingPreparation.RemoveAll([LevelIndex](const TPair<int32, FSoftObjectPath>& Request) { return Request.Key == LevelIndex; });
+	for (TSharedPtr<FStreamableHandle>& Handle : Level.Handles)
+	{
+		Handle->ReleaseHandle();
+	}
+	// Assets shared with a level that stays resident keep their prepared state.
+	TSet<FSoftObjectPath> StillNeeded;
+	TSet<TWeakObjectPtr<UTexture2D>> TexturesStillNeeded;
+	for (const TPair<int32, FLevelResidency>& Other : Levels)
+	{
+		StillNeeded.Append(Other.Value.Assets);
+		TexturesStillNeeded.Append(Other.Value.ForcedTextures);
+	}
+	for (const TWeakObjectPtr<UTexture2D>& Texture : Level.ForcedTextures)
+	{
+		if (Texture.IsValid() && !TexturesStillNeeded.Contains(Texture))
+		{
+			Texture->bForceMiplevelsToBeResident = false;
+		}
+	}
+	for (const FSoftObjectPath& Path : Level.Assets)
+	{
+		if (StillNeeded.Contains(Path))	continue;
+		if (UObject* Asset = Path.ResolveObject())
+		{
+			PreparedAssets.Remove(Asset);
+			UsedAssets.Remove(Asset);
+		}
+	}
+}
+
+void UAssetResidencySubsystem::SetCurrentLevel(int32 LevelIndex)
+{
+	TArray<int32> LevelIndices;
+	Levels.GetKeys(LevelIndices);
+	for (int32 Other : LevelIndices)
+	{
+		if (Other != LevelIndex)
+		{
+			ReleaseLevel(Other);
+		}
+	}
+	RequestLevel(LevelIndex);
+}
+
+void UAssetResidencySubsystem::NoteAssetUse(const UObject* Asset)
+{
+	if (!Asset || !UseResidencyManager)	return;
+	bool IsAlreadyUsed = false;
+	UsedAssets.Add(Asset, &IsAlreadyUsed);
+	if (IsAlreadyUsed)	return;
+	if (PreparedAssets.Contains(Asset))
+	{
+		HitchesAvoided++;
+	}
+	else
+	{
+		HitchesNotAvoided++;
+	}
+}
+
+void UAssetResidencySubsystem::LogStats() const
+{
+	UE_LOG(LogCrustyPirate, Display, TEXT("Asset residency: %d first-use hitches avoided, %d first uses of assets that were not prepared"), HitchesAvoided, HitchesNotAvoided);
+	for (const TPair<int32, FLevelResidency>& Level : Levels)
+	{
+		UE_LOG(LogCrustyPirate, Display, TEXT("  Level_%d: %d/%d assets resident, %.2f MB"),
+			Level.Key, Level.Value.NumResident, Level.Value.Assets.Num(), Level.Value.ResidentBytes / (1024.0 * 1024.0));
+	}
+}
+
+void UAssetResidencySubsystem::Tick(float DeltaTime)
+{
+	double EndTime = FPlatformTime::Seconds() + FrameBudgetMs / 1000.0;
+
+	for (int32 i = 0; i < GatheringLevels.Num() && FPlatformTime::Seconds() < EndTime; i++)
+	{
+		int32 LevelIndex = GatheringLevels[i];
+		FLevelResidency& Level = Levels.FindChecked(LevelIndex);
+		Level.GatherFrames++;
+		bool IsGathering = true;
+		while (IsGathering && FPlatformTime::Seconds() < EndTime)
+		{
+			IsGathering = GatherNextPackage(LevelIndex, Level);
+		}
+		if (IsGathering)	continue;
+
+		UE_LOG(LogCrustyPirate, Log, TEXT("Level_%d residency: %d assets found in %d packages over %d frames (%.2f ms)"), LevelIndex, Level.Assets.Num(),
+			Level.VisitedPackages.Num(), Level.GatherFrames, (FPlatformTime::Seconds() - Level.GatherStartTime) * 1000.0);
+		Level.PackagesToVisit.Empty();
+		Level.VisitedPackages.Empty();
+		GatheringLevels.RemoveAt(i--);
+	}
+
+	int32 NumPrepared = 0;
+	while (NumPrepared < PendingPreparation.Num() && FPlatformTime::Seconds() < EndTime)
+	{
+		const TPair<int32, FSoftObjectPath>& Entry = PendingPreparation[NumPrepared++];
+		if (UObject* Asset = Entry.Value.ResolveObject())
+		{
+			PrepareAsset(Entry.Key, Asset);
+		}
+	}
+	PendingPreparation.RemoveAt(0, NumPrepared, EAllowShrinking::No);
+
+	int32 NumRequested = 0;
+	while (NumRequested < PendingRequests.Num() && FPlatformTime::Seconds() < EndTime)
+	{
+		TPair<int32, FSoftObjectPath> Request = PendingRequests[NumRequested++];
+		FLevelResidency* Level = Levels.Find(Request.Key);
+		if (!Level)	continue;
+		TSharedPtr<FStreamableHandle> Handle = StreamableManager.RequestAsyncLoad(Request.Value,
+			FStreamableDelegate::CreateUObject(this, &UAssetResidencySubsystem::OnAssetLoaded, Request.Key, Request.Value),
+			FStreamableManager::AsyncLoadHighPriority - 1);
+		if (Handle.IsValid())
+		{
+			Level->Handles.Add(Handle);
+		}
+	}
+	PendingRequests.RemoveAt(0, NumRequested, EAllowShrinking::No);
+}
+
+TStatId UAssetResidencySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAssetResidencySubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType UAssetResidencySubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UAssetResidencySubsystem::GatherNextPackage(int32 LevelIndex, FLevelResidency& Level)
+{
+	if (!Level.PackagesToVisit.IsValidIndex(Level.NextPackage))	return false;
+	TPair<FName, int32> Package = Level.PackagesToVisit[Level.NextPackage++];
+	IAssetRegistry& AssetRegistry = FAssetRegistryModule::GetRegistry();
+
+	TArray<FAssetData> PackageAssets;
+	AssetRegistry.GetAssetsByPackageName(Package.Key, PackageAssets, true);
+	for (const FAssetData& Asset : PackageAssets)
+	{
+		if (Asset.IsInstanceOf(UPaperFlipbook::StaticClass()) || Asset.IsInstanceOf(UPaperSprite::StaticClass())
+			|| Asset.IsInstanceOf(UPaperZDAnimSequence::StaticClass()) || Asset.IsInstanceOf(USoundBase::StaticClass()))
+		{
+			Level.Assets.Add(Asset.GetSoftObjectPath());
+			PendingRequests.Emplace(LevelIndex, Asset.GetSoftObjectPath());
+		}
+	}
+
+	if (Package.Value >= MaxDependencyDepth)	return true;
+	TArray<FName> Dependencies;
+	AssetRegistry.GetDependencies(Package.Key, Dependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard);
+	for (FName Dependency : Dependencies)
+	{
+		bool IsAlreadyVisited = false;
+		Level.VisitedPackages.Add(Dependency, &IsAlreadyVisited);
+		if (!IsAlreadyVisited && Dependency.ToString().StartsWith(TEXT("/Game/")))
+		{
+			Level.PackagesToVisit.Emplace(Dependency, Package.Value + 1);
+		}
+	}
+	return true;
+}
+
+void UAssetResidencySubsystem::OnAssetLoaded(int32 LevelIndex, FSoftObjectPath Path)
+{
+	if (!Levels.Contains(LevelIndex))	return;
+	// Preparation can touch audio and texture streaming, so it is spread over frames in Tick.
+	PendingPreparation.Emplace(LevelIndex, Path);
+}
+
+void UAssetResidencySubsystem::PrepareAsset(int32 LevelIndex, UObject* Asset)
+{
+	FLevelResidency* Level = Levels.Find(LevelIndex);
+	if (!Level)	return;
+
+	if (USoundBase* Sound = Cast<USoundBase>(Asset))
+	{
+		UGameplayStatics::PrimeSound(Sound);
+	}
+	else if (UPaperSprite* Sprite = Cast<UPaperSprite>(Asset))
+	{
+		// Kept at full mip until ReleaseLevel, unlike a timed force that can run out while the level is still played.
+		if (UTexture2D* Texture = Sprite->GetBakedTexture())
+		{
+			Texture->bForceMiplevelsToBeResident = true;
+			Level->ForcedTextures.AddUnique(Texture);
+		}
+	}
+	Level->NumResident++;
+	Level->ResidentBytes += Asset->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	PreparedAssets.Add(Asset);
+}
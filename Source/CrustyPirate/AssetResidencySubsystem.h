@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "Engine/StreamableManager.h"
+#include "AssetResidencySubsystem.generated.h"
+
+class UTexture2D;
+
+struct FLevelResidency
+{
+	TArray<FSoftObjectPath> Assets;
+	TArray<TSharedPtr<FStreamableHandle>> Handles;
+	TArray<TWeakObjectPtr<UTexture2D>> ForcedTextures;
+	int32 NumResident = 0;
+	int64 ResidentBytes = 0;
+
+	// Breadth-first walk of the level's package dependencies, advanced in Tick.
+	TArray<TPair<FName, int32>> PackagesToVisit;
+	TSet<FName> VisitedPackages;
+	int32 NextPackage = 0;
+	double GatherStartTime = 0.0;
+	int32 GatherFrames = 0;
+};
+
+/**
+ * Finds the flipbooks, sprites, PaperZD anim sequences and sounds each Level_N depends on (through the
+ * asset registry), streams them in ahead of use and prepares them (sounds primed, sprite textures kept
+ * at full mip while the level is resident), spending at most FrameBudgetMs of game thread time per frame,
+ * the registry walk included. Assets of a level are released again when it is left.
+ * "CrustyPirate.ResidencyStats" logs resident assets and memory per level and first-use hitches avoided.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UAssetResidencySubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	bool UseResidencyManager = true;
+
+	UPROPERTY(Config)
+	float FrameBudgetMs = 1.0f;
+
+	// How many package dependency levels to follow from the map (map -> Blueprint -> flipbook -> sprite).
+	UPROPERTY(Config)
+	int32 MaxDependencyDepth = 4;
+
+	UPROPERTY()
+	TSet<UObject*> PreparedAssets;
+
+	FStreamableManager StreamableManager;
+	TMap<int32, FLevelResidency> Levels;
+	TArray<int32> GatheringLevels;
+	TArray<TPair<int32, FSoftObjectPath>> PendingRequests;
+	TArray<TPair<int32, FSoftObjectPath>> PendingPreparation;
+	TSet<const UObject*> UsedAssets;
+	int32 HitchesAvoided = 0;
+	int32 HitchesNotAvoided = 0;
+
+	void RequestLevel(int32 LevelIndex);
+	void ReleaseLevel(int32 LevelIndex);
+	// Releases every other level and makes sure this one is requested.
+	void SetCurrentLevel(int32 LevelIndex);
+	// Called right before an asset is played or shown for the first time.
+	void NoteAssetUse(const UObject* Asset);
+	void LogStats() const;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return GatheringLevels.Num() > 0 || PendingRequests.Num() > 0 || PendingPreparation.Num() > 0; }
+
+protected:
+	// Visits the next package of the level's dependency walk; returns false once the walk is done.
+	bool GatherNextPackage(int32 LevelIndex, FLevelResidency& Level);
+	void OnAssetLoaded(int32 LevelIndex, FSoftObjectPath Path);
+	void PrepareAsset(int32 LevelIndex, UObject* Asset);
+};
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Formats "<prefix>{0}" style texts for small non-negative integers once and hands back the cached
+ * FText afterwards, so repeated HP/diamond/level updates do not rebuild strings.
+ */
+struct FCachedNumberText
+{
+	FTextFormat Format;
+	TArray<FText> Cache;
+	int32 MaxCachedValue;
+
+	FCachedNumberText(const TCHAR* Pattern, int32 InMaxCachedValue = 512)
+		: Format(FTextFormat::FromString(Pattern))
+		, MaxCachedValue(InMaxCachedValue)
+	{
+	}
+
+	FText Get(int32 Value)
+	{
+		if (Value < 0 || Value >= MaxCachedValue)
+		{
+			return FormatValue(Value);
+		}
+		if (Cache.Num() <= Value)
+		{
+			Cache.SetNum(Value + 1);
+		}
+		if (Cache[Value].IsEmpty())
+		{
+			Cache[Value] = FormatValue(Value);
+		}
+		return Cache[Value];
+	}
+
+	FText FormatValue(int32 Value) const
+	{
+		return FText::Format(Format, FText::AsNumber(Value, &FNumberFormattingOptions::DefaultNoGrouping()));
+	}
+};
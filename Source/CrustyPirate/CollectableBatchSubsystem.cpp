@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CollectableBatchSubsystem.h"
+#include "CollectableItem.h"
+#include "CrustyPirate.h"
+#include "CrustyPiratePerf.h"
+#include "PaperSprite.h"
+
+static FAutoConsoleCommandWithWorld CollectableBatchStatsCommand(
+	TEXT("CrustyPirate.CollectableBatchStats"),
+	TEXT("Logs the collectable draw calls with batching against the per-item flipbook draws it replaces."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UCollectableBatchSubsystem* Batching = World ? World->GetSubsystem<UCollectableBatchSubsystem>() : nullptr)
+		{
+			Batching->LogDrawStats();
+		}
+	}));
+
+bool UCollectableSpriteBatchComponent::SetInstanceSprite(int32 InstanceIndex, UPaperSprite* Sprite)
+{
+	if (!PerInstanceSpriteData.IsValidIndex(InstanceIndex))	return false;
+	FSpriteInstanceData& InstanceData = PerInstanceSpriteData[InstanceIndex];
+	if (InstanceData.SourceSprite == Sprite)	return false;
+	InstanceData.SourceSprite = Sprite;
+	return true;
+}
+
+void UCollectableBatchSubsystem::RegisterItem(ACollectableItem* Item)
+{
+	UPaperFlipbook* Flipbook = Item->ItemFlipbook->GetFlipbook();
+	if (!UseBatchedRendering || !Flipbook || Item->BatchIndex != INDEX_NONE)	return;
+
+	int32 BatchIndex = FindOrAddBatch(Flipbook);
+	FCollectableBatch& Batch = Batches[BatchIndex];
+	FTransform Transform = Item->ItemFlipbook->GetComponentTransform();
+	// The offset is snapped to a whole key frame so the batch only changes when its shared frame does.
+	int32 FrameOffset = GetFrameAtTime(Flipbook, Item->AnimationTimeOffset);
+	int32 Slot;
+	if (Batch.FreeSlots.Num() > 0)
+	{
+		Slot = Batch.FreeSlots.Pop(EAllowShrinking::No);
+		Batch.Items[Slot] = Item;
+		Batch.FrameOffsets[Slot] = FrameOffset;
+		Batch.Component->SetInstanceSprite(Slot, Flipbook->GetSpriteAtFrame(GetInstanceFrame(Batch, Slot)));
+		Batch.Component->UpdateInstanceTransform(Slot, Transform, true, true);
+	}
+	else
+	{
+		Slot = Batch.Items.Add(Item);
+		Batch.FrameOffsets.Add(FrameOffset);
+		Batch.Component->AddInstance(Transform, Flipbook->GetSpriteAtFrame(GetInstanceFrame(Batch, Slot)), true, Item->ItemFlipbook->GetSpriteColor());
+	}
+	Item->BatchIndex = BatchIndex;
+	Item->BatchSlot = Slot;
+	Item->ItemFlipbook->SetVisibility(false);
+	Item->ItemFlipbook->SetComponentTickEnabled(false);
+	CRUSTYPIRATE_INC_COUNTER(BatchedCollectables);
+}
+
+void UCollectableBatchSubsystem::UnregisterItem(ACollectableItem* Item)
+{
+	if (!Batches.IsValidIndex(Item->BatchIndex))	return;
+
+	FCollectableBatch& Batch = Batches[Item->BatchIndex];
+	int32 Slot = Item->BatchSlot;
+	if (Batch.Items.IsValidIndex(Slot) && Batch.Items[Slot] == Item)
+	{
+		// Instances are hidden rather than removed so the remaining slots keep their indices.
+		FTransform Hidden = Item->ItemFlipbook->GetComponentTransform();
+		Hidden.SetScale3D(FVector::ZeroVector);
+		Batch.Component->UpdateInstanceTransform(Slot, Hidden, true, true);
+		Batch.Items[Slot] = nullptr;
+		Batch.FreeSlots.Add(Slot);
+		CRUSTYPIRATE_DEC_COUNTER(BatchedCollectables);
+	}
+	Item->BatchIndex = INDEX_NONE;
+	Item->BatchSlot = INDEX_NONE;
+	Item->ItemFlipbook->SetVisibility(true);
+}
+
+void UCollectableBatchSubsystem::Deinitialize()
+{
+	CRUSTYPIRATE_SET_COUNTER(BatchedCollectables, 0);
+	CRUSTYPIRATE_SET_COUNTER(BatchComponents, 0);
+	Super::Deinitialize();
+}
+
+void UCollectableBatchSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	AnimationTime += DeltaTime;
+	for (FCollectableBatch& Batch : Batches)
+	{
+		int32 BaseFrame = GetFrameAtTime(Batch.Flipbook, AnimationTime);
+		if (BaseFrame == Batch.BaseFrame)	continue;
+
+		Batch.BaseFrame = BaseFrame;
+		bool Changed = false;
+		for (int32 Slot = 0; Slot < Batch.Items.Num(); Slot++)
+		{
+			if (!Batch.Items[Slot])	continue;
+			Changed |= Batch.Component->SetInstanceSprite(Slot, Batch.Flipbook->GetSpriteAtFrame(GetInstanceFrame(Batch, Slot)));
+		}
+		if (Changed)
+		{
+			Batch.Component->MarkRenderStateDirty();
+			CRUSTYPIRATE_INC_COUNTER(BatchRebuilds);
+		}
+	}
+}
+
+void UCollectableBatchSubsystem::LogDrawStats() const
+{
+	int32 BatchDraws = 0;
+	int32 ItemDraws = 0;
+	for (const FCollectableBatch& Batch : Batches)
+	{
+		int32 LiveItems = Batch.Items.Num() - Batch.FreeSlots.Num();
+		if (LiveItems > 0)	BatchDraws++;
+		ItemDraws += LiveItems;
+		UE_LOG(LogCrustyPirate, Log, TEXT("Collectable batch %s: %d items in 1 draw"), *GetNameSafe(Batch.Flipbook), LiveItems);
+	}
+	UE_LOG(LogCrustyPirate, Log, TEXT("Collectable draws: %d batched, %d without batching"), BatchDraws, ItemDraws);
+}
+
+TStatId UCollectableBatchSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCollectableBatchSubsystem, STATGROUP_Tickables);
+}
+
+bool UCollectableBatchSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+#if UE_SERVER
+	return false;
+#else
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+#endif
+}
+
+int32 UCollectableBatchSubsystem::FindOrAddBatch(UPaperFlipbook* Flipbook)
+{
+	for (int32 i = 0; i < Batches.Num(); i++)
+	{
+		if (Batches[i].Flipbook == Flipbook)	return i;
+	}
+
+	if (!BatchActor)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Name = TEXT("CollectableBatchActor");
+		BatchActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	}
+	UCollectableSpriteBatchComponent* Component = NewObject<UCollectableSpriteBatchComponent>(BatchActor);
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetGenerateOverlapEvents(false);
+	if (!BatchActor->GetRootComponent())
+	{
+		BatchActor->SetRootComponent(Component);
+	}
+	else
+	{
+		Component->SetupAttachment(BatchActor->GetRootComponent());
+	}
+	Component->RegisterComponent();
+
+	FCollectableBatch Batch;
+	Batch.Flipbook = Flipbook;
+	Batch.Component = Component;
+	Batch.BaseFrame = GetFrameAtTime(Flipbook, AnimationTime);
+	CRUSTYPIRATE_INC_COUNTER(BatchComponents);
+	return Batches.Add(Batch);
+}
+
+int32 UCollectableBatchSubsystem::GetFrameAtTime(const UPaperFlipbook* Flipbook, float Time) const
+{
+	float Duration = Flipbook->GetTotalDuration();
+	return Flipbook->GetKeyFrameIndexAtTime(Duration > 0.0f ? FMath::Fmod(Time, Duration) : 0.0f, true);
+}
+
+int32 UCollectableBatchSubsystem::GetInstanceFrame(const FCollectableBatch& Batch, int32 Slot) const
+{
+	int32 NumFrames = Batch.Flipbook->GetNumKeyFrames();
+	return NumFrames > 0 ? (Batch.BaseFrame + Batch.FrameOffsets[Slot]) % NumFrames : 0;
+}
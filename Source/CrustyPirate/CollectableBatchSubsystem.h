@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PaperGroupedSpriteComponent.h"
+#include "PaperFlipbook.h"
+#include "CollectableBatchSubsystem.generated.h"
+
+class ACollectableItem;
+
+/**
+ * Grouped sprite component that lets the batch swap an instance's sprite when its flipbook frame changes.
+ */
+UCLASS()
+class CRUSTYPIRATE_API UCollectableSpriteBatchComponent : public UPaperGroupedSpriteComponent
+{
+	GENERATED_BODY()
+
+public:
+	bool SetInstanceSprite(int32 InstanceIndex, UPaperSprite* Sprite);
+};
+
+USTRUCT()
+struct FCollectableBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UPaperFlipbook* Flipbook = nullptr;
+
+	UPROPERTY()
+	UCollectableSpriteBatchComponent* Component = nullptr;
+
+	UPROPERTY()
+	TArray<ACollectableItem*> Items;
+
+	// Key frame each instance is shifted by; all instances step on the batch's shared frame.
+	TArray<int32> FrameOffsets;
+	TArray<int32> FreeSlots;
+	int32 BaseFrame = 0;
+};
+
+/**
+ * Draws every collectable that shares a flipbook as instances of one grouped sprite component,
+ * replacing the per-item flipbook component draw and tick.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UCollectableBatchSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	bool UseBatchedRendering = true;
+
+	UPROPERTY()
+	AActor* BatchActor;
+
+	UPROPERTY()
+	TArray<FCollectableBatch> Batches;
+
+	float AnimationTime = 0.0f;
+
+	void RegisterItem(ACollectableItem* Item);
+	void UnregisterItem(ACollectableItem* Item);
+	void LogDrawStats() const;
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	int32 FindOrAddBatch(UPaperFlipbook* Flipbook);
+	int32 GetFrameAtTime(const UPaperFlipbook* Flipbook, float Time) const;
+	int32 GetInstanceFrame(const FCollectableBatch& Batch, int32 Slot) const;
+};
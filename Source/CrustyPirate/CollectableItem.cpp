@@ -1,35 +1,142 @@
 
 
 #include "CollectableItem.h"
+#include "CrustyPirate.h"
 #include "PlayerCharacter.h"
+#include "ActorPoolSubsystem.h"
+#include "CollectableBatchSubsystem.h"
+#include "CrustyPiratePerf.h"
+#include "ProgressSaveSubsystem.h"
+#include "LevelChunkSubsystem.h"
+#include "GameplayEventBus.h"
 
 ACollectableItem::ACollectableItem()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
+	// Items never move, so they only send anything when picked up or reused from the pool.
+	bReplicates = true;
+	NetDormancy = DORM_Initial;
 	CapsuleComp = CreateDefaultSubobject<UCapsuleComponent>(TEXT("CapsuleComp"));
 	SetRootComponent(CapsuleComp);
 	ItemFlipbook = CreateDefaultSubobject<UPaperFlipbookComponent>(TEXT("ItemFlipbook"));
 	ItemFlipbook->SetupAttachment(RootComponent);
+#if UE_SERVER
+	ItemFlipbook->PrimaryComponentTick.bCanEverTick = false;
+#endif
 }
 
 void ACollectableItem::BeginPlay()
 {
 	Super::BeginPlay();
-	CapsuleComp->OnComponentBeginOverlap.AddDynamic(this, &ACollectableItem::OverlapBegin);
+	CRUSTYPIRATE_ADD_DYNAMIC(CapsuleComp->OnComponentBeginOverlap, this, &ACollectableItem::OverlapBegin);
+	RegisterWithSubsystems();
+	UProgressSaveSubsystem* Save = GetGameInstance()->GetSubsystem<UProgressSaveSubsystem>();
+	if (HasAuthority() && Save && Save->IsItemCollected(this))
+	{
+		RemoveFromLevel();
+	}
 }
 
-void ACollectableItem::Tick(float DeltaTime)
+void ACollectableItem::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (IsInPool)
+	{
+		CRUSTYPIRATE_DEC_COUNTER(PooledCollectables);
+	}
+	else
+	{
+		UnregisterFromSubsystems();
+	}
+	Super::EndPlay(EndPlayReason);
+}
 
+void ACollectableItem::OnAcquiredFromPool()
+{
+	IsInPool = false;
+	CRUSTYPIRATE_DEC_COUNTER(PooledCollectables);
+	FlushNetDormancy();
+	ItemFlipbook->PlayFromStart();
+	RegisterWithSubsystems();
+}
+
+void ACollectableItem::OnReleasedToPool()
+{
+	// Registering on acquire applies the significance tier, which turns the flipbook tick back on.
+	ItemFlipbook->Stop();
+	ItemFlipbook->SetComponentTickEnabled(false);
+	FlushNetDormancy();
+	UnregisterFromSubsystems();
+	IsInPool = true;
+	CRUSTYPIRATE_INC_COUNTER(PooledCollectables);
+}
+
+void ACollectableItem::RegisterWithSubsystems()
+{
+	CRUSTYPIRATE_INC_COUNTER(ActiveCollectables);
+	if (USignificanceSubsystem* Significance = GetWorld()->GetSubsystem<USignificanceSubsystem>())
+	{
+		Significance->RegisterActor(this);
+	}
+	if (UCollectableBatchSubsystem* Batching = GetWorld()->GetSubsystem<UCollectableBatchSubsystem>())
+	{
+		Batching->RegisterItem(this);
+	}
+}
+
+void ACollectableItem::UnregisterFromSubsystems()
+{
+	CRUSTYPIRATE_DEC_COUNTER(ActiveCollectables);
+	if (USignificanceSubsystem* Significance = GetWorld()->GetSubsystem<USignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	if (UCollectableBatchSubsystem* Batching = GetWorld()->GetSubsystem<UCollectableBatchSubsystem>())
+	{
+		Batching->UnregisterItem(this);
+	}
+}
+
+void ACollectableItem::SetSignificanceTier(ESignificanceTier Tier, float TickInterval)
+{
+	if (BatchIndex != INDEX_NONE)	return;
+	ItemFlipbook->SetComponentTickEnabled(Tier != ESignificanceTier::Dormant);
+	ItemFlipbook->SetComponentTickInterval(TickInterval);
 }
 
 void ACollectableItem::OverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	// A pooled item can still see an overlap that was queued in the frame it was released.
+	if (!HasAuthority() || IsInPool)	return;
 	APlayerCharacter* Player = Cast<APlayerCharacter>(OtherActor);
 	if (Player && Player->IsAlive)
 	{
 		Player->CollectItem(Type);
+		UGameplayEventBus::PublishEvent(this, EGameplayEventType::ItemCollected, Player, this, 1, (uint8)Type);
+		// Streamed items are saved under the name of the record they were spawned for.
+		ULevelChunkSubsystem* LevelChunks = GetWorld()->GetSubsystem<ULevelChunkSubsystem>();
+		if (!LevelChunks || !LevelChunks->MarkActorGone(this))
+		{
+			if (UProgressSaveSubsystem* Save = GetGameInstance()->GetSubsystem<UProgressSaveSubsystem>())
+			{
+				Save->MarkItemCollected(this);
+			}
+		}
+		RemoveFromLevel();
+	}
+}
+
+void ACollectableItem::RemoveFromLevel()
+{
+	if (ULevelChunkSubsystem* LevelChunks = GetWorld()->GetSubsystem<ULevelChunkSubsystem>())
+	{
+		LevelChunks->MarkActorGone(this);
+	}
+	if (UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>())
+	{
+		Pool->Release(this);
+	}
+	else
+	{
 		Destroy();
 	}
 }
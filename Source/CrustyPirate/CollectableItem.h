@@ -6,6 +6,8 @@
 #include "GameFramework/Actor.h"
 #include "Components/CapsuleComponent.h"
 #include "PaperFlipbookComponent.h"
+#include "SignificanceSubsystem.h"
+#include "PooledActor.h"
 #include "CollectableItem.generated.h"
 
 UENUM(BlueprintType)
@@ -18,7 +20,7 @@ enum class CollectableType : uint8
 
 
 UCLASS()
-class CRUSTYPIRATE_API ACollectableItem : public AActor
+class CRUSTYPIRATE_API ACollectableItem : public AActor, public IPooledActor
 {
 	GENERATED_BODY()
 	
@@ -32,11 +34,30 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	CollectableType Type;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float AnimationTimeOffset = 0.0f;
+
+	bool IsInPool = false;
+	int32 BatchIndex = INDEX_NONE;
+	int32 BatchSlot = INDEX_NONE;
+
 	ACollectableItem();
 
 	virtual void BeginPlay() override;
 
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void OnAcquiredFromPool() override;
+
+	virtual void OnReleasedToPool() override;
+
+	void RegisterWithSubsystems();
+
+	void UnregisterFromSubsystems();
+
+	void RemoveFromLevel();
+
+	void SetSignificanceTier(ESignificanceTier Tier, float TickInterval);
 
 	UFUNCTION()
 	void OverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
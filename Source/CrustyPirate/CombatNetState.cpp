@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatNetState.h"
+
+void FCombatNetState::Set(int NewHitPoints, bool IsAlive, bool IsStunned, bool IsAttacking)
+{
+	HitPoints = (uint16)FMath::Clamp(NewHitPoints, 0, (int)MAX_uint16);
+	Flags = 0;
+	if (IsAlive)
+	{
+		Flags |= Flag_Alive;
+	}
+	if (IsStunned)
+	{
+		Flags |= Flag_Stunned;
+	}
+	if (IsAttacking)
+	{
+		Flags |= Flag_Attacking;
+	}
+}
+
+bool FCombatNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 PackedHitPoints = HitPoints;
+	Ar.SerializeIntPacked(PackedHitPoints);
+	Ar.SerializeBits(&Flags, NumFlagBits);
+	Ar.SerializeBits(&HitCount, NumHitCountBits);
+	if (Ar.IsLoading())
+	{
+		HitPoints = (uint16)FMath::Min<uint32>(PackedHitPoints, MAX_uint16);
+	}
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
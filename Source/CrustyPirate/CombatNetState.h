@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CombatNetState.generated.h"
+
+/**
+ * Combat state the server replicates in place of the individual UPROPERTYs. HP goes out as a packed
+ * int, the flags and the hit counter as a few bits, so a change costs two or three bytes and an
+ * unchanged state costs nothing.
+ */
+USTRUCT()
+struct CRUSTYPIRATE_API FCombatNetState
+{
+	GENERATED_BODY()
+
+	enum : uint8
+	{
+		Flag_Alive = 1 << 0,
+		Flag_Stunned = 1 << 1,
+		Flag_Attacking = 1 << 2,
+		NumFlagBits = 3,
+		NumHitCountBits = 4
+	};
+
+	UPROPERTY()
+	uint16 HitPoints = 0;
+
+	UPROPERTY()
+	uint8 Flags = Flag_Alive;
+
+	// Bumped on every hit so clients replay the hit reaction even when two hits leave the same HP.
+	UPROPERTY()
+	uint8 HitCount = 0;
+
+	bool HasFlag(uint8 Flag) const { return (Flags & Flag) != 0; }
+	void Set(int NewHitPoints, bool IsAlive, bool IsStunned, bool IsAttacking);
+	void NoteHit() { HitCount = (HitCount + 1) & ((1 << NumHitCountBits) - 1); }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FCombatNetState& Other) const
+	{
+		return HitPoints == Other.HitPoints && Flags == Other.Flags && HitCount == Other.HitCount;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FCombatNetState> : public TStructOpsTypeTraitsBase2<FCombatNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatQueueSubsystem.h"
+#include "Combatant.h"
+#include "CrustyPiratePerf.h"
+#include "Async/ParallelFor.h"
+#include "Components/PrimitiveComponent.h"
+
+void UCombatQueueSubsystem::QueueDamage(AActor* Instigator, AActor* Target, int Damage, float StunDuration, uint32 SwingId)
+{
+	ICombatant* Combatant = Cast<ICombatant>(Target);
+	if (!Combatant)	return;
+	if (!IsHitPlausible(Instigator, Target))
+	{
+		RejectedHits++;
+		return;
+	}
+
+	bool IsAlreadyHit = false;
+	SwingHits.Add(FCombatHitKey{ Instigator, Target, SwingId }, &IsAlreadyHit);
+	if (IsAlreadyHit)	return;
+
+	if (!UseCombatQueue)
+	{
+		if (Combatant->CanReceiveDamage())
+		{
+			Combatant->ApplyDamageResult(FMath::Max(Combatant->GetCombatHitPoints() - Damage, 0), StunDuration);
+		}
+		return;
+	}
+
+	int32& Slot = TargetSlots.FindOrAdd(Target, INDEX_NONE);
+	if (Slot == INDEX_NONE)
+	{
+		Slot = Targets.AddDefaulted();
+		Targets[Slot].Actor = Target;
+	}
+	FCombatEvent& Event = PendingEvents.AddDefaulted_GetRef();
+	Event.TargetSlot = Slot;
+	Event.Damage = Damage;
+	Event.StunDuration = StunDuration;
+	Targets[Slot].Events.Add(PendingEvents.Num() - 1);
+}
+
+bool UCombatQueueSubsystem::IsHitPlausible(const AActor* Instigator, const AActor* Target) const
+{
+	if (!Instigator || !Target || !Instigator->HasAuthority())	return false;
+	const ICombatant* Attacker = Cast<ICombatant>(Instigator);
+	if (!Attacker || Attacker->GetCombatHitPoints() <= 0)	return false;
+	const UPrimitiveComponent* AttackBox = Attacker->GetAttackBox();
+	if (!AttackBox)	return true;
+	if (AttackBox->GetCollisionEnabled() == ECollisionEnabled::NoCollision)	return false;
+
+	// Overlaps come from the server's own physics; this catches the ones that went stale before they
+	// were queued, like a target that was corrected or teleported away after the sweep.
+	FVector TargetOrigin;
+	FVector TargetExtent;
+	Target->GetActorBounds(true, TargetOrigin, TargetExtent);
+	FVector Gap = (AttackBox->Bounds.Origin - TargetOrigin).GetAbs() - AttackBox->Bounds.BoxExtent - TargetExtent;
+	return Gap.X <= MaxHitSlack && Gap.Z <= MaxHitSlack;
+}
+
+void UCombatQueueSubsystem::EndSwing(const AActor* Instigator)
+{
+	for (auto It = SwingHits.CreateIterator(); It; ++It)
+	{
+		if (It->Instigator == Instigator)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UCombatQueueSubsystem::ResolvePendingEvents()
+{
+	if (PendingEvents.Num() == 0)	return;
+	CRUSTYPIRATE_SCOPE(CombatResolve);
+
+	for (FCombatTarget& Target : Targets)
+	{
+		ICombatant* Combatant = Cast<ICombatant>(Target.Actor.Get());
+		Target.CanReceiveDamage = Combatant && Combatant->CanReceiveDamage();
+		Target.IsInvulnerableAfterHit = Combatant && Combatant->IsInvulnerableAfterHit();
+		Target.HitPoints = Combatant ? Combatant->GetCombatHitPoints() : 0;
+	}
+
+	ResolveTargets();
+
+	for (FCombatTarget& Target : Targets)
+	{
+		if (!Target.IsHit)	continue;
+		if (ICombatant* Combatant = Cast<ICombatant>(Target.Actor.Get()))
+		{
+			Combatant->ApplyDamageResult(Target.HitPoints, Target.StunDuration);
+		}
+	}
+
+	PendingEvents.Reset();
+	Targets.Reset();
+	TargetSlots.Reset();
+}
+
+void UCombatQueueSubsystem::ResolveTargets()
+{
+	ParallelFor(Targets.Num(), [this](int32 Index)
+	{
+		ResolveTarget(Targets[Index], PendingEvents);
+	}, Targets.Num() < ParallelResolveThreshold ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void UCombatQueueSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	ResolvePendingEvents();
+}
+
+TStatId UCombatQueueSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatQueueSubsystem, STATGROUP_Tickables);
+}
+
+bool UCombatQueueSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatQueueSubsystem::ResolveTarget(FCombatTarget& Target, const TArray<FCombatEvent>& Events)
+{
+	// Same rules as applying every hit through TakeDamage in order: each hit restarts the stun,
+	// HP is clamped at zero and hits after death or after a hit that granted invulnerability are ignored.
+	bool CanReceiveDamage = Target.CanReceiveDamage;
+	for (int32 EventIndex : Target.Events)
+	{
+		if (!CanReceiveDamage)	break;
+		const FCombatEvent& Event = Events[EventIndex];
+		Target.HitPoints = FMath::Max(Target.HitPoints - Event.Damage, 0);
+		Target.StunDuration = Event.StunDuration;
+		Target.IsHit = true;
+		CanReceiveDamage = Target.HitPoints > 0 && !Target.IsInvulnerableAfterHit;
+	}
+}
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatQueueSubsystem.generated.h"
+
+class ICombatant;
+
+struct FCombatHitKey
+{
+	const AActor* Instigator = nullptr;
+	const AActor* Target = nullptr;
+	uint32 SwingId = 0;
+
+	bool operator==(const FCombatHitKey& Other) const
+	{
+		return Instigator == Other.Instigator && Target == Other.Target && SwingId == Other.SwingId;
+	}
+
+	friend uint32 GetTypeHash(const FCombatHitKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.Instigator), GetTypeHash(Key.Target)), GetTypeHash(Key.SwingId));
+	}
+};
+
+struct FCombatEvent
+{
+	int32 TargetSlot = INDEX_NONE;
+	int Damage = 0;
+	float StunDuration = 0.0f;
+};
+
+struct FCombatTarget
+{
+	TWeakObjectPtr<AActor> Actor;
+	int HitPoints = 0;
+	bool CanReceiveDamage = false;
+	bool IsInvulnerableAfterHit = false;
+	bool IsHit = false;
+	float StunDuration = 0.0f;
+	TArray<int32, TInlineAllocator<4>> Events;
+};
+
+/**
+ * Collects the damage dealt by attack box overlaps during the frame and resolves it in one pass:
+ * repeated overlaps from the same swing are dropped, the HP math runs per target (in parallel for
+ * big fights) and the side effects are applied afterwards on the game thread.
+ * Results match calling TakeDamage for every hit in order. Hits are only accepted where the world
+ * has authority and are checked against the instigator's attack box first.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UCombatQueueSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	bool UseCombatQueue = true;
+
+	// Below this many targets in a frame the HP math stays on the game thread.
+	UPROPERTY(Config)
+	int32 ParallelResolveThreshold = 64;
+
+	// How far outside the instigator's attack box a target may be and still be hit, to allow for the
+	// movement between the overlap and the check.
+	UPROPERTY(Config)
+	float MaxHitSlack = 64.0f;
+
+	uint32 RejectedHits = 0;
+
+	TArray<FCombatEvent> PendingEvents;
+	TArray<FCombatTarget> Targets;
+	TMap<const AActor*, int32> TargetSlots;
+	TSet<FCombatHitKey> SwingHits;
+
+	void QueueDamage(AActor* Instigator, AActor* Target, int Damage, float StunDuration, uint32 SwingId);
+	bool IsHitPlausible(const AActor* Instigator, const AActor* Target) const;
+	void EndSwing(const AActor* Instigator);
+	void ResolvePendingEvents();
+	// Runs the HP math for the gathered Targets without touching the actors.
+	void ResolveTargets();
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	static void ResolveTarget(FCombatTarget& Target, const TArray<FCombatEvent>& Events);
+};
@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatQueueSubsystem.h"
+#include "Enemy.h"
+#include "PlayerCharacter.h"
+#include "CrustyPirateTestWorld.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Two identical actors: one takes every hit through its own TakeDamage in order, the other through the queue.
+template<class T>
+struct TCombatTwins
+{
+	T* Direct = nullptr;
+	T* Queued = nullptr;
+	TArray<int> Damages;
+};
+
+struct FCombatQueueTestWorld : public FCrustyPirateTestWorld
+{
+	UCombatQueueSubsystem* Queue = nullptr;
+	AEnemy* Instigator = nullptr;
+	uint32 NextSwingId = 1;
+	float NextX = 0.0f;
+
+	FCombatQueueTestWorld()
+	{
+		Queue = World->GetSubsystem<UCombatQueueSubsystem>();
+		// The instigator only has to pass the plausibility check; it never overlaps anything itself.
+		Instigator = SpawnEnemy(FVector(-100000.0f, 0.0f, 0.0f));
+		if (Queue && Instigator)
+		{
+			Queue->UseCombatQueue = true;
+			Queue->MaxHitSlack = 1.0e7f;
+			Instigator->AttackCollisionBox->SetGenerateOverlapEvents(false);
+			Instigator->AttackCollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+		}
+	}
+
+	FVector NextLocation()
+	{
+		NextX += 1000.0f;
+		return FVector(NextX, 0.0f, 0.0f);
+	}
+
+	template<class T>
+	void Hit(TCombatTwins<T>& Twins)
+	{
+		for (int32 i = 0; i < Twins.Damages.Num(); i++)
+		{
+			float StunDuration = 0.1f * (i + 1);
+			Twins.Direct->TakeDamage(Twins.Damages[i], StunDuration);
+			// Every hit comes from a different swing, so none of them are dropped as repeats.
+			Queue->QueueDamage(Instigator, Twins.Queued, Twins.Damages[i], StunDuration, NextSwingId++);
+		}
+	}
+};
+
+static void CheckTwins(FAutomationTestBase& Test, const TCombatTwins<AEnemy>& Twins, const FString& What)
+{
+	Test.TestEqual(What + TEXT(" HP"), Twins.Queued->HitPoints, Twins.Direct->HitPoints);
+	Test.TestEqual(What + TEXT(" alive"), Twins.Queued->IsAlive, Twins.Direct->IsAlive);
+	Test.TestEqual(What + TEXT(" stunned"), Twins.Queued->IsStunned, Twins.Direct->IsStunned);
+	Test.TestEqual(What + TEXT(" can move"), Twins.Queued->CanMove, Twins.Direct->CanMove);
+}
+
+static void CheckTwins(FAutomationTestBase& Test, const TCombatTwins<APlayerCharacter>& Twins, const FString& What)
+{
+	Test.TestEqual(What + TEXT(" HP"), Twins.Queued->HitPoints, Twins.Direct->HitPoints);
+	Test.TestEqual(What + TEXT(" alive"), Twins.Queued->IsAlive, Twins.Direct->IsAlive);
+	Test.TestEqual(What + TEXT(" stunned"), Twins.Queued->IsStunned, Twins.Direct->IsStunned);
+	Test.TestEqual(What + TEXT(" invulnerable"), Twins.Queued->IsInvulnerable, Twins.Direct->IsInvulnerable);
+	Test.TestEqual(What + TEXT(" can move"), Twins.Queued->CanMove, Twins.Direct->CanMove);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCombatQueueMatchesTakeDamageTest, "CrustyPirate.Combat.QueueMatchesTakeDamage",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCombatQueueMatchesTakeDamageTest::RunTest(const FString& Parameters)
+{
+	FCombatQueueTestWorld TestWorld;
+	if (!TestNotNull(TEXT("Queue"), TestWorld.Queue) || !TestNotNull(TEXT("Instigator"), TestWorld.Instigator))	return false;
+
+	auto AddEnemies = [&TestWorld](int HitPoints, bool IsAlive, const TArray<int>& Damages)
+	{
+		TCombatTwins<AEnemy> Twins;
+		Twins.Direct = TestWorld.SpawnEnemy(TestWorld.NextLocation());
+		Twins.Queued = TestWorld.SpawnEnemy(TestWorld.NextLocation());
+		Twins.Damages = Damages;
+		for (AEnemy* Enemy : { Twins.Direct, Twins.Queued })
+		{
+			Enemy->UpdateHP(HitPoints);
+			Enemy->IsAlive = IsAlive;
+		}
+		return Twins;
+	};
+	auto AddPlayers = [&TestWorld](int HitPoints, bool IsActive, float InvulnerabilityDuration, const TArray<int>& Damages)
+	{
+		TCombatTwins<APlayerCharacter> Twins;
+		Twins.Direct = TestWorld.SpawnPlayer(TestWorld.NextLocation(), false);
+		Twins.Queued = TestWorld.SpawnPlayer(TestWorld.NextLocation(), false);
+		Twins.Damages = Damages;
+		for (APlayerCharacter* Player : { Twins.Direct, Twins.Queued })
+		{
+			Player->HitPoints = HitPoints;
+			Player->IsActive = IsActive;
+			Player->InvulnerabilityDuration = InvulnerabilityDuration;
+		}
+		return Twins;
+	};
+
+	TArray<TCombatTwins<AEnemy>> Enemies;
+	Enemies.Add(AddEnemies(100, true, { 25 }));
+	Enemies.Add(AddEnemies(100, true, { 25, 25, 25 }));
+	Enemies.Add(AddEnemies(40, true, { 25, 25, 25 }));
+	Enemies.Add(AddEnemies(100, false, { 25 }));
+	Enemies.Add(AddEnemies(10, true, {}));
+	TArray<TCombatTwins<APlayerCharacter>> Players;
+	Players.Add(AddPlayers(100, true, 0.0f, { 25, 25 }));
+	Players.Add(AddPlayers(100, true, 1.0f, { 25, 25, 25 }));
+	Players.Add(AddPlayers(20, true, 1.0f, { 25, 25 }));
+	Players.Add(AddPlayers(30, true, 0.0f, { 25, 25, 25 }));
+	Players.Add(AddPlayers(100, false, 0.0f, { 25 }));
+	for (const TCombatTwins<AEnemy>& Twins : Enemies)
+	{
+		if (!TestTrue(TEXT("Spawned enemies"), Twins.Direct && Twins.Queued))	return false;
+	}
+	for (const TCombatTwins<APlayerCharacter>& Twins : Players)
+	{
+		if (!TestTrue(TEXT("Spawned players"), Twins.Direct && Twins.Queued))	return false;
+	}
+
+	for (TCombatTwins<AEnemy>& Twins : Enemies)
+	{
+		TestWorld.Hit(Twins);
+	}
+	for (TCombatTwins<APlayerCharacter>& Twins : Players)
+	{
+		TestWorld.Hit(Twins);
+	}
+	TestWorld.Queue->ResolvePendingEvents();
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		CheckTwins(*this, Enemies[i], FString::Printf(TEXT("Enemy %d"), i));
+	}
+	for (int32 i = 0; i < Players.Num(); i++)
+	{
+		CheckTwins(*this, Players[i], FString::Printf(TEXT("Player %d"), i));
+	}
+
+	// Enough targets to take the ParallelFor path; every target gets a different mix of hits.
+	TestWorld.Queue->ParallelResolveThreshold = 1;
+	Enemies.Reset();
+	for (int32 i = 0; i < 128; i++)
+	{
+		TArray<int> Damages;
+		for (int32 Hit = 0; Hit < i % 5; Hit++)
+		{
+			Damages.Add(10 + (i * 7 + Hit * 13) % 40);
+		}
+		Enemies.Add(AddEnemies(30 + i % 90, i % 7 != 0, Damages));
+		TestWorld.Hit(Enemies.Last());
+	}
+	TestWorld.Queue->ResolvePendingEvents();
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		CheckTwins(*this, Enemies[i], FString::Printf(TEXT("Parallel enemy %d"), i));
+	}
+
+	return !HasAnyErrors();
+}
+
+#endif
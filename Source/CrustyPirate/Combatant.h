@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Combatant.generated.h"
+
+class UPrimitiveComponent;
+
+UINTERFACE(MinimalAPI)
+class UCombatant : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Actors that can be hit through UCombatQueueSubsystem. The queue does the HP math and hands back
+ * the result; the actor applies its own side effects (HUD/HP text, animation, stun).
+ */
+class CRUSTYPIRATE_API ICombatant
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool CanReceiveDamage() const { return false; }
+	// True when surviving a hit makes the actor ignore further hits for a while.
+	virtual bool IsInvulnerableAfterHit() const { return false; }
+	virtual int GetCombatHitPoints() const { return 0; }
+	virtual void ApplyDamageResult(int NewHitPoints, float StunDuration) {}
+	// The box the server checks hits from this actor against.
+	virtual const UPrimitiveComponent* GetAttackBox() const { return nullptr; }
+};
@@ -3,4 +3,6 @@
 #include "CrustyPirate.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogCrustyPirate);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, CrustyPirate, "CrustyPirate" );
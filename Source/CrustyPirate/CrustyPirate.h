@@ -4,3 +4,13 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogCrustyPirate, Log, All);
+
+// AddDynamic builds the bound function's FName on every call; this builds it once per call site.
+// The delegate is still bound on every call, once per instance.
+#define CRUSTYPIRATE_ADD_DYNAMIC(Delegate, UserObject, FuncName) \
+	do \
+	{ \
+		static const FName BoundFunctionName = STATIC_FUNCTION_FNAME(TEXT(#FuncName)); \
+		(Delegate).__Internal_AddDynamic(UserObject, FuncName, BoundFunctionName); \
+	} while (0)
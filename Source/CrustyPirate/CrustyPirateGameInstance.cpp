@@ -2,8 +2,35 @@
 
 
 #include "CrustyPirateGameInstance.h"
+#include "CrustyPirate.h"
 #include "Kismet/GameplayStatics.h"
+#include "GameFramework/PlayerStart.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/HUD.h"
+#include "GameFramework/Info.h"
+#include "Camera/PlayerCameraManager.h"
+#include "PlayerCharacter.h"
+#include "PooledActor.h"
+#include "ActorPoolSubsystem.h"
+#include "LevelChunkSubsystem.h"
+#include "ProgressSaveSubsystem.h"
+#include "AssetResidencySubsystem.h"
+#include "InputReplaySubsystem.h"
+#include "GameplayEventBus.h"
+#include "Misc/App.h"
 
+void UCrustyPirateGameInstance::Init()
+{
+	Super::Init();
+	FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UCrustyPirateGameInstance::OnPostLoadMap);
+}
+
+void UCrustyPirateGameInstance::Shutdown()
+{
+	FCoreUObjectDelegates::PostLoadMapWithWorld.RemoveAll(this);
+	StopPreloadFrameTimer();
+	Super::Shutdown();
+}
 
 void UCrustyPirateGameInstance::SetPlayerHP(int NewHP)
 {
@@ -15,19 +42,238 @@ void UCrustyPirateGameInstance::AddDiamond(int Amount)
 	CollectedDiamondCount += Amount;
 }
 
+void UCrustyPirateGameInstance::PreloadLevel(int LevelIndex)
+{
+	if (!UseStreamingTransitions || LevelIndex <= 0)	return;
+	// Whether the preload is ready by the exit depends on load times, so recordings and replays always open the level.
+	if (UInputReplaySubsystem::IsDeterministicRun())	return;
+	// Streamed transitions only move the local player; network games travel instead.
+	if (GetWorld()->GetNetMode() != NM_Standalone)	return;
+	if (PreloadedLevel && PreloadedLevelIndex == LevelIndex)	return;
+
+	if (UAssetResidencySubsystem* Residency = GetSubsystem<UAssetResidencySubsystem>())
+	{
+		Residency->RequestLevel(LevelIndex);
+	}
+	StreamedLevelCount++;
+	FString PackageName = FString::Printf(TEXT("/Game/Levels/Level_%d"), LevelIndex);
+	FString InstanceName = FString::Printf(TEXT("Level_%d_Stream%d"), LevelIndex, StreamedLevelCount);
+	FLoadLevelInstanceParams Params(GetWorld(), PackageName, FTransform(StreamingLevelOffset * StreamedLevelCount));
+	Params.OptionalLevelNameOverride = &InstanceName;
+	bool Success = false;
+	ULevelStreamingDynamic* StreamingLevel = ULevelStreamingDynamic::LoadLevelInstance(Params, Success);
+	if (!Success || !StreamingLevel)	return;
+
+	if (PreloadedLevel)
+	{
+		PreloadedLevel->SetIsRequestingUnloadAndRemoval(true);
+	}
+	if (UProgressSaveSubsystem* Save = GetSubsystem<UProgressSaveSubsystem>())
+	{
+		Save->RegisterLevelPackage(StreamingLevel->GetWorldAssetPackageFName(), LevelIndex);
+	}
+	PreloadedLevel = StreamingLevel;
+	PreloadedLevelIndex = LevelIndex;
+	PreloadStartTime = FPlatformTime::Seconds();
+	PreloadLoadTimeMs = 0.0f;
+	PreloadedLevel->OnLevelShown.AddDynamic(this, &UCrustyPirateGameInstance::OnPreloadedLevelLoaded);
+
+	// Making the level visible runs AddToWorld on the game thread in the middle of play, so that is
+	// where the streaming hitch is. Track the longest frame until the level is shown.
+	StopPreloadFrameTimer();
+	PreloadMaxFrameMs = 0.0f;
+	IsPreloadShown = false;
+	LastPreloadFrameTime = PreloadStartTime;
+	PreloadFrameTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UCrustyPirateGameInstance::TickPreloadFrame));
+}
+
+void UCrustyPirateGameInstance::OnPreloadedLevelLoaded()
+{
+	PreloadLoadTimeMs = (FPlatformTime::Seconds() - PreloadStartTime) * 1000.0;
+	IsPreloadShown = true;
+	UE_LOG(LogCrustyPirate, Log, TEXT("Level_%d streamed in after %.1f ms"), PreloadedLevelIndex, PreloadLoadTimeMs);
+}
+
+bool UCrustyPirateGameInstance::TickPreloadFrame(float DeltaTime)
+{
+	double Now = FPlatformTime::Seconds();
+	float FrameMs = FMath::Max(Now - LastPreloadFrameTime - FApp::GetIdleTime(), 0.0) * 1000.0;
+	LastPreloadFrameTime = Now;
+	PreloadMaxFrameMs = FMath::Max(PreloadMaxFrameMs, FrameMs);
+	// The frame that showed the level has just ended.
+	if (!IsPreloadShown)	return true;
+	PreloadFrameTicker.Reset();
+	UE_LOG(LogCrustyPirate, Log, TEXT("Level_%d added to the world, longest frame while streaming %.1f ms"), PreloadedLevelIndex, PreloadMaxFrameMs);
+	return false;
+}
+
+void UCrustyPirateGameInstance::StopPreloadFrameTimer()
+{
+	if (PreloadFrameTicker.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(PreloadFrameTicker);
+		PreloadFrameTicker.Reset();
+	}
+}
+
 void UCrustyPirateGameInstance::ChangeLevel(int LevelIndex)
 {
 	if (LevelIndex <= 0)	return;
 	CurrentLevelIndex = LevelIndex;
+	UGameplayEventBus* EventBus = GetSubsystem<UGameplayEventBus>();
+	if (EventBus && EventBus->HasListeners(EGameplayEventType::LevelChanged))
+	{
+		FGameplayEvent Event;
+		Event.Type = EGameplayEventType::LevelChanged;
+		Event.Value = LevelIndex;
+		Event.LevelIndex = LevelIndex;
+		Event.Time = FPlatformTime::Seconds();
+		EventBus->Publish(Event);
+	}
+	if (UProgressSaveSubsystem* Save = GetSubsystem<UProgressSaveSubsystem>())
+	{
+		Save->SaveProgress();
+	}
+	ENetMode NetMode = GetWorld()->GetNetMode();
+	if (NetMode == NM_DedicatedServer || NetMode == NM_ListenServer)
+	{
+		// Connected clients follow the server to the new map.
+		FString TravelURL = FString::Printf(TEXT("/Game/Levels/Level_%d"), LevelIndex);
+		if (NetMode == NM_ListenServer)
+		{
+			TravelURL += TEXT("?listen");
+		}
+		GetWorld()->ServerTravel(TravelURL);
+		return;
+	}
+	if (PreloadedLevel && PreloadedLevelIndex == LevelIndex && ActivatePreloadedLevel())
+	{
+		return;
+	}
+
+	// Streaming objects belong to the world we are about to leave.
+	StopPreloadFrameTimer();
+	PreloadedLevel = NULL;
+	CurrentStreamedLevel = NULL;
+	PreloadedLevelIndex = 0;
+	OpenLevelStartTime = FPlatformTime::Seconds();
 	FString LevelNameString = FString::Printf(TEXT("Level_%d"), LevelIndex);
 	UGameplayStatics::OpenLevel(GetWorld(), FName(LevelNameString));
 }
 
+bool UCrustyPirateGameInstance::ActivatePreloadedLevel()
+{
+	ULevel* LoadedLevel = PreloadedLevel->GetLoadedLevel();
+	if (!LoadedLevel || !PreloadedLevel->IsLevelVisible())	return false;
+
+	APlayerStart* PlayerStart = NULL;
+	for (AActor* Actor : LoadedLevel->Actors)
+	{
+		PlayerStart = Cast<APlayerStart>(Actor);
+		if (PlayerStart)	break;
+	}
+	APlayerCharacter* Player = Cast<APlayerCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
+	if (!PlayerStart || !Player)	return false;
+
+	double StartTime = FPlatformTime::Seconds();
+	RetireCurrentLevel();
+	Player->TeleportTo(PlayerStart->GetActorLocation(), Player->GetActorRotation());
+	Player->Activate();
+
+	CurrentStreamedLevel = PreloadedLevel;
+	PreloadedLevel = NULL;
+	PreloadedLevelIndex = 0;
+	if (UAssetResidencySubsystem* Residency = GetSubsystem<UAssetResidencySubsystem>())
+	{
+		Residency->SetCurrentLevel(CurrentLevelIndex);
+	}
+	RecordTransition(CurrentLevelIndex, true, PreloadLoadTimeMs, (FPlatformTime::Seconds() - StartTime) * 1000.0, PreloadMaxFrameMs);
+	return true;
+}
+
+void UCrustyPirateGameInstance::RetireCurrentLevel()
+{
+	if (CurrentStreamedLevel)
+	{
+		CurrentStreamedLevel->SetIsRequestingUnloadAndRemoval(true);
+		CurrentStreamedLevel = NULL;
+		return;
+	}
+
+	// The persistent level cannot be unloaded, so park its gameplay actors instead.
+	if (ULevelChunkSubsystem* LevelChunks = GetWorld()->GetSubsystem<ULevelChunkSubsystem>())
+	{
+		LevelChunks->Retire();
+	}
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+	ULevel* PersistentLevel = GetWorld()->PersistentLevel;
+	TArray<AActor*> LevelActors = PersistentLevel->Actors;
+	for (AActor* Actor : LevelActors)
+	{
+		if (!IsValid(Actor))	continue;
+		if (Actor->IsA<AController>() || Actor->IsA<AInfo>() || Actor->IsA<AHUD>() || Actor->IsA<APlayerCameraManager>())	continue;
+		if (Actor->IsA<APlayerCharacter>())	continue;
+		// Parked actors live in the persistent level too.
+		if (Pool && Pool->IsInPool(Actor))	continue;
+		if (Pool && Cast<IPooledActor>(Actor))
+		{
+			Pool->Release(Actor);
+			continue;
+		}
+		Actor->SetActorHiddenInGame(true);
+		Actor->SetActorEnableCollision(false);
+		Actor->SetActorTickEnabled(false);
+	}
+}
+
+void UCrustyPirateGameInstance::OnPostLoadMap(UWorld* LoadedWorld)
+{
+	if (!HasCheckedSavedLevel)
+	{
+		HasCheckedSavedLevel = true;
+		UProgressSaveSubsystem* Save = GetSubsystem<UProgressSaveSubsystem>();
+		int MapLevelIndex = UProgressSaveSubsystem::GetLevelIndexFromMapName(LoadedWorld->GetMapName());
+		if (Save && Save->HasLoadedSave && MapLevelIndex > 0 && MapLevelIndex != CurrentLevelIndex && LoadedWorld->WorldType == EWorldType::Game)
+		{
+			// Continue from the level the save was taken in.
+			ChangeLevel(CurrentLevelIndex);
+			return;
+		}
+	}
+	if (UAssetResidencySubsystem* Residency = GetSubsystem<UAssetResidencySubsystem>())
+	{
+		Residency->SetCurrentLevel(UProgressSaveSubsystem::GetLevelIndexFromMapName(LoadedWorld->GetMapName()));
+	}
+	if (OpenLevelStartTime <= 0.0)	return;
+	float LoadTimeMs = (FPlatformTime::Seconds() - OpenLevelStartTime) * 1000.0;
+	OpenLevelStartTime = 0.0;
+	// OpenLevel blocks the game thread for the whole load, so the hitch is the load itself.
+	RecordTransition(CurrentLevelIndex, false, LoadTimeMs, LoadTimeMs, 0.0f);
+}
+
+void UCrustyPirateGameInstance::RecordTransition(int LevelIndex, bool WasStreamed, float LoadTimeMs, float HitchMs, float StreamingHitchMs)
+{
+	FLevelTransitionStats Stats;
+	Stats.LevelIndex = LevelIndex;
+	Stats.WasStreamed = WasStreamed;
+	Stats.LoadTimeMs = LoadTimeMs;
+	Stats.HitchMs = HitchMs;
+	Stats.StreamingHitchMs = StreamingHitchMs;
+	Stats.PeakUsedPhysicalBytes = FPlatformMemory::GetStats().PeakUsedPhysical;
+	TransitionStats.Add(Stats);
+	UE_LOG(LogCrustyPirate, Log, TEXT("Level_%d transition (%s): load %.1f ms, hitch %.1f ms, longest streaming frame %.1f ms, peak memory %.1f MB"),
+		LevelIndex, WasStreamed ? TEXT("streamed") : TEXT("OpenLevel"), LoadTimeMs, HitchMs, StreamingHitchMs, Stats.PeakUsedPhysicalBytes / (1024.0 * 1024.0));
+}
+
 void UCrustyPirateGameInstance::RestartGame()
 {
 	PlayerHP = 100;
 	CollectedDiamondCount = 0;
 	IsDoubleJumpUnlocked = false;
 	CurrentLevelIndex = 1;
+	if (UProgressSaveSubsystem* Save = GetSubsystem<UProgressSaveSubsystem>())
+	{
+		Save->ResetProgress();
+	}
 	ChangeLevel(CurrentLevelIndex);
-}
\ No newline at end of file
+}
@@ -4,8 +4,36 @@
 
 #include "CoreMinimal.h"
 #include "Engine/GameInstance.h"
+#include "Engine/LevelStreamingDynamic.h"
+#include "Containers/Ticker.h"
 #include "CrustyPirateGameInstance.generated.h"
 
+USTRUCT(BlueprintType)
+struct FLevelTransitionStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int LevelIndex = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool WasStreamed = false;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float LoadTimeMs = 0.0f;
+
+	// Retiring the old level and moving the player.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float HitchMs = 0.0f;
+
+	// Longest game thread frame while the streamed level was loaded and added to the world.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float StreamingHitchMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int64 PeakUsedPhysicalBytes = 0;
+};
+
 /**
  * 
  */
@@ -27,10 +55,51 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	int CurrentLevelIndex = 1;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool UseStreamingTransitions = true;
+
+	// Streamed levels are placed this far apart so they never overlap the level being played.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector StreamingLevelOffset = FVector(100000.0f, 0.0f, 0.0f);
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	TArray<FLevelTransitionStats> TransitionStats;
+
+	UPROPERTY()
+	ULevelStreamingDynamic* PreloadedLevel;
+
+	UPROPERTY()
+	ULevelStreamingDynamic* CurrentStreamedLevel;
+
+	int PreloadedLevelIndex = 0;
+	int StreamedLevelCount = 0;
+	double PreloadStartTime = 0.0;
+	float PreloadLoadTimeMs = 0.0f;
+	float PreloadMaxFrameMs = 0.0f;
+	double LastPreloadFrameTime = 0.0;
+	bool IsPreloadShown = false;
+	FTSTicker::FDelegateHandle PreloadFrameTicker;
+	double OpenLevelStartTime = 0.0;
+	bool HasCheckedSavedLevel = false;
+
+	virtual void Init() override;
+	virtual void Shutdown() override;
+
 	void SetPlayerHP(int NewHP);
 	void AddDiamond(int Amount);
 
+	void PreloadLevel(int LevelIndex);
 	void ChangeLevel(int LevelIndex);
 	UFUNCTION(BlueprintCallable)
 	void RestartGame();
+
+	UFUNCTION()
+	void OnPreloadedLevelLoaded();
+	bool TickPreloadFrame(float DeltaTime);
+	void StopPreloadFrameTimer();
+
+	bool ActivatePreloadedLevel();
+	void RetireCurrentLevel();
+	void OnPostLoadMap(UWorld* LoadedWorld);
+	void RecordTransition(int LevelIndex, bool WasStreamed, float LoadTimeMs, float HitchMs, float StreamingHitchMs);
 };
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CrustyPiratePerf.h"
+#include "CrustyPirate.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_STAT(STAT_CP_EnemyUpdate);
+DEFINE_STAT(STAT_CP_ShouldMoveToTarget);
+DEFINE_STAT(STAT_CP_EnemyTakeDamage);
+DEFINE_STAT(STAT_CP_PlayerTakeDamage);
+DEFINE_STAT(STAT_CP_EnemyStun);
+DEFINE_STAT(STAT_CP_PlayerStun);
+DEFINE_STAT(STAT_CP_EnemyAttackOverlap);
+DEFINE_STAT(STAT_CP_PlayerAttackOverlap);
+DEFINE_STAT(STAT_CP_CollectItem);
+DEFINE_STAT(STAT_CP_HUDUpdate);
+DEFINE_STAT(STAT_CP_CombatResolve);
+DEFINE_STAT(STAT_CP_ChunkStreaming);
+DEFINE_STAT(STAT_CP_EnemyAnimation);
+DEFINE_STAT(STAT_CP_LiveEnemies);
+DEFINE_STAT(STAT_CP_ActiveCollectables);
+DEFINE_STAT(STAT_CP_PooledCollectables);
+DEFINE_STAT(STAT_CP_TimersSet);
+DEFINE_STAT(STAT_CP_LoadedChunks);
+DEFINE_STAT(STAT_CP_ResidentChunkActors);
+DEFINE_STAT(STAT_CP_ActiveVoices);
+DEFINE_STAT(STAT_CP_SoundRequests);
+DEFINE_STAT(STAT_CP_CoalescedSounds);
+DEFINE_STAT(STAT_CP_CappedSounds);
+DEFINE_STAT(STAT_CP_BatchedCollectables);
+DEFINE_STAT(STAT_CP_BatchComponents);
+DEFINE_STAT(STAT_CP_BatchRebuilds);
+
+uint64 FCrustyPiratePerf::ScopeCycles[(int32)ECrustyPirateScope::Count] = {};
+uint32 FCrustyPiratePerf::ScopeCalls[(int32)ECrustyPirateScope::Count] = {};
+int32 FCrustyPiratePerf::Counters[(int32)ECrustyPirateCounter::Count] = {};
+
+static const TCHAR* ScopeNames[] = {
+	TEXT("EnemyUpdate"), TEXT("ShouldMoveToTarget"), TEXT("EnemyTakeDamage"), TEXT("PlayerTakeDamage"), TEXT("EnemyStun"),
+	TEXT("PlayerStun"), TEXT("EnemyAttackOverlap"), TEXT("PlayerAttackOverlap"), TEXT("CollectItem"), TEXT("HUDUpdate"),
+	TEXT("CombatResolve"), TEXT("ChunkStreaming"),
+	TEXT("EnemyAnimation")
+};
+static_assert(UE_ARRAY_COUNT(ScopeNames) == (int32)ECrustyPirateScope::Count, "ScopeNames out of sync with ECrustyPirateScope");
+
+static const TCHAR* CounterNames[] = {
+	TEXT("LiveEnemies"), TEXT("ActiveCollectables"), TEXT("PooledCollectables"), TEXT("TimersSet"), TEXT("LoadedChunks"),
+	TEXT("ResidentChunkActors"), TEXT("ActiveVoices"), TEXT("SoundRequests"), TEXT("CoalescedSounds"), TEXT("CappedSounds"),
+	TEXT("BatchedCollectables"), TEXT("BatchComponents"), TEXT("BatchRebuilds")
+};
+static_assert(UE_ARRAY_COUNT(CounterNames) == (int32)ECrustyPirateCounter::Count, "CounterNames out of sync with ECrustyPirateCounter");
+
+static int32 CaptureFramesLeft = 0;
+static TArray<FString> CaptureRows;
+static FDelegateHandle EndFrameHandle;
+
+static FAutoConsoleCommand PerfCsvCommand(
+	TEXT("CrustyPirate.PerfCsv"),
+	TEXT("Captures the CrustyPirate gameplay scopes and counters for N frames (default 300) and writes them to Saved/Profiling/CrustyPirate as CSV."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FCrustyPiratePerf::StartCapture(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 300);
+	}));
+
+void FCrustyPiratePerf::StartCapture(int32 NumFrames)
+{
+	if (NumFrames <= 0)	return;
+
+	FString Header = TEXT("Frame");
+	for (const TCHAR* Name : ScopeNames)
+	{
+		Header += FString::Printf(TEXT(",%sMs,%sCalls"), Name, Name);
+	}
+	for (const TCHAR* Name : CounterNames)
+	{
+		Header += FString::Printf(TEXT(",%s"), Name);
+	}
+	CaptureRows.Reset(NumFrames + 1);
+	CaptureRows.Add(Header);
+	CaptureFramesLeft = NumFrames;
+	FMemory::Memzero(ScopeCycles);
+	FMemory::Memzero(ScopeCalls);
+	Counters[(int32)ECrustyPirateCounter::TimersSet] = 0;
+	Counters[(int32)ECrustyPirateCounter::BatchRebuilds] = 0;
+	if (!EndFrameHandle.IsValid())
+	{
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FCrustyPiratePerf::EndFrame);
+	}
+}
+
+void FCrustyPiratePerf::EndFrame()
+{
+	FString Row = FString::Printf(TEXT("%d"), CaptureRows.Num() - 1);
+	for (int32 i = 0; i < (int32)ECrustyPirateScope::Count; i++)
+	{
+		Row += FString::Printf(TEXT(",%.4f,%u"), FPlatformTime::ToMilliseconds64(ScopeCycles[i]), ScopeCalls[i]);
+	}
+	for (int32 i = 0; i < (int32)ECrustyPirateCounter::Count; i++)
+	{
+		Row += FString::Printf(TEXT(",%d"), Counters[i]);
+	}
+	CaptureRows.Add(Row);
+
+	FMemory::Memzero(ScopeCycles);
+	FMemory::Memzero(ScopeCalls);
+	Counters[(int32)ECrustyPirateCounter::TimersSet] = 0;
+	Counters[(int32)ECrustyPirateCounter::BatchRebuilds] = 0;
+
+	if (--CaptureFramesLeft <= 0)
+	{
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		EndFrameHandle.Reset();
+		WriteCapture();
+	}
+}
+
+void FCrustyPiratePerf::WriteCapture()
+{
+	FString FileName = FString::Printf(TEXT("CrustyPiratePerf-%s.csv"), *FDateTime::Now().ToString());
+	FString FilePath = FPaths::ProfilingDir() / TEXT("CrustyPirate") / FileName;
+	if (FFileHelper::SaveStringArrayToFile(CaptureRows, *FilePath))
+	{
+		UE_LOG(LogCrustyPirate, Display, TEXT("Wrote %d frames of gameplay stats to %s"), CaptureRows.Num() - 1, *FilePath);
+	}
+	CaptureRows.Empty();
+}
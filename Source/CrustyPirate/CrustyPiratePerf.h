@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Gameplay instrumentation is on in every non-Shipping build.
+#ifndef CRUSTYPIRATE_PERF_STATS
+#define CRUSTYPIRATE_PERF_STATS (!UE_BUILD_SHIPPING)
+#endif
+
+enum class ECrustyPirateScope : uint8
+{
+	EnemyUpdate,
+	ShouldMoveToTarget,
+	EnemyTakeDamage,
+	PlayerTakeDamage,
+	EnemyStun,
+	PlayerStun,
+	EnemyAttackOverlap,
+	PlayerAttackOverlap,
+	CollectItem,
+	HUDUpdate,
+	CombatResolve,
+	ChunkStreaming,
+	EnemyAnimation,
+	Count
+};
+
+enum class ECrustyPirateCounter : uint8
+{
+	LiveEnemies,
+	ActiveCollectables,
+	PooledCollectables,
+	TimersSet,
+	LoadedChunks,
+	ResidentChunkActors,
+	ActiveVoices,
+	SoundRequests,
+	CoalescedSounds,
+	CappedSounds,
+	BatchedCollectables,
+	BatchComponents,
+	BatchRebuilds,
+	Count
+};
+
+DECLARE_STATS_GROUP(TEXT("CrustyPirate"), STATGROUP_CrustyPirate, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy Update"), STAT_CP_EnemyUpdate, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy ShouldMoveToTarget"), STAT_CP_ShouldMoveToTarget, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy TakeDamage"), STAT_CP_EnemyTakeDamage, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Player TakeDamage"), STAT_CP_PlayerTakeDamage, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy Stun"), STAT_CP_EnemyStun, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Player Stun"), STAT_CP_PlayerStun, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy AttackBoxOverlapBegin"), STAT_CP_EnemyAttackOverlap, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Player AttackBoxOverlapBegin"), STAT_CP_PlayerAttackOverlap, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Player CollectItem"), STAT_CP_CollectItem, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("HUD Update"), STAT_CP_HUDUpdate, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Combat Resolve"), STAT_CP_CombatResolve, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Chunk Streaming"), STAT_CP_ChunkStreaming, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy Animation"), STAT_CP_EnemyAnimation, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Enemies"), STAT_CP_LiveEnemies, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Collectables"), STAT_CP_ActiveCollectables, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Pooled Collectables"), STAT_CP_PooledCollectables, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Timers Set"), STAT_CP_TimersSet, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Loaded Chunks"), STAT_CP_LoadedChunks, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Resident Chunk Actors"), STAT_CP_ResidentChunkActors, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Voices"), STAT_CP_ActiveVoices, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Sound Requests"), STAT_CP_SoundRequests, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Coalesced Sounds"), STAT_CP_CoalescedSounds, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Capped Sounds"), STAT_CP_CappedSounds, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Batched Collectables"), STAT_CP_BatchedCollectables, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Batch Components"), STAT_CP_BatchComponents, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Batch Rebuilds"), STAT_CP_BatchRebuilds, STATGROUP_CrustyPirate, CRUSTYPIRATE_API);
+
+/**
+ * Mirrors the STATGROUP_CrustyPirate scopes and counters so they can be captured over a number of
+ * frames and written out as CSV with "CrustyPirate.PerfCsv <Frames>".
+ */
+struct CRUSTYPIRATE_API FCrustyPiratePerf
+{
+	static uint64 ScopeCycles[(int32)ECrustyPirateScope::Count];
+	static uint32 ScopeCalls[(int32)ECrustyPirateScope::Count];
+	static int32 Counters[(int32)ECrustyPirateCounter::Count];
+
+	static void StartCapture(int32 NumFrames);
+	static void EndFrame();
+	static void WriteCapture();
+};
+
+struct FCrustyPiratePerfScope
+{
+	ECrustyPirateScope Scope;
+	uint64 StartCycles;
+
+	FCrustyPiratePerfScope(ECrustyPirateScope InScope)
+		: Scope(InScope), StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~FCrustyPiratePerfScope()
+	{
+		FCrustyPiratePerf::ScopeCycles[(int32)Scope] += FPlatformTime::Cycles64() - StartCycles;
+		FCrustyPiratePerf::ScopeCalls[(int32)Scope]++;
+	}
+};
+
+#if CRUSTYPIRATE_PERF_STATS
+#define CRUSTYPIRATE_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_CP_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(CrustyPirate_##Name); \
+	FCrustyPiratePerfScope ANONYMOUS_VARIABLE(CrustyPiratePerfScope_)(ECrustyPirateScope::Name)
+// The counter macros expand to one statement so they are safe as the body of an unbraced if.
+#define CRUSTYPIRATE_SET_COUNTER(Name, Value) \
+	do { const int32 CounterValue = (Value); SET_DWORD_STAT(STAT_CP_##Name, CounterValue); FCrustyPiratePerf::Counters[(int32)ECrustyPirateCounter::Name] = CounterValue; } while (0)
+#define CRUSTYPIRATE_INC_COUNTER(Name) \
+	do { INC_DWORD_STAT(STAT_CP_##Name); FCrustyPiratePerf::Counters[(int32)ECrustyPirateCounter::Name]++; } while (0)
+#define CRUSTYPIRATE_DEC_COUNTER(Name) \
+	do { DEC_DWORD_STAT(STAT_CP_##Name); FCrustyPiratePerf::Counters[(int32)ECrustyPirateCounter::Name]--; } while (0)
+#else
+#define CRUSTYPIRATE_SCOPE(Name)
+#define CRUSTYPIRATE_SET_COUNTER(Name, Value) do { } while (0)
+#define CRUSTYPIRATE_INC_COUNTER(Name) do { } while (0)
+#define CRUSTYPIRATE_DEC_COUNTER(Name) do { } while (0)
+#endif
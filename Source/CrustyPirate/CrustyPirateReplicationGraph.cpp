@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CrustyPirateReplicationGraph.h"
+#include "CrustyPirate.h"
+#include "Enemy.h"
+#include "CollectableItem.h"
+#include "EnemyCrowdSubsystem.h"
+#include "CombatQueueSubsystem.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+
+static FAutoConsoleCommandWithWorld NetStatsCommand(
+	TEXT("CrustyPirate.NetStats"),
+	TEXT("Logs bytes per second for every client connection (or the server connection on a client) and the live enemy count."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UCrustyPirateReplicationGraph::LogNetStats(World ? World->GetNetDriver() : nullptr);
+	}));
+
+void UCrustyPirateReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+	// Class infos are created the first time an actor of a class replicates, so blueprint subclasses
+	// get the settings of their native parent.
+	GlobalActorReplicationInfoMap.SetInitClassInfoFunc([this](UClass* Class, FClassReplicationInfo& ClassInfo)
+	{
+		const AActor* CDO = Class->GetDefaultObject<AActor>();
+		float NetUpdateFrequency = CDO->GetNetUpdateFrequency();
+		if (Class->IsChildOf(AEnemy::StaticClass()))
+		{
+			NetUpdateFrequency = EnemyNetUpdateFrequency;
+		}
+		else if (Class->IsChildOf(ACollectableItem::StaticClass()))
+		{
+			NetUpdateFrequency = CollectableNetUpdateFrequency;
+		}
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(NetUpdateFrequency);
+		ClassInfo.SetCullDistanceSquared(FMath::Square(RelevancyRangeX));
+		return true;
+	});
+}
+
+void UCrustyPirateReplicationGraph::InitGlobalGraphNodes()
+{
+	Super::InitGlobalGraphNodes();
+	GridNode->CellSize = GridCellSize;
+
+	float NetStatsInterval = 0.0f;
+	if (FParse::Value(FCommandLine::Get(), TEXT("NetStatsInterval="), NetStatsInterval) && NetStatsInterval > 0.0f)
+	{
+		NetStatsTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float DeltaTime)
+		{
+			LogNetStats(NetDriver);
+			return true;
+		}), NetStatsInterval);
+	}
+}
+
+void UCrustyPirateReplicationGraph::BeginDestroy()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(NetStatsTicker);
+	Super::BeginDestroy();
+}
+
+void UCrustyPirateReplicationGraph::LogNetStats(UNetDriver* Driver)
+{
+	if (!Driver)
+	{
+		UE_LOG(LogCrustyPirate, Log, TEXT("NetStats: not a network game"));
+		return;
+	}
+	UWorld* World = Driver->GetWorld();
+	UEnemyCrowdSubsystem* Crowd = World ? World->GetSubsystem<UEnemyCrowdSubsystem>() : nullptr;
+	int32 NumEnemies = Crowd ? Crowd->Enemies.Num() : 0;
+	if (UNetConnection* ServerConnection = Driver->ServerConnection)
+	{
+		UE_LOG(LogCrustyPirate, Log, TEXT("NetStats: in %d B/s, out %d B/s, %d packets lost, %d enemies"),
+			ServerConnection->InBytesPerSecond, ServerConnection->OutBytesPerSecond, ServerConnection->InPacketsLost, NumEnemies);
+		return;
+	}
+
+	int64 TotalOutBytesPerSecond = 0;
+	for (UNetConnection* Connection : Driver->ClientConnections)
+	{
+		TotalOutBytesPerSecond += Connection->OutBytesPerSecond;
+		UE_LOG(LogCrustyPirate, Log, TEXT("NetStats: %s out %d B/s, in %d B/s, %d packets lost"),
+			*Connection->LowLevelGetRemoteAddress(true), Connection->OutBytesPerSecond, Connection->InBytesPerSecond, Connection->OutPacketsLost);
+	}
+	UCombatQueueSubsystem* Combat = World ? World->GetSubsystem<UCombatQueueSubsystem>() : nullptr;
+	int32 NumClients = Driver->ClientConnections.Num();
+	UE_LOG(LogCrustyPirate, Log, TEXT("NetStats: %d clients, %lld B/s average out per client, %d enemies, %u rejected hits"),
+		NumClients, NumClients > 0 ? TotalOutBytesPerSecond / NumClients : 0, NumEnemies, Combat ? Combat->RejectedHits : 0);
+}
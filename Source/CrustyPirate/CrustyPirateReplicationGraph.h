@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BasicReplicationGraph.h"
+#include "Containers/Ticker.h"
+#include "CrustyPirateReplicationGraph.generated.h"
+
+/**
+ * Levels run along X on a single Y, so the spatial grid degenerates into a row of cells and each
+ * connection only gathers the cells within RelevancyRangeX of its viewer. Enemies and collectables
+ * are considered less often than players; collectables are dormant until picked up.
+ * -NetStatsInterval=<seconds> logs the per connection bandwidth on that interval.
+ */
+UCLASS(Transient, Config = Game)
+class CRUSTYPIRATE_API UCrustyPirateReplicationGraph : public UBasicReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	float GridCellSize = 2048.0f;
+
+	UPROPERTY(Config)
+	float RelevancyRangeX = 4096.0f;
+
+	UPROPERTY(Config)
+	float EnemyNetUpdateFrequency = 20.0f;
+
+	UPROPERTY(Config)
+	float CollectableNetUpdateFrequency = 2.0f;
+
+	FTSTicker::FDelegateHandle NetStatsTicker;
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void BeginDestroy() override;
+
+	static void LogNetStats(UNetDriver* Driver);
+};
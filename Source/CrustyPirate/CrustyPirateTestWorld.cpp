@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CrustyPirateTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Enemy.h"
+#include "CollectableItem.h"
+#include "PlayerCharacter.h"
+#include "PerfScenarioSubsystem.h"
+#include "CrustyPirateGameInstance.h"
+#include "ProgressSaveSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+
+FCrustyPirateTestWorld::FCrustyPirateTestWorld()
+{
+	GameInstance = NewObject<UCrustyPirateGameInstance>(GEngine);
+	GameInstance->AddToRoot();
+	GameInstance->InitializeStandalone();
+	// Tests start from fresh progress and never touch the player's save.
+	if (UProgressSaveSubsystem* Save = GameInstance->GetSubsystem<UProgressSaveSubsystem>())
+	{
+		Save->IsEnabled = false;
+		Save->ResetProgress();
+	}
+	World = GameInstance->GetWorld();
+	FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+}
+
+FCrustyPirateTestWorld::~FCrustyPirateTestWorld()
+{
+	if (World)
+	{
+		World->DestroyWorld(false);
+		GEngine->DestroyWorldContext(World);
+	}
+	if (GameInstance)
+	{
+		GameInstance->Shutdown();
+		GameInstance->RemoveFromRoot();
+	}
+}
+
+void FCrustyPirateTestWorld::Tick(float DeltaTime, int32 NumFrames)
+{
+	for (int32 i = 0; i < NumFrames; i++)
+	{
+		World->Tick(LEVELTICK_All, DeltaTime);
+	}
+}
+
+AEnemy* FCrustyPirateTestWorld::SpawnEnemy(const FVector& Location)
+{
+	UClass* EnemyClass = GetDefault<UPerfScenarioSubsystem>()->EnemyClass.TryLoadClass<AEnemy>();
+	if (!EnemyClass)	return nullptr;
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<AEnemy>(EnemyClass, FTransform(Location), SpawnParams);
+}
+
+ACollectableItem* FCrustyPirateTestWorld::SpawnCollectable(const FVector& Location)
+{
+	UClass* CollectableClass = GetDefault<UPerfScenarioSubsystem>()->CollectableClass.TryLoadClass<ACollectableItem>();
+	if (!CollectableClass)	return nullptr;
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<ACollectableItem>(CollectableClass, FTransform(Location), SpawnParams);
+}
+
+APlayerCharacter* FCrustyPirateTestWorld::SpawnPlayer(const FVector& Location, bool Possess)
+{
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	UClass* PlayerClass = GameMode ? GameMode->DefaultPawnClass.Get() : nullptr;
+	if (!PlayerClass || !PlayerClass->IsChildOf<APlayerCharacter>())	return nullptr;
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	APlayerCharacter* Player = World->SpawnActor<APlayerCharacter>(PlayerClass, FTransform(Location), SpawnParams);
+	if (Player && Possess)
+	{
+		APlayerController* Controller = World->SpawnActor<APlayerController>();
+		Controller->Possess(Player);
+	}
+	return Player;
+}
+
+#endif
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class AEnemy;
+class ACollectableItem;
+class APlayerCharacter;
+class UGameInstance;
+class UWorld;
+
+/**
+ * A game world with its own UCrustyPirateGameInstance that has begun play, for automation tests that need real actors
+ * and subsystems. Nothing ticks it but Tick, saving is off, and it is torn down with the object.
+ * Actors are spawned from the classes UPerfScenarioSubsystem is configured with, so they carry their
+ * Blueprint components and animation instances.
+ */
+class FCrustyPirateTestWorld
+{
+public:
+	UGameInstance* GameInstance = nullptr;
+	UWorld* World = nullptr;
+
+	FCrustyPirateTestWorld();
+	~FCrustyPirateTestWorld();
+
+	void Tick(float DeltaTime, int32 NumFrames = 1);
+
+	AEnemy* SpawnEnemy(const FVector& Location);
+	ACollectableItem* SpawnCollectable(const FVector& Location);
+	// The game mode's default pawn; Possess gives it a player controller so subsystems iterating players find it.
+	APlayerCharacter* SpawnPlayer(const FVector& Location, bool Possess = true);
+};
+
+#endif
@@ -2,67 +2,207 @@
 
 
 #include "Enemy.h"
+#include "CrustyPirate.h"
+#include "EnemyCrowdSubsystem.h"
+#include "PaperZDAnimationComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "ActorPoolSubsystem.h"
+#include "CrustyPiratePerf.h"
+#include "NumberTextSubsystem.h"
+#include "ProgressSaveSubsystem.h"
+#include "CombatQueueSubsystem.h"
+#include "StatusEffectSubsystem.h"
+#include "LevelChunkSubsystem.h"
+#include "GameplayEventBus.h"
+#include "EnemyAnimationSubsystem.h"
+#include "Net/UnrealNetwork.h"
+
+static const FName DefaultStateMachineName("CrabbyStateMachine");
+static const FName DefaultIdleNodeName("JumpIdle");
+static const FName DefaultHitNodeName("JumpHit");
+static const FName DefaultDieNodeName("JumpDie");
+static const FName DefaultAttackSlotName("DefaultSlot");
 
 AEnemy::AEnemy()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 	PlayerDetectorSphere = CreateDefaultSubobject<USphereComponent>(TEXT("PlayerDetectorSphere"));
 	PlayerDetectorSphere->SetupAttachment(RootComponent);
 	HPText = CreateDefaultSubobject<UTextRenderComponent>(TEXT("HPText"));
 	HPText->SetupAttachment(RootComponent);
 	AttackCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("AttackCollisionBox"));
 	AttackCollisionBox->SetupAttachment(RootComponent);
+#if UE_SERVER
+	// The animation component still runs the state machine and its notifies; only the sprite's own
+	// flipbook playback is visual.
+	GetSprite()->PrimaryComponentTick.bCanEverTick = false;
+#endif
 }
 
-void AEnemy::Tick(float DeltaTime)
+void AEnemy::BeginPlay()
 {
-	Super::Tick(DeltaTime);
-	if (IsAlive && FollowTarget && !IsStunned)
+	Super::BeginPlay();
+	CRUSTYPIRATE_ADD_DYNAMIC(PlayerDetectorSphere->OnComponentBeginOverlap, this, &AEnemy::DetectorOverlapBegin);
+	CRUSTYPIRATE_ADD_DYNAMIC(PlayerDetectorSphere->OnComponentEndOverlap, this, &AEnemy::DetectorOverlapEnd);
+	InitialHitPoints = HitPoints;
+	UpdateHP(GetMaxHitPoints());
+	OnAttackOverrideEndDelegate.BindUObject(this, &AEnemy::OnAttackOverrideAnimEnd);
+	CRUSTYPIRATE_ADD_DYNAMIC(AttackCollisionBox->OnComponentBeginOverlap, this, &AEnemy::AttackBoxOverlapBegin);
+	EnableAttackCollisionBox(false);
+	RegisterWithSubsystems();
+	UpdateCombatState();
+	UProgressSaveSubsystem* Save = GetGameInstance()->GetSubsystem<UProgressSaveSubsystem>();
+	if (HasAuthority() && Save && Save->IsEnemyDefeated(this))
 	{
-		float MoveDirection = (FollowTarget->GetActorLocation().X - GetActorLocation().X) > 0.0f ? 1.0f : -1.0f;
-		UpdateDirection(MoveDirection);
-		if (ShouldMoveToTarget())
-		{
-			if (CanMove)
-			{
-				FVector WorldDirection = FVector(1.0f, 0.0f, 0.0f);
-				AddMovementInput(WorldDirection, MoveDirection);
-			}
-		}
-		else
-		{
-			if (FollowTarget->IsAlive)
-			{
-				Attack();
-			}
-		}
+		RemoveFromLevel();
 	}
 }
 
-void AEnemy::BeginPlay()
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::BeginPlay();
-	PlayerDetectorSphere->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::DetectorOverlapBegin);
-	PlayerDetectorSphere->OnComponentEndOverlap.AddDynamic(this, &AEnemy::DetectorOverlapEnd);
-	UpdateHP(HitPoints);
-	OnAttackOverrideEndDelegate.BindUObject(this, &AEnemy::OnAttackOverrideAnimEnd);
-	AttackCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::AttackBoxOverlapBegin);
+	UnregisterFromSubsystems();
+	if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+	{
+		StatusEffects->CancelAll(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void AEnemy::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(AEnemy, CombatState);
+}
+
+void AEnemy::OnAcquiredFromPool()
+{
+	// Release turns the sprite and anim ticks off; registering below applies Near again.
+	SignificanceTier = ESignificanceTier::Near;
+	GetSprite()->SetComponentTickEnabled(true);
+	if (UPaperZDAnimationComponent* AnimationComponent = GetAnimationComponent())
+	{
+		AnimationComponent->SetComponentTickEnabled(true);
+	}
+	IsAlive = true;
+	CanMove = true;
+	CanAttack = true;
+	IsStunned = false;
+	FollowTarget = NULL;
+	HPText->SetHiddenInGame(false);
+	UpdateHP(GetMaxHitPoints());
 	EnableAttackCollisionBox(false);
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetMovementMode(MOVE_Falling);
+	GetAnimInstance()->StopAllAnimationOverrides();
+	GetAnimInstance()->JumpToNode(GetIdleNodeName(), GetStateMachineName());
+	RegisterWithSubsystems();
+	UpdateCombatState();
+}
+
+void AEnemy::OnReleasedToPool()
+{
+	UnregisterFromSubsystems();
+	FollowTarget = NULL;
+	EnableAttackCollisionBox(false);
+	GetSprite()->SetComponentTickEnabled(false);
+	if (UPaperZDAnimationComponent* AnimationComponent = GetAnimationComponent())
+	{
+		AnimationComponent->SetComponentTickEnabled(false);
+	}
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+}
+
+void AEnemy::RegisterWithSubsystems()
+{
+	if (UEnemyCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>())
+	{
+		Crowd->RegisterEnemy(this);
+	}
+	if (USignificanceSubsystem* Significance = GetWorld()->GetSubsystem<USignificanceSubsystem>())
+	{
+		Significance->RegisterActor(this);
+	}
+	UEnemyAnimationSubsystem* Animation = GetWorld()->GetSubsystem<UEnemyAnimationSubsystem>();
+	if (Animation && Animation->UseParallelAnimation)
+	{
+		Animation->RegisterEnemy(this, false);
+	}
+}
+
+void AEnemy::UnregisterFromSubsystems()
+{
+	if (UEnemyCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>())
+	{
+		Crowd->UnregisterEnemy(this);
+	}
+	if (USignificanceSubsystem* Significance = GetWorld()->GetSubsystem<USignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	if (UEnemyAnimationSubsystem* Animation = GetWorld()->GetSubsystem<UEnemyAnimationSubsystem>())
+	{
+		Animation->UnregisterEnemy(this);
+	}
+}
+
+void AEnemy::SetArchetype(UEnemyArchetype* NewArchetype)
+{
+	Archetype = NewArchetype;
+	UpdateHP(GetMaxHitPoints());
+	UpdateCombatState();
+	UEnemyCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>();
+	if (Crowd && Crowd->StopDistance.IsValidIndex(CrowdIndex))
+	{
+		Crowd->StopDistance[CrowdIndex] = GetStopDistanceToTarget();
+	}
+}
+
+const FName& AEnemy::GetStateMachineName() const
+{
+	return Archetype ? Archetype->StateMachineName : DefaultStateMachineName;
+}
+
+const FName& AEnemy::GetIdleNodeName() const
+{
+	return Archetype ? Archetype->IdleNodeName : DefaultIdleNodeName;
+}
+
+const FName& AEnemy::GetHitNodeName() const
+{
+	return Archetype ? Archetype->HitNodeName : DefaultHitNodeName;
+}
+
+const FName& AEnemy::GetDieNodeName() const
+{
+	return Archetype ? Archetype->DieNodeName : DefaultDieNodeName;
+}
+
+const FName& AEnemy::GetAttackSlotName() const
+{
+	return Archetype ? Archetype->AttackSlotName : DefaultAttackSlotName;
 }
 
 void AEnemy::DetectorOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	if (!HasAuthority())	return;
 	APlayerCharacter* Player = Cast<APlayerCharacter>(OtherActor);
 	if (Player)
 	{
 		FollowTarget = Player;
+		if (USignificanceSubsystem* Significance = GetWorld()->GetSubsystem<USignificanceSubsystem>())
+		{
+			Significance->Wake(this);
+		}
 	}
 }
 
 void AEnemy::DetectorOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	if (!HasAuthority())	return;
+	// Another player leaving the detector does not drop the one being chased.
 	APlayerCharacter* Player = Cast<APlayerCharacter>(OtherActor);
-	if (Player)
+	if (Player && Player == FollowTarget)
 	{
 		FollowTarget = NULL;
 	}
@@ -70,11 +210,12 @@ void AEnemy::DetectorOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* Oth
 
 bool AEnemy::ShouldMoveToTarget()
 {
+	CRUSTYPIRATE_SCOPE(ShouldMoveToTarget);
 	bool Result = false;
 	if (FollowTarget)
 	{
 		float DistToTarget = abs(FollowTarget->GetActorLocation().X - GetActorLocation().X);
-		Result = DistToTarget > StopDistanceToTarget;
+		Result = DistToTarget > GetStopDistanceToTarget();
 	}
 	return Result;
 }
@@ -101,40 +242,110 @@ void AEnemy::UpdateDirection(float MoveDirection)
 void AEnemy::UpdateHP(int NewHP)
 {
 	HitPoints = NewHP;
-	FString Str = FString::Printf(TEXT("HP: %d"), HitPoints);
-	HPText->SetText(FText::FromString(Str));
+	if (SignificanceTier == ESignificanceTier::Dormant)
+	{
+		IsHPTextDirty = true;
+		return;
+	}
+#if !UE_SERVER
+	if (HitPoints == ShownHP)	return;
+	UNumberTextSubsystem* NumberTexts = GetWorld()->GetSubsystem<UNumberTextSubsystem>();
+	if (!NumberTexts)	return;
+	ShownHP = HitPoints;
+	HPText->SetText(NumberTexts->HPTexts.Get(HitPoints));
+#endif
 }
 
 void AEnemy::TakeDamage(int DamageAmount, float StunDuration)
 {
 	if (!IsAlive)	return;
-	UpdateHP(HitPoints - DamageAmount);
+	ApplyDamageResult(FMath::Max(HitPoints - DamageAmount, 0), StunDuration);
+}
+
+void AEnemy::ApplyDamageResult(int NewHitPoints, float StunDuration)
+{
+	CRUSTYPIRATE_SCOPE(EnemyTakeDamage);
+	UGameplayEventBus::PublishEvent(this, EGameplayEventType::DamageApplied, nullptr, this, HitPoints - NewHitPoints);
+	UpdateHP(NewHitPoints);
 	Stun(StunDuration);
+	CombatState.NoteHit();
 	if (HitPoints <= 0)
 	{
-		UpdateHP(0);
+		UGameplayEventBus::PublishEvent(this, EGameplayEventType::EnemyDefeated, nullptr, this, 0);
 		HPText->SetHiddenInGame(true);
 		IsAlive = false;
 		CanMove = false;
 		CanAttack = false;
-		GetAnimInstance()->JumpToNode(FName("JumpDie"), FName("CrabbyStateMachine"));
+		GetAnimInstance()->JumpToNode(GetDieNodeName(), GetStateMachineName());
 		EnableAttackCollisionBox(false);
+		// Streamed enemies are saved under the name of the record they were spawned for.
+		ULevelChunkSubsystem* LevelChunks = GetWorld()->GetSubsystem<ULevelChunkSubsystem>();
+		if (!LevelChunks || !LevelChunks->MarkActorGone(this))
+		{
+			if (UProgressSaveSubsystem* Save = GetGameInstance()->GetSubsystem<UProgressSaveSubsystem>())
+			{
+				Save->MarkEnemyDefeated(this);
+			}
+		}
+		if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+		{
+			StatusEffects->Schedule(this, EStatusEffect::Corpse, GetCorpseDuration());
+		}
 	}
 	else
 	{
-		GetAnimInstance()->JumpToNode(FName("JumpHit"), FName("CrabbyStateMachine"));
+		GetAnimInstance()->JumpToNode(GetHitNodeName(), GetStateMachineName());
+	}
+	UpdateCombatState();
+}
+
+void AEnemy::UpdateCombatState()
+{
+	if (!HasAuthority())	return;
+	CombatState.Set(HitPoints, IsAlive, IsStunned, IsAlive && !CanMove);
+}
+
+void AEnemy::OnRep_CombatState(const FCombatNetState& PreviousState)
+{
+	// Clients only mirror what the server decided; stun, cooldown and corpse timers stay on the server.
+	bool WasAlive = IsAlive;
+	IsAlive = CombatState.HasFlag(FCombatNetState::Flag_Alive);
+	IsStunned = CombatState.HasFlag(FCombatNetState::Flag_Stunned);
+	UpdateHP(CombatState.HitPoints);
+	if (IsAlive && !WasAlive)
+	{
+		// Reacquired from the server's pool.
+		HPText->SetHiddenInGame(false);
+		GetAnimInstance()->StopAllAnimationOverrides();
+		GetAnimInstance()->JumpToNode(GetIdleNodeName(), GetStateMachineName());
+	}
+	else if (!IsAlive && WasAlive)
+	{
+		HPText->SetHiddenInGame(true);
+		GetAnimInstance()->StopAllAnimationOverrides();
+		GetAnimInstance()->JumpToNode(GetDieNodeName(), GetStateMachineName());
+	}
+	else if (IsAlive && CombatState.HitCount != PreviousState.HitCount)
+	{
+		GetAnimInstance()->StopAllAnimationOverrides();
+		GetAnimInstance()->JumpToNode(GetHitNodeName(), GetStateMachineName());
+	}
+	if (IsAlive && CombatState.HasFlag(FCombatNetState::Flag_Attacking) && !PreviousState.HasFlag(FCombatNetState::Flag_Attacking))
+	{
+		GetAnimInstance()->PlayAnimationOverride(GetAttackAnimSequence(), GetAttackSlotName());
 	}
+	UpdateCombatState();
 }
 
 void AEnemy::Stun(float DurationInSeconds)
 {
+	CRUSTYPIRATE_SCOPE(EnemyStun);
 	IsStunned = true;
-	bool IsTimerAlreadyActive = GetWorldTimerManager().IsTimerActive(StunTimer);
-	if (IsTimerAlreadyActive)
+	if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
 	{
-		GetWorldTimerManager().ClearTimer(StunTimer);
+		StatusEffects->Schedule(this, EStatusEffect::Stun, DurationInSeconds);
 	}
-	GetWorldTimerManager().SetTimer(StunTimer, this, &AEnemy::OnStunTimerTimeout, 1.0f, false, DurationInSeconds);
+	UpdateCombatState();
 	GetAnimInstance()->StopAllAnimationOverrides();
 	EnableAttackCollisionBox(false);
 }
@@ -142,6 +353,7 @@ void AEnemy::Stun(float DurationInSeconds)
 void AEnemy::OnStunTimerTimeout()
 {
 	IsStunned = false;
+	UpdateCombatState();
 }
 
 void AEnemy::Attack()
@@ -150,8 +362,12 @@ void AEnemy::Attack()
 	{
 		CanAttack = false;
 		CanMove = false;
-		GetAnimInstance()->PlayAnimationOverride(AttackAnimSequence, FName("DefaultSlot"), 1.0f, 0.0f, OnAttackOverrideEndDelegate);
-		GetWorldTimerManager().SetTimer(AttackCooldownTimer, this, &AEnemy::OnAttackCooldownTimerTimeout, 1.0f, false, AttackCooldownInSeconds);
+		GetAnimInstance()->PlayAnimationOverride(GetAttackAnimSequence(), GetAttackSlotName(), 1.0f, 0.0f, OnAttackOverrideEndDelegate);
+		if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+		{
+			StatusEffects->Schedule(this, EStatusEffect::AttackCooldown, GetAttackCooldown());
+		}
+		UpdateCombatState();
 	}
 }
 
@@ -160,6 +376,7 @@ void AEnemy::OnAttackCooldownTimerTimeout()
 	if (IsAlive)
 	{
 		CanAttack = true;
+		UpdateCombatState();
 	}
 }
 
@@ -168,22 +385,85 @@ void AEnemy::OnAttackOverrideAnimEnd(bool Completed)
 	if (IsAlive)
 	{
 		CanMove = true;
+		UpdateCombatState();
+	}
+}
+
+void AEnemy::OnCorpseTimerTimeout()
+{
+	RemoveFromLevel();
+}
+
+void AEnemy::OnStatusEffectExpired(EStatusEffect Effect)
+{
+	switch (Effect)
+	{
+		case EStatusEffect::Stun:
+		{
+			OnStunTimerTimeout();
+		}break;
+		case EStatusEffect::AttackCooldown:
+		{
+			OnAttackCooldownTimerTimeout();
+		}break;
+		case EStatusEffect::Corpse:
+		{
+			OnCorpseTimerTimeout();
+		}break;
+		default:
+		{
+		}break;
+	}
+}
+
+void AEnemy::RemoveFromLevel()
+{
+	if (ULevelChunkSubsystem* LevelChunks = GetWorld()->GetSubsystem<ULevelChunkSubsystem>())
+	{
+		LevelChunks->MarkActorGone(this);
+	}
+	if (UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>())
+	{
+		Pool->Release(this);
+	}
+	else
+	{
+		Destroy();
 	}
 }
 
 void AEnemy::AttackBoxOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CRUSTYPIRATE_SCOPE(EnemyAttackOverlap);
+	if (!HasAuthority())	return;
 	APlayerCharacter* Player = Cast<APlayerCharacter>(OtherActor);
-	if (Player)
+	if (!Player)	return;
+	if (UCombatQueueSubsystem* Combat = GetWorld()->GetSubsystem<UCombatQueueSubsystem>())
 	{
-		Player->TakeDamage(AttackDamage, AttackStunDuration);
+		Combat->QueueDamage(this, Player, GetAttackDamage(), GetAttackStunDuration(), SwingId);
+	}
+	else
+	{
+		Player->TakeDamage(GetAttackDamage(), GetAttackStunDuration());
 	}
 }
 
 void AEnemy::EnableAttackCollisionBox(bool Enabled)
 {
+	bool WasEnabled = AttackCollisionBox->GetCollisionEnabled() != ECollisionEnabled::NoCollision;
+	if (WasEnabled && !Enabled)
+	{
+		if (UCombatQueueSubsystem* Combat = GetWorld()->GetSubsystem<UCombatQueueSubsystem>())
+		{
+			Combat->EndSwing(this);
+		}
+	}
 	if (Enabled)
 	{
+		if (!WasEnabled)
+		{
+			SwingId++;
+		}
 		AttackCollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		AttackCollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Overlap);
 	}
@@ -192,4 +472,37 @@ void AEnemy::EnableAttackCollisionBox(bool Enabled)
 		AttackCollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		AttackCollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Ignore);
 	}
+}
+
+void AEnemy::SetSignificanceTier(ESignificanceTier Tier, float TickInterval)
+{
+	SignificanceTier = Tier;
+	bool IsDormant = Tier == ESignificanceTier::Dormant;
+	GetSprite()->SetComponentTickEnabled(!IsDormant);
+	GetSprite()->SetComponentTickInterval(TickInterval);
+	if (UPaperZDAnimationComponent* AnimationComponent = GetAnimationComponent())
+	{
+		AnimationComponent->SetComponentTickEnabled(!IsDormant);
+		AnimationComponent->SetComponentTickInterval(TickInterval);
+	}
+	// Mid tier flipbooks are advanced in one batch; off-screen enemies stop advancing theirs.
+	UEnemyAnimationSubsystem* Animation = GetWorld()->GetSubsystem<UEnemyAnimationSubsystem>();
+	if (Animation && Animation->UseParallelAnimation)
+	{
+		if (IsDormant)
+		{
+			Animation->UnregisterEnemy(this);
+		}
+		else
+		{
+			Animation->RegisterEnemy(this, Tier == ESignificanceTier::Mid);
+		}
+	}
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->SetComponentTickEnabled(!IsDormant || !Movement->IsMovingOnGround());
+	if (!IsDormant && IsHPTextDirty)
+	{
+		IsHPTextDirty = false;
+		UpdateHP(HitPoints);
+	}
 }
\ No newline at end of file
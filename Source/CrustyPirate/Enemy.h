@@ -9,14 +9,20 @@
 #include "PlayerCharacter.h"
 #include "Components/TextRenderComponent.h"
 #include "PaperZDAnimInstance.h"
-#include "Engine/TimerHandle.h"
+#include "SignificanceSubsystem.h"
+#include "PooledActor.h"
+#include "EnemyArchetype.h"
+#include "Combatant.h"
+#include "StatusEffectTarget.h"
+#include "CombatNetState.h"
 #include "Enemy.generated.h"
 
 /**
- * 
+ * When Archetype is set, tuning, node names and the attack animation come from it and the
+ * matching per-instance properties below are ignored.
  */
 UCLASS()
-class CRUSTYPIRATE_API AEnemy : public APaperZDCharacter
+class CRUSTYPIRATE_API AEnemy : public APaperZDCharacter, public IPooledActor, public ICombatant, public IStatusEffectTarget
 {
 	GENERATED_BODY()
 	
@@ -27,6 +33,9 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	APlayerCharacter* FollowTarget;
 
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	UEnemyArchetype* Archetype;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	UPaperZDAnimSequence* AttackAnimSequence;
 
@@ -51,9 +60,6 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float AttackCooldownInSeconds = 1.0f;
 
-	FTimerHandle StunTimer;
-	FTimerHandle AttackCooldownTimer;
-
 	FZDOnAnimationOverrideEndSignature OnAttackOverrideEndDelegate;
 
 
@@ -69,9 +75,45 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float AttackStunDuration = 0.3f;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float CorpseDurationInSeconds = 2.0f;
+
+	// Written by the server whenever HP or the flags change; clients apply it in OnRep_CombatState.
+	UPROPERTY(ReplicatedUsing = OnRep_CombatState)
+	FCombatNetState CombatState;
+
+	int InitialHitPoints = 100;
+
+	int32 CrowdIndex = INDEX_NONE;
+	int32 AnimIndex = INDEX_NONE;
+	uint32 SwingId = 0;
+
+	ESignificanceTier SignificanceTier = ESignificanceTier::Near;
+	bool IsHPTextDirty = false;
+	int ShownHP = INDEX_NONE;
+
 	AEnemy();
-	virtual void Tick(float DeltaTime) override;
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+	void RegisterWithSubsystems();
+	void UnregisterFromSubsystems();
+	void SetArchetype(UEnemyArchetype* NewArchetype);
+
+	int GetMaxHitPoints() const { return Archetype ? Archetype->HitPoints : InitialHitPoints; }
+	int GetAttackDamage() const { return Archetype ? Archetype->AttackDamage : AttackDamage; }
+	float GetAttackStunDuration() const { return Archetype ? Archetype->AttackStunDuration : AttackStunDuration; }
+	float GetAttackCooldown() const { return Archetype ? Archetype->AttackCooldownInSeconds : AttackCooldownInSeconds; }
+	float GetStopDistanceToTarget() const { return Archetype ? Archetype->StopDistanceToTarget : StopDistanceToTarget; }
+	float GetCorpseDuration() const { return Archetype ? Archetype->CorpseDurationInSeconds : CorpseDurationInSeconds; }
+	UPaperZDAnimSequence* GetAttackAnimSequence() const { return Archetype ? Archetype->AttackAnimSequence : AttackAnimSequence; }
+	const FName& GetStateMachineName() const;
+	const FName& GetIdleNodeName() const;
+	const FName& GetHitNodeName() const;
+	const FName& GetDieNodeName() const;
+	const FName& GetAttackSlotName() const;
 	
 	UFUNCTION()
 	void DetectorOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
@@ -82,15 +124,27 @@ public:
 	void UpdateDirection(float MoveDirection);
 	void UpdateHP(int NewHP);
 	void TakeDamage(int DamageAmount, float StunDuration);
+	virtual bool CanReceiveDamage() const override { return IsAlive; }
+	virtual int GetCombatHitPoints() const override { return HitPoints; }
+	virtual void ApplyDamageResult(int NewHitPoints, float StunDuration) override;
+	virtual const UPrimitiveComponent* GetAttackBox() const override { return AttackCollisionBox; }
+	void UpdateCombatState();
+	UFUNCTION()
+	void OnRep_CombatState(const FCombatNetState& PreviousState);
 	void Stun(float DurationInSeconds);
 	void OnStunTimerTimeout();
 	void Attack();
 	void OnAttackCooldownTimerTimeout();
 	void OnAttackOverrideAnimEnd(bool Completed);
+	void OnCorpseTimerTimeout();
+	virtual void OnStatusEffectExpired(EStatusEffect Effect) override;
+	void RemoveFromLevel();
 
 	UFUNCTION()
 	void AttackBoxOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 	
 	UFUNCTION(BlueprintCallable)
 	void EnableAttackCollisionBox(bool Enabled);
+
+	void SetSignificanceTier(ESignificanceTier Tier, float TickInterval);
 };
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyAnimationSubsystem.h"
+#include "Enemy.h"
+#include "InputReplaySubsystem.h"
+#include "PaperFlipbook.h"
+#include "PaperFlipbookComponent.h"
+#include "Async/ParallelFor.h"
+#include "Misc/App.h"
+#include "CrustyPiratePerf.h"
+
+void UEnemyAnimationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	// Lets perf scenarios compare both paths without editing config.
+	if (FParse::Param(FCommandLine::Get(), TEXT("NoParallelAnimation")))
+	{
+		UseParallelAnimation = false;
+	}
+	// Whether an enemy was rendered is not part of the recorded simulation, and without a renderer
+	// (-nullrhi) nothing ever is.
+	if (UInputReplaySubsystem::IsDeterministicRun() || !FApp::CanEverRender())
+	{
+		UseCulling = false;
+	}
+}
+
+void UEnemyAnimationSubsystem::RegisterEnemy(AEnemy* Enemy, bool Batched)
+{
+	if (!Enemy)	return;
+	int32 Index = Enemy->AnimIndex;
+	if (!Enemies.IsValidIndex(Index) || Enemies[Index] != Enemy)
+	{
+		UPaperFlipbookComponent* Sprite = Enemy->GetSprite();
+		Index = Enemy->AnimIndex = Enemies.Add(Enemy);
+		Sprites.Add(Sprite);
+		Flipbooks.Add(Sprite->GetFlipbook());
+		Times.Add(Sprite->GetPlaybackPosition());
+		AppliedTimes.Add(Times[Index]);
+		PlayRates.Add(Sprite->GetPlayRate());
+		Frames.Add(Sprite->GetPlaybackPositionInFrames());
+		NewFrames.Add(Frames[Index]);
+		IsBatched.Add(0);
+		IsCulled.Add(0);
+	}
+	IsBatched[Index] = Batched ? 1 : 0;
+	SetAnimating(Index, !IsCulled[Index]);
+}
+
+void UEnemyAnimationSubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	if (!Enemy || !Enemies.IsValidIndex(Enemy->AnimIndex) || Enemies[Enemy->AnimIndex] != Enemy)	return;
+	int32 Index = Enemy->AnimIndex;
+	Enemies.RemoveAtSwap(Index);
+	Sprites.RemoveAtSwap(Index);
+	Flipbooks.RemoveAtSwap(Index);
+	Times.RemoveAtSwap(Index);
+	AppliedTimes.RemoveAtSwap(Index);
+	PlayRates.RemoveAtSwap(Index);
+	Frames.RemoveAtSwap(Index);
+	NewFrames.RemoveAtSwap(Index);
+	IsBatched.RemoveAtSwap(Index);
+	IsCulled.RemoveAtSwap(Index);
+	if (Enemies.IsValidIndex(Index))
+	{
+		Enemies[Index]->AnimIndex = Index;
+	}
+	Enemy->AnimIndex = INDEX_NONE;
+}
+
+int32 UEnemyAnimationSubsystem::GetNumBatched() const
+{
+	int32 NumBatched = 0;
+	for (int32 i = 0; i < IsBatched.Num(); i++)
+	{
+		NumBatched += IsBatched[i] && !IsCulled[i] ? 1 : 0;
+	}
+	return NumBatched;
+}
+
+void UEnemyAnimationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (Enemies.Num() == 0)	return;
+	CRUSTYPIRATE_SCOPE(EnemyAnimation);
+
+	TimeSinceCullCheck += DeltaTime;
+	if (UseCulling && TimeSinceCullCheck >= CullCheckInterval)
+	{
+		TimeSinceCullCheck = 0.0f;
+		UpdateCulling();
+	}
+
+	// PaperZD may have switched flipbook or moved playback on its own (throttled) tick since the last frame.
+	const int32 Num = Enemies.Num();
+	for (int32 i = 0; i < Num; i++)
+	{
+		if (!IsBatched[i] || IsCulled[i])	continue;
+		UPaperFlipbookComponent* Sprite = Sprites[i];
+		const UPaperFlipbook* Flipbook = Sprite->GetFlipbook();
+		float Position = Sprite->GetPlaybackPosition();
+		if (Flipbook != Flipbooks[i] || Position != AppliedTimes[i])
+		{
+			Flipbooks[i] = Flipbook;
+			Times[i] = Position;
+			AppliedTimes[i] = Position;
+			Frames[i] = Sprite->GetPlaybackPositionInFrames();
+		}
+		PlayRates[i] = Enemies[i]->IsAlive ? Sprite->GetPlayRate() : 0.0f;
+	}
+
+	// Flipbook assets are immutable at runtime, so frame lookups are safe off the game thread.
+	ParallelFor(Num, [this, DeltaTime](int32 i)
+	{
+		NewFrames[i] = Frames[i];
+		const UPaperFlipbook* Flipbook = Flipbooks[i];
+		if (!IsBatched[i] || IsCulled[i] || !Flipbook || PlayRates[i] == 0.0f)	return;
+		float Duration = Flipbook->GetTotalDuration();
+		if (Duration <= 0.0f)	return;
+		float Time = FMath::Fmod(Times[i] + DeltaTime * PlayRates[i], Duration);
+		Times[i] = Time < 0.0f ? Time + Duration : Time;
+		NewFrames[i] = Flipbook->GetKeyFrameIndexAtTime(Times[i]);
+	}, Num < ParallelThreshold ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	for (int32 i = 0; i < Num; i++)
+	{
+		if (NewFrames[i] == Frames[i])	continue;
+		Frames[i] = NewFrames[i];
+		Sprites[i]->SetPlaybackPosition(Times[i], false);
+		AppliedTimes[i] = Sprites[i]->GetPlaybackPosition();
+	}
+}
+
+TStatId UEnemyAnimationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyAnimationSubsystem, STATGROUP_Tickables);
+}
+
+bool UEnemyAnimationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+#if UE_SERVER
+	return false;
+#else
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+#endif
+}
+
+void UEnemyAnimationSubsystem::UpdateCulling()
+{
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		uint8 Culled = Sprites[i]->WasRecentlyRendered(CullTime) ? 0 : 1;
+		if (Culled == IsCulled[i])	continue;
+		IsCulled[i] = Culled;
+		SetAnimating(i, !Culled);
+	}
+}
+
+void UEnemyAnimationSubsystem::SetAnimating(int32 Index, bool Animating)
+{
+	// Only the flipbook update is culled. The animation component tick belongs to the significance tier:
+	// attack overrides end through it and a listen server drives replicated combat state with it.
+	Sprites[Index]->SetComponentTickEnabled(Animating && !IsBatched[Index]);
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyAnimationSubsystem.generated.h"
+
+class AEnemy;
+class UPaperFlipbook;
+class UPaperFlipbookComponent;
+
+/**
+ * Takes over flipbook playback for enemies in the Mid significance tier and stops advancing the flipbooks
+ * of enemies that are not on screen. The PaperZD state machine keeps running at whatever interval the
+ * significance tier set, so attack overrides, notifies and server-side state are unaffected by culling.
+ * For batched enemies, playback time and frame index are advanced in a ParallelFor and only changed frames
+ * are written back on the game thread.
+ * State is kept in parallel arrays indexed by AEnemy::AnimIndex.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UEnemyAnimationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	bool UseParallelAnimation = true;
+
+	UPROPERTY(Config)
+	int32 ParallelThreshold = 64;
+
+	UPROPERTY(Config)
+	bool UseCulling = true;
+
+	// Seconds without being rendered after which an enemy's flipbook stops advancing.
+	UPROPERTY(Config)
+	float CullTime = 0.25f;
+
+	UPROPERTY(Config)
+	float CullCheckInterval = 0.2f;
+
+	UPROPERTY()
+	TArray<AEnemy*> Enemies;
+
+	UPROPERTY()
+	TArray<UPaperFlipbookComponent*> Sprites;
+
+	UPROPERTY()
+	TArray<const UPaperFlipbook*> Flipbooks;
+
+	TArray<float> Times;
+	TArray<float> AppliedTimes;
+	TArray<float> PlayRates;
+	TArray<int32> Frames;
+	TArray<int32> NewFrames;
+	TArray<uint8> IsBatched;
+	TArray<uint8> IsCulled;
+	float TimeSinceCullCheck = 0.0f;
+
+	void RegisterEnemy(AEnemy* Enemy, bool Batched);
+	void UnregisterEnemy(AEnemy* Enemy);
+	int32 GetNumBatched() const;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void UpdateCulling();
+	void SetAnimating(int32 Index, bool Animating);
+};
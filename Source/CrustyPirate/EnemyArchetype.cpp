@@ -0,0 +1,11 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyArchetype.h"
+
+const FPrimaryAssetType UEnemyArchetype::PrimaryAssetType = FName("EnemyArchetype");
+
+FPrimaryAssetId UEnemyArchetype::GetPrimaryAssetId() const
+{
+	return FPrimaryAssetId(PrimaryAssetType, GetFName());
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "EnemyArchetype.generated.h"
+
+class AEnemy;
+class UPaperZDAnimSequence;
+
+/**
+ * Immutable tuning shared by every enemy of one kind. Enemies only keep their mutable state
+ * (current HP, flags, timers) and point at one of these.
+ */
+UCLASS(BlueprintType)
+class CRUSTYPIRATE_API UEnemyArchetype : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	static const FPrimaryAssetType PrimaryAssetType;
+
+	// Actor class to spawn for this archetype; variants only need a new archetype, not a new Blueprint.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TSoftClassPtr<AEnemy> EnemyClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	int HitPoints = 100;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	int AttackDamage = 25;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float AttackStunDuration = 0.3f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float AttackCooldownInSeconds = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float StopDistanceToTarget = 70.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float CorpseDurationInSeconds = 2.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	UPaperZDAnimSequence* AttackAnimSequence;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName StateMachineName = FName("CrabbyStateMachine");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName IdleNodeName = FName("JumpIdle");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName HitNodeName = FName("JumpHit");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName DieNodeName = FName("JumpDie");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName AttackSlotName = FName("DefaultSlot");
+
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyArchetypeSubsystem.h"
+#include "CrustyPirate.h"
+#include "Enemy.h"
+#include "EnemyArchetype.h"
+#include "EnemyCrowdSubsystem.h"
+#include "ActorPoolSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+
+static FAutoConsoleCommandWithWorld EnemyArchetypeStatsCommand(
+	TEXT("CrustyPirate.EnemyArchetypeStats"),
+	TEXT("Logs the enemy and archetype sizes, how many enemies use an archetype and archetype/Blueprint class load times."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UEnemyArchetypeSubsystem* ArchetypeSubsystem = World ? World->GetSubsystem<UEnemyArchetypeSubsystem>() : nullptr)
+		{
+			ArchetypeSubsystem->LogMemoryStats();
+		}
+	}));
+
+AEnemy* UEnemyArchetypeSubsystem::SpawnEnemy(FName ArchetypeName, const FTransform& Transform)
+{
+	UEnemyArchetype* Archetype = FindOrLoadArchetype(ArchetypeName);
+	if (!Archetype)
+	{
+		UE_LOG(LogCrustyPirate, Warning, TEXT("Unknown enemy archetype %s"), *ArchetypeName.ToString());
+		return nullptr;
+	}
+	UClass* EnemyClass = LoadEnemyClass(Archetype);
+	if (!EnemyClass)	return nullptr;
+
+	AEnemy* Enemy = nullptr;
+	if (UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>())
+	{
+		Enemy = Cast<AEnemy>(Pool->Acquire(EnemyClass, Transform));
+	}
+	else
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Enemy = GetWorld()->SpawnActor<AEnemy>(EnemyClass, Transform, SpawnParams);
+	}
+	if (Enemy)
+	{
+		Enemy->SetArchetype(Archetype);
+	}
+	return Enemy;
+}
+
+UEnemyArchetype* UEnemyArchetypeSubsystem::FindOrLoadArchetype(FName ArchetypeName)
+{
+	if (UEnemyArchetype** Found = Archetypes.Find(ArchetypeName))
+	{
+		return *Found;
+	}
+	FSoftObjectPath Path = UAssetManager::Get().GetPrimaryAssetPath(FPrimaryAssetId(UEnemyArchetype::PrimaryAssetType, ArchetypeName));
+	UEnemyArchetype* Archetype = Cast<UEnemyArchetype>(Path.TryLoad());
+	if (Archetype)
+	{
+		Archetypes.Add(ArchetypeName, Archetype);
+	}
+	return Archetype;
+}
+
+void UEnemyArchetypeSubsystem::LogMemoryStats() const
+{
+	int32 NumEnemies = 0;
+	int32 NumWithArchetype = 0;
+	if (UEnemyCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>())
+	{
+		NumEnemies = Crowd->GetNumEnemies();
+		for (const AEnemy* Enemy : Crowd->Enemies)
+		{
+			NumWithArchetype += Enemy && Enemy->Archetype ? 1 : 0;
+		}
+	}
+	// AEnemy still carries the per-instance tuning as the fallback for enemies without an archetype, so its
+	// size does not shrink yet; only the archetype assets themselves are shared.
+	int32 TuningBytes = UEnemyArchetype::StaticClass()->GetPropertiesSize() - UPrimaryDataAsset::StaticClass()->GetPropertiesSize();
+	int32 EnemyBytes = AEnemy::StaticClass()->GetPropertiesSize();
+	UE_LOG(LogCrustyPirate, Display, TEXT("Enemy archetypes: %d loaded in %.2f ms, %d of %d live enemies use one"), Archetypes.Num(), ArchetypeLoadTimeMs, NumWithArchetype, NumEnemies);
+	UE_LOG(LogCrustyPirate, Display, TEXT("  AEnemy instance: %d bytes including the fallback tuning, archetype tuning: %d bytes per archetype (%d bytes total)"),
+		EnemyBytes, TuningBytes, TuningBytes * Archetypes.Num());
+	for (const TPair<UClass*, double>& Entry : ClassLoadTimesMs)
+	{
+		UE_LOG(LogCrustyPirate, Display, TEXT("  Blueprint class %s loaded in %.2f ms"), *GetNameSafe(Entry.Key), Entry.Value);
+	}
+}
+
+void UEnemyArchetypeSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	double StartTime = FPlatformTime::Seconds();
+	UAssetManager::Get().LoadPrimaryAssetsWithType(UEnemyArchetype::PrimaryAssetType, TArray<FName>(),
+		FStreamableDelegate::CreateUObject(this, &UEnemyArchetypeSubsystem::OnArchetypesLoaded, StartTime));
+}
+
+bool UEnemyArchetypeSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UEnemyArchetypeSubsystem::OnArchetypesLoaded(double StartTime)
+{
+	ArchetypeLoadTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	TArray<UObject*> Loaded;
+	UAssetManager::Get().GetPrimaryAssetObjectList(UEnemyArchetype::PrimaryAssetType, Loaded);
+	for (UObject* Object : Loaded)
+	{
+		if (UEnemyArchetype* Archetype = Cast<UEnemyArchetype>(Object))
+		{
+			Archetypes.Add(Archetype->GetFName(), Archetype);
+		}
+	}
+	UE_LOG(LogCrustyPirate, Log, TEXT("Loaded %d enemy archetypes in %.2f ms"), Archetypes.Num(), ArchetypeLoadTimeMs);
+}
+
+UClass* UEnemyArchetypeSubsystem::LoadEnemyClass(const UEnemyArchetype* Archetype)
+{
+	FSoftObjectPath ClassPath = Archetype->EnemyClass.IsNull() ? DefaultEnemyClass : Archetype->EnemyClass.ToSoftObjectPath();
+	if (UClass* Loaded = Cast<UClass>(ClassPath.ResolveObject()))
+	{
+		return Loaded->IsChildOf(AEnemy::StaticClass()) ? Loaded : nullptr;
+	}
+	double StartTime = FPlatformTime::Seconds();
+	UClass* EnemyClass = Cast<UClass>(ClassPath.TryLoad());
+	if (EnemyClass && EnemyClass->IsChildOf(AEnemy::StaticClass()))
+	{
+		ClassLoadTimesMs.Add(EnemyClass, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		return EnemyClass;
+	}
+	return nullptr;
+}
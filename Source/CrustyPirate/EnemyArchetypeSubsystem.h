@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyArchetypeSubsystem.generated.h"
+
+class AEnemy;
+class UEnemyArchetype;
+
+/**
+ * Spawns enemies by archetype name (the UEnemyArchetype asset name) through the actor pool.
+ * Archetypes are registered with the asset manager as the "EnemyArchetype" primary asset type
+ * and are all loaded asynchronously when the world begins play.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UEnemyArchetypeSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Used for archetypes that do not set their own EnemyClass.
+	UPROPERTY(Config)
+	FSoftClassPath DefaultEnemyClass;
+
+	UPROPERTY()
+	TMap<FName, UEnemyArchetype*> Archetypes;
+
+	UPROPERTY()
+	TMap<UClass*, double> ClassLoadTimesMs;
+
+	double ArchetypeLoadTimeMs = 0.0;
+
+	AEnemy* SpawnEnemy(FName ArchetypeName, const FTransform& Transform);
+	UEnemyArchetype* FindOrLoadArchetype(FName ArchetypeName);
+	void LogMemoryStats() const;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnArchetypesLoaded(double StartTime);
+	UClass* LoadEnemyClass(const UEnemyArchetype* Archetype);
+};
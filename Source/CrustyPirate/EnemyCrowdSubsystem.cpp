@@ -0,0 +1,273 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyCrowdSubsystem.h"
+#include "Enemy.h"
+#include "PlayerCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "CrustyPiratePerf.h"
+
+void UEnemyCrowdSubsystem::RegisterEnemy(AEnemy* Enemy)
+{
+	if (!Enemy || Enemy->CrowdIndex != INDEX_NONE)	return;
+	FVector Location = Enemy->GetActorLocation();
+	float Radius = Enemy->PlayerDetectorSphere->GetScaledSphereRadius();
+	Enemy->CrowdIndex = Enemies.Add(Enemy);
+	PositionX.Add(Location.X);
+	PositionZ.Add(Location.Z);
+	DetectorRadius.Add(Radius);
+	IsPlayerDetected.Add(0);
+	DetectedPlayer.Add(nullptr);
+	DetectedFrame.Add(0);
+	StopDistance.Add(Enemy->GetStopDistanceToTarget());
+	TargetIndex.Add(INDEX_NONE);
+	StateFlags.Add(0);
+	Facing.Add(0);
+	MoveDirection.Add(0);
+	Actions.Add(EEnemyCrowdAction::None);
+	if (CrowdTickFunction.IsTickFunctionRegistered())
+	{
+		Enemy->GetCharacterMovement()->PrimaryComponentTick.AddPrerequisite(this, CrowdTickFunction);
+	}
+	if (UseSpatialPlayerDetection)
+	{
+		Enemy->PlayerDetectorSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		SpatialHash.Add(Enemy->CrowdIndex, Location.X, Location.Z);
+		MaxDetectorRadius = FMath::Max(MaxDetectorRadius, Radius);
+	}
+}
+
+void UEnemyCrowdSubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	if (!Enemy || !Enemies.IsValidIndex(Enemy->CrowdIndex) || Enemies[Enemy->CrowdIndex] != Enemy)	return;
+	int32 Index = Enemy->CrowdIndex;
+	int32 LastIndex = Enemies.Num() - 1;
+	if (UseSpatialPlayerDetection)
+	{
+		SpatialHash.Remove(Index);
+		if (Index != LastIndex)
+		{
+			SpatialHash.Relabel(LastIndex, Index);
+		}
+	}
+	Enemies.RemoveAtSwap(Index);
+	PositionX.RemoveAtSwap(Index);
+	PositionZ.RemoveAtSwap(Index);
+	DetectorRadius.RemoveAtSwap(Index);
+	IsPlayerDetected.RemoveAtSwap(Index);
+	DetectedPlayer.RemoveAtSwap(Index);
+	DetectedFrame.RemoveAtSwap(Index);
+	StopDistance.RemoveAtSwap(Index);
+	TargetIndex.RemoveAtSwap(Index);
+	StateFlags.RemoveAtSwap(Index);
+	Facing.RemoveAtSwap(Index);
+	MoveDirection.RemoveAtSwap(Index);
+	Actions.RemoveAtSwap(Index);
+	if (Enemies.IsValidIndex(Index))
+	{
+		Enemies[Index]->CrowdIndex = Index;
+	}
+	Enemy->CrowdIndex = INDEX_NONE;
+	Enemy->GetCharacterMovement()->PrimaryComponentTick.RemovePrerequisite(this, CrowdTickFunction);
+}
+
+void UEnemyCrowdSubsystem::Tick(float DeltaTime)
+{
+	// Enemies move on the server; clients get the result through replicated movement.
+	if (GetWorld()->GetNetMode() == NM_Client)	return;
+	CRUSTYPIRATE_SCOPE(EnemyUpdate);
+	CRUSTYPIRATE_SET_COUNTER(LiveEnemies, Enemies.Num());
+	if (Enemies.Num() == 0)	return;
+	if (UseSpatialPlayerDetection)
+	{
+		UpdatePlayerDetection();
+	}
+	GatherState();
+	ResolveActions();
+	ApplyActions();
+}
+
+void FEnemyCrowdTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Crowd && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Crowd->Tick(DeltaTime);
+	}
+}
+
+void UEnemyCrowdSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	SpatialHash.CellSize = DetectionCellSize;
+}
+
+void UEnemyCrowdSubsystem::Deinitialize()
+{
+	CrowdTickFunction.UnRegisterTickFunction();
+	Super::Deinitialize();
+}
+
+void UEnemyCrowdSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	CrowdTickFunction.Crowd = this;
+	CrowdTickFunction.bCanEverTick = true;
+	CrowdTickFunction.TickGroup = TG_PrePhysics;
+	CrowdTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+	// Enemies placed in the level registered before the tick function existed.
+	for (AEnemy* Enemy : Enemies)
+	{
+		Enemy->GetCharacterMovement()->PrimaryComponentTick.AddPrerequisite(this, CrowdTickFunction);
+	}
+}
+
+bool UEnemyCrowdSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+int32 UEnemyCrowdSubsystem::FindOrAddTarget(APlayerCharacter* Target)
+{
+	int32 Index = Targets.Find(Target);
+	if (Index == INDEX_NONE)
+	{
+		Index = Targets.Add(Target);
+		TargetPositionX.Add(Target->GetActorLocation().X);
+	}
+	return Index;
+}
+
+void UEnemyCrowdSubsystem::UpdatePlayerDetection()
+{
+	DetectionFrame++;
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		FVector Location = Enemies[i]->GetActorLocation();
+		PositionX[i] = Location.X;
+		PositionZ[i] = Location.Z;
+		SpatialHash.Update(i, Location.X, Location.Z);
+	}
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerCharacter* Player = Cast<APlayerCharacter>((*It)->GetPawn());
+		if (!Player)	continue;
+
+		// Sphere vs the player's capsule, projected onto the X/Z plane.
+		FVector PlayerLocation = Player->GetActorLocation();
+		float CapsuleRadius = Player->GetCapsuleComponent()->GetScaledCapsuleRadius();
+		float CapsuleHalfSegment = Player->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() - CapsuleRadius;
+		DetectionCandidates.Reset();
+		SpatialHash.Query(PlayerLocation.X, PlayerLocation.Z, MaxDetectorRadius + CapsuleRadius + CapsuleHalfSegment, DetectionCandidates);
+		for (int32 Index : DetectionCandidates)
+		{
+			float DeltaX = PositionX[Index] - PlayerLocation.X;
+			float DeltaZ = FMath::Max(FMath::Abs(PositionZ[Index] - PlayerLocation.Z) - CapsuleHalfSegment, 0.0f);
+			float Reach = DetectorRadius[Index] + CapsuleRadius;
+			if (DeltaX * DeltaX + DeltaZ * DeltaZ > Reach * Reach)	continue;
+			DetectedFrame[Index] = DetectionFrame;
+			if (!IsPlayerDetected[Index])
+			{
+				IsPlayerDetected[Index] = 1;
+				DetectedPlayer[Index] = Player;
+				AEnemy* Enemy = Enemies[Index];
+				Enemy->DetectorOverlapBegin(Enemy->PlayerDetectorSphere, Player, Player->GetCapsuleComponent(), 0, false, FHitResult());
+			}
+		}
+	}
+
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		if (IsPlayerDetected[i] && DetectedFrame[i] != DetectionFrame)
+		{
+			IsPlayerDetected[i] = 0;
+			AEnemy* Enemy = Enemies[i];
+			if (APlayerCharacter* Player = DetectedPlayer[i].Get())
+			{
+				Enemy->DetectorOverlapEnd(Enemy->PlayerDetectorSphere, Player, Player->GetCapsuleComponent(), 0);
+			}
+			DetectedPlayer[i] = nullptr;
+		}
+	}
+}
+
+void UEnemyCrowdSubsystem::GatherState()
+{
+	Targets.Reset();
+	TargetPositionX.Reset();
+	// The flags are read from the actors every frame, so Blueprint writes to them count straight away.
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		AEnemy* Enemy = Enemies[i];
+		uint8 Flags = 0;
+		if (Enemy->IsAlive)		Flags |= Flag_Alive;
+		if (Enemy->IsStunned)	Flags |= Flag_Stunned;
+		if (Enemy->CanMove)		Flags |= Flag_CanMove;
+		TargetIndex[i] = INDEX_NONE;
+		if (Enemy->FollowTarget)
+		{
+			Flags |= Flag_HasTarget;
+			if (Enemy->FollowTarget->IsAlive)	Flags |= Flag_TargetAlive;
+			TargetIndex[i] = FindOrAddTarget(Enemy->FollowTarget);
+			PositionX[i] = Enemy->GetActorLocation().X;
+		}
+		StateFlags[i] = Flags;
+	}
+}
+
+void UEnemyCrowdSubsystem::ResolveActions()
+{
+	const int32 Num = Enemies.Num();
+	for (int32 i = 0; i < Num; i++)
+	{
+		const uint8 Flags = StateFlags[i];
+		const bool Active = (Flags & (Flag_Alive | Flag_HasTarget | Flag_Stunned)) == (Flag_Alive | Flag_HasTarget);
+		if (!Active)
+		{
+			MoveDirection[i] = 0;
+			Actions[i] = EEnemyCrowdAction::None;
+			continue;
+		}
+		const float Delta = TargetPositionX[TargetIndex[i]] - PositionX[i];
+		MoveDirection[i] = Delta > 0.0f ? 1 : -1;
+		if (FMath::Abs(Delta) > StopDistance[i])
+		{
+			Actions[i] = (Flags & Flag_CanMove) ? EEnemyCrowdAction::Move : EEnemyCrowdAction::None;
+		}
+		else
+		{
+			Actions[i] = (Flags & Flag_TargetAlive) ? EEnemyCrowdAction::Attack : EEnemyCrowdAction::None;
+		}
+	}
+}
+
+void UEnemyCrowdSubsystem::ApplyActions()
+{
+	const FVector WorldDirection = FVector(1.0f, 0.0f, 0.0f);
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		if (MoveDirection[i] == 0)	continue;
+		AEnemy* Enemy = Enemies[i];
+		if (Facing[i] != MoveDirection[i])
+		{
+			Facing[i] = MoveDirection[i];
+			Enemy->UpdateDirection(MoveDirection[i]);
+		}
+		switch (Actions[i])
+		{
+			case EEnemyCrowdAction::Move:
+			{
+				Enemy->AddMovementInput(WorldDirection, MoveDirection[i]);
+			}break;
+			case EEnemyCrowdAction::Attack:
+			{
+				Enemy->Attack();
+			}break;
+			default:
+			{
+			}break;
+		}
+	}
+}
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "EnemySpatialHash.h"
+#include "EnemyCrowdSubsystem.generated.h"
+
+class AEnemy;
+class APlayerCharacter;
+class UEnemyCrowdSubsystem;
+
+UENUM()
+enum class EEnemyCrowdAction : uint8
+{
+	None,
+	Move,
+	Attack
+};
+
+/** Runs the crowd update in TG_PrePhysics, ahead of the enemies' movement components. */
+USTRUCT()
+struct FEnemyCrowdTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UEnemyCrowdSubsystem* Crowd = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override { return TEXT("FEnemyCrowdTickFunction"); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FEnemyCrowdTickFunction> : public TStructOpsTypeTraitsBase2<FEnemyCrowdTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Drives the chase/attack logic of every AEnemy in the world in one batched pass per frame.
+ * State is kept in parallel arrays indexed by AEnemy::CrowdIndex. The update ticks in TG_PrePhysics and
+ * every registered enemy's movement component waits for it, so movement input lands the same frame.
+ * With UseSpatialPlayerDetection the detector spheres stop generating overlaps and player
+ * detection is done against a spatial hash instead.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UEnemyCrowdSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	enum EStateFlags : uint8
+	{
+		Flag_Alive = 1 << 0,
+		Flag_Stunned = 1 << 1,
+		Flag_CanMove = 1 << 2,
+		Flag_HasTarget = 1 << 3,
+		Flag_TargetAlive = 1 << 4
+	};
+
+	UPROPERTY(Config)
+	bool UseSpatialPlayerDetection = false;
+
+	UPROPERTY(Config)
+	float DetectionCellSize = 512.0f;
+
+	UPROPERTY()
+	TArray<AEnemy*> Enemies;
+
+	UPROPERTY()
+	TArray<APlayerCharacter*> Targets;
+
+	TArray<float> PositionX;
+	TArray<float> PositionZ;
+	TArray<float> DetectorRadius;
+	TArray<uint8> IsPlayerDetected;
+	TArray<TWeakObjectPtr<APlayerCharacter>> DetectedPlayer;
+	TArray<uint32> DetectedFrame;
+	TArray<float> TargetPositionX;
+	TArray<float> StopDistance;
+	TArray<int32> TargetIndex;
+	TArray<uint8> StateFlags;
+	TArray<int8> Facing;
+	TArray<int8> MoveDirection;
+	TArray<EEnemyCrowdAction> Actions;
+
+	FEnemySpatialHash SpatialHash;
+	TArray<int32> DetectionCandidates;
+	float MaxDetectorRadius = 0.0f;
+	uint32 DetectionFrame = 0;
+
+	void RegisterEnemy(AEnemy* Enemy);
+	void UnregisterEnemy(AEnemy* Enemy);
+	int32 GetNumEnemies() const { return Enemies.Num(); }
+
+	FEnemyCrowdTickFunction CrowdTickFunction;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	void Tick(float DeltaTime);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void UpdatePlayerDetection();
+
+	void GatherState();
+	void ResolveActions();
+	void ApplyActions();
+
+	int32 FindOrAddTarget(APlayerCharacter* Target);
+};
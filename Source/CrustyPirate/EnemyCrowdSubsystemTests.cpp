@@ -0,0 +1,347 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyCrowdSubsystem.h"
+#include "Enemy.h"
+#include "PlayerCharacter.h"
+#include "CrustyPirateTestWorld.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// AEnemy::Tick as it was before the crowd took it over, returning its decision instead of acting on it.
+static EEnemyCrowdAction BaselineEnemyTick(const AEnemy* Enemy, int8& OutMoveDirection)
+{
+	OutMoveDirection = 0;
+	if (!Enemy->IsAlive || !Enemy->FollowTarget || Enemy->IsStunned)	return EEnemyCrowdAction::None;
+	float Delta = Enemy->FollowTarget->GetActorLocation().X - Enemy->GetActorLocation().X;
+	OutMoveDirection = Delta > 0.0f ? 1 : -1;
+	if (FMath::Abs(Delta) > Enemy->GetStopDistanceToTarget())
+	{
+		return Enemy->CanMove ? EEnemyCrowdAction::Move : EEnemyCrowdAction::None;
+	}
+	return Enemy->FollowTarget->IsAlive ? EEnemyCrowdAction::Attack : EEnemyCrowdAction::None;
+}
+
+// The same, acting on it: what every enemy used to do in its own tick.
+static void RunBaselineEnemyTick(AEnemy* Enemy)
+{
+	int8 MoveDirection;
+	EEnemyCrowdAction Action = BaselineEnemyTick(Enemy, MoveDirection);
+	if (MoveDirection == 0)	return;
+	Enemy->UpdateDirection(MoveDirection);
+	if (Action == EEnemyCrowdAction::Move)
+	{
+		Enemy->AddMovementInput(FVector(1.0f, 0.0f, 0.0f), MoveDirection);
+	}
+	else if (Action == EEnemyCrowdAction::Attack)
+	{
+		Enemy->Attack();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEnemyCrowdMatchesTickTest, "CrustyPirate.Crowd.MatchesPerActorTick",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FEnemyCrowdMatchesTickTest::RunTest(const FString& Parameters)
+{
+	FCrustyPirateTestWorld TestWorld;
+	UEnemyCrowdSubsystem* Crowd = TestWorld.World->GetSubsystem<UEnemyCrowdSubsystem>();
+	APlayerCharacter* Player = TestWorld.SpawnPlayer(FVector::ZeroVector, false);
+	APlayerCharacter* DeadPlayer = TestWorld.SpawnPlayer(FVector(0.0f, 2000.0f, 0.0f), false);
+	if (!Crowd || !Player || !DeadPlayer)
+	{
+		AddError(TEXT("Could not set up the crowd and players"));
+		return false;
+	}
+	DeadPlayer->IsAlive = false;
+
+	// Every combination of target, side, distance and flags, some right at the stop distance.
+	const int32 NumEnemies = 1000;
+	FRandomStream Random(NumEnemies);
+	TArray<AEnemy*> Enemies;
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		float Distance = (i % 4 == 0) ? Random.FRandRange(0.0f, 100.0f) : Random.FRandRange(0.0f, 3000.0f);
+		float Side = (i & 1) ? -1.0f : 1.0f;
+		AEnemy* Enemy = TestWorld.SpawnEnemy(FVector(Side * Distance, 0.0f, 0.0f));
+		if (!Enemy)
+		{
+			AddError(TEXT("Could not spawn the perf scenario's enemy class"));
+			return false;
+		}
+		int32 Target = Random.RandRange(0, 4);
+		Enemy->FollowTarget = Target == 0 ? nullptr : (Target == 1 ? DeadPlayer : Player);
+		Enemy->IsAlive = Random.FRand() < 0.85f;
+		Enemy->IsStunned = Random.FRand() < 0.15f;
+		Enemy->CanMove = Random.FRand() < 0.8f;
+		Enemy->CanAttack = Random.FRand() < 0.8f;
+		Enemies.Add(Enemy);
+	}
+
+	TArray<EEnemyCrowdAction> ExpectedActions;
+	TArray<int8> ExpectedDirections;
+	TArray<bool> CouldAttack;
+	for (AEnemy* Enemy : Enemies)
+	{
+		int8 MoveDirection;
+		ExpectedActions.Add(BaselineEnemyTick(Enemy, MoveDirection));
+		ExpectedDirections.Add(MoveDirection);
+		CouldAttack.Add(Enemy->CanAttack);
+	}
+	Crowd->Tick(1.0f / 60.0f);
+
+	int32 NumMismatches = 0;
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		AEnemy* Enemy = Enemies[i];
+		int32 Index = Enemy->CrowdIndex;
+		if (!Crowd->Actions.IsValidIndex(Index))
+		{
+			AddError(FString::Printf(TEXT("Enemy %d is not in the crowd"), i));
+			continue;
+		}
+		bool Matches = Crowd->Actions[Index] == ExpectedActions[i] && Crowd->MoveDirection[Index] == ExpectedDirections[i];
+		// What the actor shows for it: facing, movement input and a started attack.
+		if (ExpectedDirections[i] != 0)
+		{
+			Matches &= Enemy->GetActorRotation().Yaw == (ExpectedDirections[i] < 0 ? 180.0f : 0.0f);
+		}
+		float Input = Enemy->GetPendingMovementInputVector().X;
+		Matches &= ExpectedActions[i] == EEnemyCrowdAction::Move ? Input * ExpectedDirections[i] > 0.0f : Input == 0.0f;
+		if (ExpectedActions[i] == EEnemyCrowdAction::Attack && CouldAttack[i])
+		{
+			Matches &= !Enemy->CanAttack;
+		}
+		if (!Matches && NumMismatches++ < 10)
+		{
+			AddError(FString::Printf(TEXT("Enemy %d: crowd action %d direction %d, per-actor tick action %d direction %d"), i,
+				(int32)Crowd->Actions[Index], Crowd->MoveDirection[Index], (int32)ExpectedActions[i], ExpectedDirections[i]));
+		}
+	}
+	TestEqual(TEXT("Enemies deciding differently from the per-actor tick"), NumMismatches, 0);
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEnemyCrowdPerfTest, "CrustyPirate.Perf.EnemyCrowd",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FEnemyCrowdPerfTest::RunTest(const FString& Parameters)
+{
+	// Meant to run headless: -nullrhi -nosound -unattended.
+	const float DeltaTime = 1.0f / 60.0f;
+	const int32 NumFrames = 60;
+	for (int32 NumEnemies : { 1000, 5000, 10000 })
+	{
+		FCrustyPirateTestWorld TestWorld;
+		UEnemyCrowdSubsystem* Crowd = TestWorld.World->GetSubsystem<UEnemyCrowdSubsystem>();
+		APlayerCharacter* Player = TestWorld.SpawnPlayer(FVector::ZeroVector);
+		if (!Crowd || !Player)
+		{
+			AddError(TEXT("Could not set up the crowd and player"));
+			return false;
+		}
+		// Everyone chasing from both sides, out of attack range, so every frame takes the move path.
+		TArray<AEnemy*> Enemies;
+		Enemies.Reserve(NumEnemies);
+		for (int32 i = 0; i < NumEnemies; i++)
+		{
+			float Side = (i & 1) ? -1.0f : 1.0f;
+			AEnemy* Enemy = TestWorld.SpawnEnemy(FVector(Side * (500.0f + (i / 2) * 2.0f), 0.0f, (i % 50) * 200.0f));
+			if (!Enemy)
+			{
+				AddError(TEXT("Could not spawn the perf scenario's enemy class"));
+				return false;
+			}
+			Enemy->FollowTarget = Player;
+			Enemies.Add(Enemy);
+		}
+		TestWorld.Tick(DeltaTime, 5);
+
+		// Leaves out the per-actor tick dispatch the old path also paid for, so it flatters the baseline.
+		double PerActorSeconds = 0.0;
+		double CrowdSeconds = 0.0;
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			double StartTime = FPlatformTime::Seconds();
+			for (AEnemy* Enemy : Enemies)
+			{
+				RunBaselineEnemyTick(Enemy);
+			}
+			PerActorSeconds += FPlatformTime::Seconds() - StartTime;
+			StartTime = FPlatformTime::Seconds();
+			Crowd->Tick(DeltaTime);
+			CrowdSeconds += FPlatformTime::Seconds() - StartTime;
+			for (AEnemy* Enemy : Enemies)
+			{
+				Enemy->ConsumeMovementInputVector();
+			}
+		}
+
+		double StartTime = FPlatformTime::Seconds();
+		TestWorld.Tick(DeltaTime, NumFrames);
+		double WorldTickMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumFrames;
+		AddInfo(FString::Printf(TEXT("%d enemies: crowd update %.3f ms, per-actor decisions %.3f ms, whole world tick %.2f ms per frame"),
+			NumEnemies, CrowdSeconds * 1000.0 / NumFrames, PerActorSeconds * 1000.0 / NumFrames, WorldTickMs));
+	}
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPlayerDetectionPerfTest, "CrustyPirate.Perf.PlayerDetection",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FPlayerDetectionPerfTest::RunTest(const FString& Parameters)
+{
+	// Meant to run headless: -nullrhi -nosound -unattended.
+	const float DeltaTime = 1.0f / 60.0f;
+	const int32 NumFrames = 60;
+	for (int32 NumEnemies : { 100, 1000, 10000 })
+	{
+		double FrameMs[2] = { 0.0, 0.0 };
+		int32 NumChasing[2] = { 0, 0 };
+		for (int32 Spatial = 0; Spatial < 2; Spatial++)
+		{
+			FCrustyPirateTestWorld TestWorld;
+			UEnemyCrowdSubsystem* Crowd = TestWorld.World->GetSubsystem<UEnemyCrowdSubsystem>();
+			if (!Crowd)
+			{
+				AddError(TEXT("Could not set up the crowd"));
+				return false;
+			}
+			// Enemies pick the mode up when they register.
+			Crowd->UseSpatialPlayerDetection = Spatial == 1;
+			APlayerCharacter* Player = TestWorld.SpawnPlayer(FVector::ZeroVector);
+			TArray<AEnemy*> Enemies;
+			Enemies.Reserve(NumEnemies);
+			for (int32 i = 0; i < NumEnemies; i++)
+			{
+				// Spread over a band around the player so only some of them are in range.
+				AEnemy* Enemy = TestWorld.SpawnEnemy(FVector((i % 200 - 100) * 150.0f, 0.0f, (i / 200) * 150.0f));
+				if (!Enemy || !Player)
+				{
+					AddError(TEXT("Could not spawn the perf scenario's enemy and player classes"));
+					return false;
+				}
+				Enemies.Add(Enemy);
+			}
+			if (Spatial == 1)
+			{
+				TestFalse(TEXT("Detector spheres have no collision in spatial mode"), Enemies[0]->PlayerDetectorSphere->IsCollisionEnabled());
+			}
+			TestWorld.Tick(DeltaTime, 5);
+
+			double StartTime = FPlatformTime::Seconds();
+			TestWorld.Tick(DeltaTime, NumFrames);
+			FrameMs[Spatial] = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumFrames;
+			for (AEnemy* Enemy : Enemies)
+			{
+				NumChasing[Spatial] += Enemy->FollowTarget ? 1 : 0;
+			}
+		}
+		AddInfo(FString::Printf(TEXT("%d enemies: sphere overlaps %.2f ms (%d chasing), spatial hash %.2f ms (%d chasing) per frame"),
+			NumEnemies, FrameMs[0], NumChasing[0], FrameMs[1], NumChasing[1]));
+	}
+	return !HasAnyErrors();
+}
+
+// What the crowd's per-frame query needs from an enemy, packed the way it would be stored contiguously.
+struct FPackedCombatFlags
+{
+	int32 HitPoints = 0;
+	uint8 IsAlive : 1 = true;
+	uint8 CanMove : 1 = true;
+	uint8 CanAttack : 1 = true;
+	uint8 IsStunned : 1 = false;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCombatStateLayoutTest, "CrustyPirate.Perf.CombatStateLayout",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FCombatStateLayoutTest::RunTest(const FString& Parameters)
+{
+	const int32 NumCombatants = 10000;
+	const int32 NumPasses = 50;
+	FCrustyPirateTestWorld TestWorld;
+	FRandomStream Random(NumCombatants);
+	TArray<AEnemy*> Enemies;
+	Enemies.Reserve(NumCombatants);
+	for (int32 i = 0; i < NumCombatants; i++)
+	{
+		AEnemy* Enemy = TestWorld.SpawnEnemy(FVector((i % 100) * 500.0f, 0.0f, (i / 100) * 500.0f));
+		if (!Enemy)
+		{
+			AddError(TEXT("Could not spawn the perf scenario's enemy class"));
+			return false;
+		}
+		Enemy->IsAlive = Random.FRand() < 0.9f;
+		Enemy->CanMove = Random.FRand() < 0.8f;
+		Enemy->CanAttack = Random.FRand() < 0.7f;
+		Enemy->IsStunned = Random.FRand() < 0.1f;
+		Enemy->HitPoints = Random.RandRange(1, 100);
+		Enemies.Add(Enemy);
+	}
+	// Actors in a level are not visited in allocation order.
+	for (int32 i = NumCombatants - 1; i > 0; i--)
+	{
+		Enemies.Swap(i, Random.RandRange(0, i));
+	}
+	TArray<FPackedCombatFlags> Packed;
+	Packed.Reserve(NumCombatants);
+	for (const AEnemy* Enemy : Enemies)
+	{
+		FPackedCombatFlags& Flags = Packed.AddDefaulted_GetRef();
+		Flags.HitPoints = Enemy->HitPoints;
+		Flags.IsAlive = Enemy->IsAlive;
+		Flags.CanMove = Enemy->CanMove;
+		Flags.CanAttack = Enemy->CanAttack;
+		Flags.IsStunned = Enemy->IsStunned;
+	}
+
+	// Movers, attackers and the HP left, as the crowd and combat passes ask every frame.
+	int64 ActorResult = 0;
+	double ActorSeconds = UE_BIG_NUMBER;
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		double StartTime = FPlatformTime::Seconds();
+		int32 NumMovers = 0;
+		int32 NumAttackers = 0;
+		int64 TotalHitPoints = 0;
+		for (const AEnemy* Enemy : Enemies)
+		{
+			if (!Enemy->IsAlive)	continue;
+			NumMovers += Enemy->CanMove && !Enemy->IsStunned;
+			NumAttackers += Enemy->CanAttack && !Enemy->IsStunned;
+			TotalHitPoints += Enemy->HitPoints;
+		}
+		ActorSeconds = FMath::Min(ActorSeconds, FPlatformTime::Seconds() - StartTime);
+		ActorResult = TotalHitPoints * 3 + NumMovers * 5 + NumAttackers * 7;
+	}
+
+	int64 PackedResult = 0;
+	double PackedSeconds = UE_BIG_NUMBER;
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		double StartTime = FPlatformTime::Seconds();
+		int32 NumMovers = 0;
+		int32 NumAttackers = 0;
+		int64 TotalHitPoints = 0;
+		for (const FPackedCombatFlags& Flags : Packed)
+		{
+			if (!Flags.IsAlive)	continue;
+			NumMovers += Flags.CanMove && !Flags.IsStunned;
+			NumAttackers += Flags.CanAttack && !Flags.IsStunned;
+			TotalHitPoints += Flags.HitPoints;
+		}
+		PackedSeconds = FMath::Min(PackedSeconds, FPlatformTime::Seconds() - StartTime);
+		PackedResult = TotalHitPoints * 3 + NumMovers * 5 + NumAttackers * 7;
+	}
+
+	double ActorNs = ActorSeconds * 1.0e9 / NumCombatants;
+	double PackedNs = PackedSeconds * 1.0e9 / NumCombatants;
+	AddInfo(FString::Printf(TEXT("%d spawned enemies, best of %d passes: actor fields %.2f ns per combatant (%d-byte actors), packed %.2f ns per combatant (%d bytes each), %.1fx"),
+		NumCombatants, NumPasses, ActorNs, (int32)Enemies[0]->GetClass()->GetStructureSize(), PackedNs, (int32)sizeof(FPackedCombatFlags), PackedNs > 0.0 ? ActorNs / PackedNs : 0.0));
+	TestEqual(TEXT("Both layouts give the same answer"), PackedResult, ActorResult);
+	return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemySpatialHash.h"
+
+FIntPoint FEnemySpatialHash::GetCell(float X, float Z) const
+{
+	return FIntPoint(FMath::FloorToInt(X / CellSize), FMath::FloorToInt(Z / CellSize));
+}
+
+void FEnemySpatialHash::Add(int32 Id, float X, float Z)
+{
+	FIntPoint Cell = GetCell(X, Z);
+	if (EntryCells.Num() <= Id)
+	{
+		EntryCells.SetNum(Id + 1);
+	}
+	EntryCells[Id] = Cell;
+	Cells.FindOrAdd(Cell).Add(Id);
+}
+
+void FEnemySpatialHash::Remove(int32 Id)
+{
+	if (!EntryCells.IsValidIndex(Id))	return;
+	if (TArray<int32>* Bucket = Cells.Find(EntryCells[Id]))
+	{
+		Bucket->RemoveSingleSwap(Id, EAllowShrinking::No);
+	}
+}
+
+void FEnemySpatialHash::Update(int32 Id, float X, float Z)
+{
+	FIntPoint Cell = GetCell(X, Z);
+	if (EntryCells[Id] == Cell)	return;
+	Remove(Id);
+	EntryCells[Id] = Cell;
+	Cells.FindOrAdd(Cell).Add(Id);
+}
+
+void FEnemySpatialHash::Relabel(int32 OldId, int32 NewId)
+{
+	if (!EntryCells.IsValidIndex(OldId))	return;
+	FIntPoint Cell = EntryCells[OldId];
+	if (TArray<int32>* Bucket = Cells.Find(Cell))
+	{
+		int32 Slot = Bucket->Find(OldId);
+		if (Slot != INDEX_NONE)
+		{
+			(*Bucket)[Slot] = NewId;
+		}
+	}
+	EntryCells[NewId] = Cell;
+}
+
+void FEnemySpatialHash::Reset()
+{
+	Cells.Reset();
+	EntryCells.Reset();
+}
+
+void FEnemySpatialHash::Query(float X, float Z, float Radius, TArray<int32>& OutIds) const
+{
+	FIntPoint Min = GetCell(X - Radius, Z - Radius);
+	FIntPoint Max = GetCell(X + Radius, Z + Radius);
+	for (int32 CellX = Min.X; CellX <= Max.X; CellX++)
+	{
+		for (int32 CellZ = Min.Y; CellZ <= Max.Y; CellZ++)
+		{
+			if (const TArray<int32>* Bucket = Cells.Find(FIntPoint(CellX, CellZ)))
+			{
+				OutIds.Append(*Bucket);
+			}
+		}
+	}
+}
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform 2D grid over the X/Z plane. Entries are small integer ids (the crowd index of an enemy)
+ * and only change bucket when they cross a cell boundary.
+ */
+class CRUSTYPIRATE_API FEnemySpatialHash
+{
+public:
+	float CellSize = 512.0f;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+	TArray<FIntPoint> EntryCells;
+
+	FIntPoint GetCell(float X, float Z) const;
+
+	void Add(int32 Id, float X, float Z);
+	void Remove(int32 Id);
+	void Update(int32 Id, float X, float Z);
+	void Relabel(int32 OldId, int32 NewId);
+	void Reset();
+
+	void Query(float X, float Z, float Radius, TArray<int32>& OutIds) const;
+};
@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAudioSubsystem.h"
+#include "CrustyPiratePerf.h"
+#include "Components/AudioComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundBase.h"
+
+void FGameplayAudioVoices::Init(int32 PoolSize)
+{
+	Voices.SetNum(PoolSize);
+	Sounds.Reserve(16);
+}
+
+int32 FGameplayAudioVoices::Request(const USoundBase* Sound, float Duration, double Now)
+{
+	FrameRequests++;
+	FGameplayAudioSoundState& State = Sounds.FindOrAdd(Sound);
+	if (Now - State.LastStartTime < CoalesceWindow)
+	{
+		FrameCoalesced++;
+		return INDEX_NONE;
+	}
+	if (State.ActiveVoices >= MaxVoicesPerSound)
+	{
+		FrameCapped++;
+		return INDEX_NONE;
+	}
+
+	int32 Slot = INDEX_NONE;
+	double EarliestEndTime = UE_BIG_NUMBER;
+	for (int32 i = 0; i < Voices.Num(); i++)
+	{
+		if (!Voices[i].Sound)
+		{
+			Slot = i;
+			break;
+		}
+		if (Voices[i].EndTime < EarliestEndTime)
+		{
+			EarliestEndTime = Voices[i].EndTime;
+			Slot = i;
+		}
+	}
+	if (Slot == INDEX_NONE)	return INDEX_NONE;
+	if (Voices[Slot].Sound)
+	{
+		Release(Slot);
+		FrameStolen++;
+	}
+
+	Voices[Slot].Sound = Sound;
+	Voices[Slot].EndTime = Now + Duration;
+	State.LastStartTime = Now;
+	State.ActiveVoices++;
+	NumActive++;
+	FrameStarted++;
+	return Slot;
+}
+
+void FGameplayAudioVoices::Release(int32 Slot)
+{
+	FGameplayAudioVoice& Voice = Voices[Slot];
+	if (!Voice.Sound)	return;
+	if (FGameplayAudioSoundState* State = Sounds.Find(Voice.Sound))
+	{
+		State->ActiveVoices--;
+	}
+	Voice.Sound = nullptr;
+	NumActive--;
+}
+
+void FGameplayAudioVoices::ReleaseFinished(double Now)
+{
+	for (int32 i = 0; i < Voices.Num(); i++)
+	{
+		if (Voices[i].Sound && Voices[i].EndTime <= Now)
+		{
+			Release(i);
+		}
+	}
+}
+
+void FGameplayAudioVoices::ResetFrameStats()
+{
+	FrameRequests = 0;
+	FrameStarted = 0;
+	FrameCoalesced = 0;
+	FrameCapped = 0;
+	FrameStolen = 0;
+}
+
+void UGameplayAudioSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Voices.CoalesceWindow = CoalesceWindow;
+	Voices.MaxVoicesPerSound = MaxVoicesPerSound;
+	Voices.Init(PoolSize);
+}
+
+void UGameplayAudioSubsystem::Deinitialize()
+{
+	for (UAudioComponent* Component : Components)
+	{
+		if (!Component)	continue;
+		Component->Stop();
+		Component->UnregisterComponent();
+		Component->DestroyComponent();
+	}
+	Components.Empty();
+	Super::Deinitialize();
+}
+
+void UGameplayAudioSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	// Without an audio device (-nosound, -nullrhi runs) voices are still tracked, just not played.
+	if (!UseAudioDispatcher || !GEngine || !GEngine->UseSound())	return;
+	Components.Reserve(PoolSize);
+	for (int32 i = 0; i < PoolSize; i++)
+	{
+		UAudioComponent* Component = NewObject<UAudioComponent>(this);
+		Component->bAutoActivate = false;
+		Component->bAutoDestroy = false;
+		Component->bAllowSpatialization = false;
+		Component->RegisterComponentWithWorld(&InWorld);
+		Components.Add(Component);
+	}
+}
+
+void UGameplayAudioSubsystem::PlaySound(USoundBase* Sound)
+{
+	if (!Sound)	return;
+	float Duration = FMath::Min(Sound->GetDuration(), MaxVoiceDuration);
+	int32 Slot = Voices.Request(Sound, Duration, GetWorld()->GetAudioTimeSeconds());
+	if (Slot == INDEX_NONE || !Components.IsValidIndex(Slot))	return;
+	// Setting a new sound stops whatever the component was still playing.
+	UAudioComponent* Component = Components[Slot];
+	Component->SetSound(Sound);
+	Component->Play();
+}
+
+void UGameplayAudioSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	Voices.ReleaseFinished(GetWorld()->GetAudioTimeSeconds());
+	CRUSTYPIRATE_SET_COUNTER(ActiveVoices, Voices.NumActive);
+	CRUSTYPIRATE_SET_COUNTER(SoundRequests, Voices.FrameRequests);
+	CRUSTYPIRATE_SET_COUNTER(CoalescedSounds, Voices.FrameCoalesced);
+	CRUSTYPIRATE_SET_COUNTER(CappedSounds, Voices.FrameCapped);
+	Voices.ResetFrameStats();
+}
+
+TStatId UGameplayAudioSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplayAudioSubsystem, STATGROUP_Tickables);
+}
+
+bool UGameplayAudioSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+#if UE_SERVER
+	return false;
+#else
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+#endif
+}
+
+void UGameplayAudioSubsystem::PlaySound2D(const UObject* WorldContextObject, USoundBase* Sound)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	UGameplayAudioSubsystem* Audio = World ? World->GetSubsystem<UGameplayAudioSubsystem>() : nullptr;
+	if (Audio && Audio->UseAudioDispatcher)
+	{
+		Audio->PlaySound(Sound);
+	}
+	else
+	{
+		UGameplayStatics::PlaySound2D(WorldContextObject, Sound);
+	}
+}
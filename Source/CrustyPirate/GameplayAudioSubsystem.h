@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayAudioSubsystem.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+struct FGameplayAudioVoice
+{
+	const USoundBase* Sound = nullptr;
+	double EndTime = 0.0;
+};
+
+struct FGameplayAudioSoundState
+{
+	double LastStartTime = -UE_BIG_NUMBER;
+	int32 ActiveVoices = 0;
+};
+
+/**
+ * Voice bookkeeping of UGameplayAudioSubsystem, kept free of UObjects so the automation test can
+ * drive it with simulated time. Slots map one to one onto the subsystem's audio components.
+ */
+class CRUSTYPIRATE_API FGameplayAudioVoices
+{
+public:
+	float CoalesceWindow = 0.05f;
+	int32 MaxVoicesPerSound = 3;
+
+	TArray<FGameplayAudioVoice> Voices;
+	TMap<const USoundBase*, FGameplayAudioSoundState> Sounds;
+	int32 NumActive = 0;
+
+	int32 FrameRequests = 0;
+	int32 FrameStarted = 0;
+	int32 FrameCoalesced = 0;
+	int32 FrameCapped = 0;
+	int32 FrameStolen = 0;
+
+	void Init(int32 PoolSize);
+	// Returns the slot to play Sound in, or INDEX_NONE when the request is coalesced or over the cap.
+	// When every slot is busy the voice closest to finishing is stolen.
+	int32 Request(const USoundBase* Sound, float Duration, double Now);
+	void Release(int32 Slot);
+	void ReleaseFinished(double Now);
+	void ResetFrameStats();
+};
+
+/**
+ * Plays the 2D gameplay sounds (pickups, doors) through a fixed pool of audio components. Identical sounds
+ * requested within CoalesceWindow of each other play once, and no sound plays more than
+ * MaxVoicesPerSound times at once, so sweeping through a line of diamonds starts a handful of voices
+ * instead of one per item. Voice counts per frame go to "stat CrustyPirate".
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UGameplayAudioSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	bool UseAudioDispatcher = true;
+
+	UPROPERTY(Config)
+	int32 PoolSize = 16;
+
+	UPROPERTY(Config)
+	int32 MaxVoicesPerSound = 3;
+
+	UPROPERTY(Config)
+	float CoalesceWindow = 0.05f;
+
+	// Upper bound on how long a voice holds its slot, for looping or unknown length sounds.
+	UPROPERTY(Config)
+	float MaxVoiceDuration = 5.0f;
+
+	UPROPERTY()
+	TArray<UAudioComponent*> Components;
+
+	FGameplayAudioVoices Voices;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	void PlaySound(USoundBase* Sound);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Falls back to UGameplayStatics::PlaySound2D when the world has no dispatcher.
+	static void PlaySound2D(const UObject* WorldContextObject, USoundBase* Sound);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
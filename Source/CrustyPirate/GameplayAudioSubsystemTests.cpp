@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAudioSubsystem.h"
+#include "PerfScenarioSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Sound/SoundWave.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGameplayAudioVoiceCapTest, "CrustyPirate.Audio.VoiceCap",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FGameplayAudioVoiceCapTest::RunTest(const FString& Parameters)
+{
+	const UGameplayAudioSubsystem* Settings = GetDefault<UGameplayAudioSubsystem>();
+	FGameplayAudioVoices Voices;
+	Voices.CoalesceWindow = Settings->CoalesceWindow;
+	Voices.MaxVoicesPerSound = Settings->MaxVoicesPerSound;
+	Voices.Init(Settings->PoolSize);
+
+	// Sweeping through a line of diamonds: 20 pickups a frame of a 0.4 second sound. Any object works as the key.
+	const USoundBase* PickupSound = GetDefault<USoundWave>();
+	const float PickupDuration = 0.4f;
+	const int32 NumPickups = 10000;
+	const int32 PickupsPerFrame = 20;
+	const double FrameTime = 1.0 / 60.0;
+
+	bool WasCounting = UPerfScenarioSubsystem::GetAllocationCount() >= 0;
+	UPerfScenarioSubsystem::StartCountingAllocations();
+	int32 MaxVoices = 0;
+	int32 NumStarted = 0;
+	int64 StartAllocations = 0;
+	double Now = 0.0;
+	for (int32 Sent = 0, Frame = 0; Sent < NumPickups; Frame++)
+	{
+		// The first frame adds the sound to the map.
+		if (Frame == 1)
+		{
+			StartAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount();
+		}
+		Voices.ReleaseFinished(Now);
+		for (int32 i = 0; i < PickupsPerFrame && Sent < NumPickups; i++, Sent++)
+		{
+			Voices.Request(PickupSound, PickupDuration, Now);
+		}
+		NumStarted += Voices.FrameStarted;
+		MaxVoices = FMath::Max(MaxVoices, Voices.NumActive);
+		Voices.ResetFrameStats();
+		Now += FrameTime;
+	}
+	int64 Allocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount() - StartAllocations;
+	if (!WasCounting)
+	{
+		UPerfScenarioSubsystem::StopCountingAllocations();
+	}
+
+	TestTrue(TEXT("Voices were started"), NumStarted > 0);
+	TestTrue(TEXT("Coalescing starts fewer voices than pickups"), NumStarted < NumPickups);
+	TestTrue(TEXT("Voices stay within the per sound cap"), MaxVoices <= FMath::Min(Settings->MaxVoicesPerSound, Settings->PoolSize));
+	TestEqual(TEXT("No allocations after the first frame"), Allocations, (int64)0);
+	return !HasAnyErrors();
+}
+
+#endif
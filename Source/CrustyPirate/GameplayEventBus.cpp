@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayEventBus.h"
+#include "CrustyPirate.h"
+#include "CrustyPirateGameInstance.h"
+
+static FAutoConsoleCommandWithWorld EventBusStatsCommand(
+	TEXT("CrustyPirate.EventBusStats"),
+	TEXT("Logs published, dispatched and dropped gameplay events."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UGameplayEventBus* EventBus = GameInstance ? GameInstance->GetSubsystem<UGameplayEventBus>() : nullptr)
+		{
+			EventBus->LogStats();
+		}
+	}));
+
+void UGameplayEventBus::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Queue = MakeUnique<FGameplayEventQueue>(QueueCapacity);
+	// Fan-out never grows past this in practice.
+	Consumers.Reserve(8);
+}
+
+void UGameplayEventBus::Deinitialize()
+{
+	DispatchEvents();
+	Consumers.Reset();
+	Super::Deinitialize();
+}
+
+bool UGameplayEventBus::Publish(const FGameplayEvent& Event)
+{
+	if (!Queue->Push(Event))
+	{
+		NumDropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	NumPublished.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void UGameplayEventBus::AddConsumer(FGameplayEventQueue* Consumer)
+{
+	check(IsInGameThread());
+	Consumers.AddUnique(Consumer);
+}
+
+void UGameplayEventBus::RemoveConsumer(FGameplayEventQueue* Consumer)
+{
+	check(IsInGameThread());
+	Consumers.RemoveSingleSwap(Consumer, EAllowShrinking::No);
+}
+
+void UGameplayEventBus::DispatchEvents()
+{
+	// At most one ring's worth of events per frame, so listeners that keep publishing cannot starve the frame.
+	int32 Budget = Queue->GetCapacity();
+	FGameplayEvent Event;
+	while (Budget-- > 0 && Queue->Pop(Event))
+	{
+		NumDispatched++;
+		Listeners[(int32)Event.Type].Broadcast(Event);
+		for (FGameplayEventQueue* Consumer : Consumers)
+		{
+			if (!Consumer->Push(Event))
+			{
+				NumDropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+}
+
+void UGameplayEventBus::Tick(float DeltaTime)
+{
+	DispatchEvents();
+}
+
+TStatId UGameplayEventBus::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplayEventBus, STATGROUP_Tickables);
+}
+
+ETickableTickType UGameplayEventBus::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+void UGameplayEventBus::LogStats() const
+{
+	UE_LOG(LogCrustyPirate, Display, TEXT("Event bus: %lld published, %lld dispatched, %lld dropped, %d consumers, capacity %u"),
+		NumPublished.load(), NumDispatched, NumDropped.load(), Consumers.Num(), Queue->GetCapacity());
+}
+
+void UGameplayEventBus::PublishEvent(const UObject* WorldContextObject, EGameplayEventType Type, const AActor* Source, const AActor* Target, int32 Value, uint8 SubType)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	UGameplayEventBus* EventBus = GameInstance ? GameInstance->GetSubsystem<UGameplayEventBus>() : nullptr;
+	if (!EventBus || !EventBus->HasListeners(Type))	return;
+
+	FGameplayEvent Event = MakeEvent(Type, Source, Target, Value);
+	Event.SubType = SubType;
+	EventBus->Publish(Event);
+}
+
+FGameplayEvent UGameplayEventBus::MakeEvent(EGameplayEventType Type, const AActor* Source, const AActor* Target, int32 Value)
+{
+	FGameplayEvent Event;
+	Event.Type = Type;
+	Event.Value = Value;
+	Event.SourceId = Source ? Source->GetUniqueID() : 0;
+	Event.TargetId = Target ? Target->GetUniqueID() : 0;
+	const AActor* Located = Target ? Target : Source;
+	if (Located)
+	{
+		FVector Location = Located->GetActorLocation();
+		Event.X = Location.X;
+		Event.Z = Location.Z;
+		if (UCrustyPirateGameInstance* GameInstance = Cast<UCrustyPirateGameInstance>(Located->GetGameInstance()))
+		{
+			Event.LevelIndex = GameInstance->CurrentLevelIndex;
+		}
+	}
+	Event.Time = FPlatformTime::Seconds();
+	return Event;
+}
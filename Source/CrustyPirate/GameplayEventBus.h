@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "GameplayEventQueue.h"
+#include "GameplayEventBus.generated.h"
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnGameplayEvent, const FGameplayEvent&);
+
+/**
+ * Typed gameplay event bus. Publish may be called from any thread and only pushes into a lock-free ring.
+ * Once per frame the game thread drains the ring, broadcasts to the per-type delegates and copies every
+ * event into the queues of registered consumers, which worker threads (save, analytics, audio) drain on
+ * their own. Nothing is allocated after startup.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UGameplayEventBus : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	int32 QueueCapacity = 4096;
+
+	TUniquePtr<FGameplayEventQueue> Queue;
+	FOnGameplayEvent Listeners[(int32)EGameplayEventType::Count];
+	TArray<FGameplayEventQueue*> Consumers;
+
+	std::atomic<int64> NumPublished{0};
+	std::atomic<int64> NumDropped{0};
+	int64 NumDispatched = 0;
+
+	bool Publish(const FGameplayEvent& Event);
+	FOnGameplayEvent& OnEvent(EGameplayEventType Type) { return Listeners[(int32)Type]; }
+	// Game thread only. False when an event of this type would be dropped without anyone seeing it.
+	bool HasListeners(EGameplayEventType Type) const { return Consumers.Num() > 0 || Listeners[(int32)Type].IsBound(); }
+
+	// Game thread only. The consumer owns the queue and must remove it before destroying it.
+	void AddConsumer(FGameplayEventQueue* Consumer);
+	void RemoveConsumer(FGameplayEventQueue* Consumer);
+
+	void DispatchEvents();
+	void LogStats() const;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+
+	// Convenience for gameplay code on the game thread. The event is only built when something listens for
+	// its type; does nothing when the object has no game instance.
+	static void PublishEvent(const UObject* WorldContextObject, EGameplayEventType Type, const AActor* Source, const AActor* Target, int32 Value, uint8 SubType = 0);
+	static FGameplayEvent MakeEvent(EGameplayEventType Type, const AActor* Source, const AActor* Target, int32 Value);
+};
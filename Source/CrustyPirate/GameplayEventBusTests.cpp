@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayEventBus.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Queue.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGameplayEventBusThroughputTest, "CrustyPirate.Perf.EventBusThroughput",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FGameplayEventBusThroughputTest::RunTest(const FString& Parameters)
+{
+	const int32 NumProducers = 4;
+	const int32 EventsPerProducer = 1000000;
+	const int64 Total = (int64)NumProducers * EventsPerProducer;
+
+	// Producers spin on a full ring and the consumer spins on an empty one, so this measures the
+	// queue and not the scheduler.
+	FGameplayEventQueue Ring(4096);
+	double StartTime = FPlatformTime::Seconds();
+	TFuture<int64> RingConsumer = Async(EAsyncExecution::Thread, [&Ring, Total]()
+	{
+		int64 Sum = 0;
+		FGameplayEvent Event;
+		for (int64 Popped = 0; Popped < Total;)
+		{
+			if (Ring.Pop(Event))
+			{
+				Sum += Event.Value;
+				Popped++;
+			}
+			else
+			{
+				FPlatformProcess::YieldThread();
+			}
+		}
+		return Sum;
+	});
+	ParallelFor(NumProducers, [&Ring, EventsPerProducer](int32 Producer)
+	{
+		FGameplayEvent Event;
+		Event.Type = EGameplayEventType::DamageApplied;
+		Event.Value = 1;
+		for (int32 i = 0; i < EventsPerProducer; i++)
+		{
+			while (!Ring.Push(Event))
+			{
+				FPlatformProcess::YieldThread();
+			}
+		}
+	});
+	int64 RingSum = RingConsumer.Get();
+	double RingSeconds = FPlatformTime::Seconds() - StartTime;
+
+	TQueue<FGameplayEvent, EQueueMode::Mpsc> NodeQueue;
+	StartTime = FPlatformTime::Seconds();
+	TFuture<int64> QueueConsumer = Async(EAsyncExecution::Thread, [&NodeQueue, Total]()
+	{
+		int64 Sum = 0;
+		FGameplayEvent Event;
+		for (int64 Popped = 0; Popped < Total;)
+		{
+			if (NodeQueue.Dequeue(Event))
+			{
+				Sum += Event.Value;
+				Popped++;
+			}
+			else
+			{
+				FPlatformProcess::YieldThread();
+			}
+		}
+		return Sum;
+	});
+	ParallelFor(NumProducers, [&NodeQueue, EventsPerProducer](int32 Producer)
+	{
+		FGameplayEvent Event;
+		Event.Type = EGameplayEventType::DamageApplied;
+		Event.Value = 1;
+		for (int32 i = 0; i < EventsPerProducer; i++)
+		{
+			NodeQueue.Enqueue(Event);
+		}
+	});
+	int64 QueueSum = QueueConsumer.Get();
+	double QueueSeconds = FPlatformTime::Seconds() - StartTime;
+
+	AddInfo(FString::Printf(TEXT("%d producers x %d events: ring %.1f M events/s, TQueue %.1f M events/s"),
+		NumProducers, EventsPerProducer, Total / RingSeconds / 1000000.0, Total / QueueSeconds / 1000000.0));
+	TestEqual(TEXT("Every event made it through the ring"), RingSum, Total);
+	TestEqual(TEXT("Every event made it through the TQueue"), QueueSum, Total);
+	return !HasAnyErrors();
+}
+
+#endif
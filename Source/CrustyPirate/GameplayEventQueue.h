@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <type_traits>
+
+enum class EGameplayEventType : uint8
+{
+	ItemCollected,
+	DamageApplied,
+	EnemyDefeated,
+	PlayerDied,
+	LevelExitReached,
+	LevelChanged,
+	Count
+};
+
+/**
+ * Plain data only: events are copied between threads and consumers must not touch UObjects,
+ * so actors are referred to by their UObject unique id.
+ */
+struct FGameplayEvent
+{
+	EGameplayEventType Type = EGameplayEventType::Count;
+	// CollectableType for ItemCollected.
+	uint8 SubType = 0;
+	int32 Value = 0;
+	int32 LevelIndex = 0;
+	uint32 SourceId = 0;
+	uint32 TargetId = 0;
+	float X = 0.0f;
+	float Z = 0.0f;
+	double Time = 0.0;
+};
+
+static_assert(std::is_trivially_copyable_v<FGameplayEvent>, "FGameplayEvent must stay trivially copyable");
+
+/**
+ * Bounded lock-free multi-producer multi-consumer ring (per-cell sequence numbers). All storage is
+ * allocated up front, Push fails instead of growing when the ring is full.
+ */
+class FGameplayEventQueue
+{
+public:
+	explicit FGameplayEventQueue(uint32 InCapacity)
+	{
+		uint32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InCapacity, 2u));
+		Mask = Capacity - 1;
+		Cells = MakeUnique<FCell[]>(Capacity);
+		for (uint32 i = 0; i < Capacity; i++)
+		{
+			Cells[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	uint32 GetCapacity() const { return Mask + 1; }
+
+	bool Push(const FGameplayEvent& Event)
+	{
+		uint32 Pos = EnqueuePos.load(std::memory_order_relaxed);
+		FCell* Cell;
+		for (;;)
+		{
+			Cell = &Cells[Pos & Mask];
+			uint32 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+			int32 Diff = (int32)(Sequence - Pos);
+			if (Diff == 0)
+			{
+				if (EnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))	break;
+			}
+			else if (Diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				Pos = EnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		Cell->Event = Event;
+		Cell->Sequence.store(Pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(FGameplayEvent& OutEvent)
+	{
+		uint32 Pos = DequeuePos.load(std::memory_order_relaxed);
+		FCell* Cell;
+		for (;;)
+		{
+			Cell = &Cells[Pos & Mask];
+			uint32 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+			int32 Diff = (int32)(Sequence - (Pos + 1));
+			if (Diff == 0)
+			{
+				if (DequeuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))	break;
+			}
+			else if (Diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				Pos = DequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+		OutEvent = Cell->Event;
+		Cell->Sequence.store(Pos + Mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct FCell
+	{
+		std::atomic<uint32> Sequence;
+		FGameplayEvent Event;
+	};
+
+	TUniquePtr<FCell[]> Cells;
+	uint32 Mask = 0;
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> EnqueuePos{0};
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> DequeuePos{0};
+};
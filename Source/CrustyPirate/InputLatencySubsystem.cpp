@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InputLatencySubsystem.h"
+#include "CrustyPirate.h"
+#include "CrustyPiratePerf.h"
+#include "Framework/Application/IInputProcessor.h"
+#include "Framework/Application/SlateApplication.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input Latency Move (ms)"), STAT_CP_InputLatencyMove, STATGROUP_CrustyPirate);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input Latency Jump (ms)"), STAT_CP_InputLatencyJump, STATGROUP_CrustyPirate);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input Latency Attack (ms)"), STAT_CP_InputLatencyAttack, STATGROUP_CrustyPirate);
+
+static FAutoConsoleCommandWithWorld InputLatencyCsvCommand(
+	TEXT("CrustyPirate.InputLatencyCsv"),
+	TEXT("Logs input latency per action and writes every recorded sample to Saved/Profiling/CrustyPirate as CSV."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UInputLatencySubsystem* InputLatency = GameInstance ? GameInstance->GetSubsystem<UInputLatencySubsystem>() : nullptr)
+		{
+			InputLatency->LogStats();
+			InputLatency->WriteCsv();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs LowLatencyInputCommand(
+	TEXT("CrustyPirate.LowLatencyInput"),
+	TEXT("Turns low latency input mode on (1) or off (0)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UInputLatencySubsystem* InputLatency = GameInstance ? GameInstance->GetSubsystem<UInputLatencySubsystem>() : nullptr)
+		{
+			InputLatency->SetLowLatencyMode(Args.Num() > 0 ? FCString::Atoi(*Args[0]) != 0 : !InputLatency->UseLowLatencyMode);
+		}
+	}));
+
+/** Sees every input event before the viewport and Enhanced Input do, and never consumes it. */
+class FInputLatencyProcessor : public IInputProcessor
+{
+public:
+	TWeakObjectPtr<UInputLatencySubsystem> Owner;
+	TMap<FKey, float> AnalogValues;
+
+	explicit FInputLatencyProcessor(UInputLatencySubsystem* InOwner) : Owner(InOwner) {}
+
+	virtual void Tick(const float DeltaTime, FSlateApplication& SlateApp, TSharedRef<ICursor> Cursor) override {}
+
+	virtual bool HandleKeyDownEvent(FSlateApplication& SlateApp, const FKeyEvent& InKeyEvent) override
+	{
+		if (!InKeyEvent.IsRepeat())
+		{
+			Note();
+		}
+		return false;
+	}
+
+	virtual bool HandleMouseButtonDownEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent) override
+	{
+		Note();
+		return false;
+	}
+
+	virtual bool HandleAnalogInputEvent(FSlateApplication& SlateApp, const FAnalogInputEvent& InAnalogInputEvent) override
+	{
+		// Sticks report every frame; only leaving the dead zone counts as a new input.
+		float Value = FMath::Abs(InAnalogInputEvent.GetAnalogValue());
+		float& LastValue = AnalogValues.FindOrAdd(InAnalogInputEvent.GetKey());
+		if (LastValue < 0.5f && Value >= 0.5f)
+		{
+			Note();
+		}
+		LastValue = Value;
+		return false;
+	}
+
+	virtual const TCHAR* GetDebugName() const override { return TEXT("CrustyPirateInputLatency"); }
+
+private:
+	void Note()
+	{
+		if (UInputLatencySubsystem* InputLatency = Owner.Get())
+		{
+			InputLatency->NoteInputEvent(FPlatformTime::Seconds());
+		}
+	}
+};
+
+void UInputLatencySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PendingInputTimes.Reserve(16);
+	Samples.Reserve(MaxSamples);
+	if (FSlateApplication::IsInitialized())
+	{
+		InputProcessor = MakeShared<FInputLatencyProcessor>(this);
+		FSlateApplication::Get().RegisterInputPreProcessor(InputProcessor, 0);
+	}
+	FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UInputLatencySubsystem::OnWorldPostActorTick);
+	if (IConsoleVariable* ThreadLag = IConsoleManager::Get().FindConsoleVariable(TEXT("r.OneFrameThreadLag")))
+	{
+		DefaultOneFrameThreadLag = ThreadLag->GetInt();
+	}
+	SetLowLatencyMode(UseLowLatencyMode || FParse::Param(FCommandLine::Get(), TEXT("LowLatencyInput")));
+}
+
+void UInputLatencySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.RemoveAll(this);
+	if (InputProcessor.IsValid() && FSlateApplication::IsInitialized())
+	{
+		FSlateApplication::Get().UnregisterInputPreProcessor(InputProcessor);
+	}
+	InputProcessor.Reset();
+	Super::Deinitialize();
+}
+
+void UInputLatencySubsystem::SetLowLatencyMode(bool Enabled)
+{
+	UseLowLatencyMode = Enabled;
+	if (IConsoleVariable* ThreadLag = IConsoleManager::Get().FindConsoleVariable(TEXT("r.OneFrameThreadLag")))
+	{
+		ThreadLag->Set(Enabled ? 0 : DefaultOneFrameThreadLag, ECVF_SetByCode);
+	}
+	UE_LOG(LogCrustyPirate, Log, TEXT("Low latency input %s"), Enabled ? TEXT("on") : TEXT("off"));
+}
+
+void UInputLatencySubsystem::NoteInputEvent(double Time)
+{
+	if (PendingInputTimes.Num() >= 16)
+	{
+		PendingInputTimes.RemoveAt(0, 1, EAllowShrinking::No);
+	}
+	PendingInputTimes.Add(Time);
+}
+
+void UInputLatencySubsystem::NoteActionHandled(EInputLatencyAction Action)
+{
+	double Now = FPlatformTime::Seconds();
+	if (Action == EInputLatencyAction::Move)
+	{
+		// Move triggers every frame while held; only the first frame of a press is an input to measure.
+		bool IsHeld = LastMoveFrame + 1 >= GFrameCounter;
+		LastMoveFrame = GFrameCounter;
+		if (IsHeld)	return;
+	}
+
+	// Match the oldest input event that is still recent enough to have caused this action.
+	int32 Stale = 0;
+	while (Stale < PendingInputTimes.Num() && Now - PendingInputTimes[Stale] > MaxInputAge)
+	{
+		Stale++;
+	}
+	PendingInputTimes.RemoveAt(0, Stale, EAllowShrinking::No);
+	if (PendingInputTimes.Num() == 0)	return;
+
+	ActionInputTime[(int32)Action] = PendingInputTimes[0];
+	ActionHandledTime[(int32)Action] = Now;
+	PendingInputTimes.RemoveAt(0, 1, EAllowShrinking::No);
+}
+
+void UInputLatencySubsystem::NoteActionEffect(EInputLatencyAction Action)
+{
+	if (ActionInputTime[(int32)Action] <= 0.0)	return;
+	AddSample(Action, FPlatformTime::Seconds());
+}
+
+void UInputLatencySubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	// Character movement has ticked after the controller by now, so the input has moved the player.
+	for (EInputLatencyAction Action : { EInputLatencyAction::Move, EInputLatencyAction::Jump })
+	{
+		NoteActionEffect(Action);
+	}
+}
+
+void UInputLatencySubsystem::AddSample(EInputLatencyAction Action, double EffectTime)
+{
+	FInputLatencySample Sample;
+	Sample.Action = Action;
+	Sample.Frame = GFrameCounter;
+	Sample.HandlerMs = (ActionHandledTime[(int32)Action] - ActionInputTime[(int32)Action]) * 1000.0;
+	Sample.EffectMs = (EffectTime - ActionInputTime[(int32)Action]) * 1000.0;
+	Sample.LowLatency = UseLowLatencyMode;
+	ActionInputTime[(int32)Action] = 0.0;
+
+	if (Samples.Num() < MaxSamples)
+	{
+		Samples.Add(Sample);
+	}
+	else if (MaxSamples > 0)
+	{
+		Samples[NextSample] = Sample;
+		NextSample = (NextSample + 1) % MaxSamples;
+	}
+
+	switch (Action)
+	{
+		case EInputLatencyAction::Move:
+		{
+			SET_FLOAT_STAT(STAT_CP_InputLatencyMove, Sample.EffectMs);
+		}break;
+		case EInputLatencyAction::Jump:
+		{
+			SET_FLOAT_STAT(STAT_CP_InputLatencyJump, Sample.EffectMs);
+		}break;
+		case EInputLatencyAction::Attack:
+		{
+			SET_FLOAT_STAT(STAT_CP_InputLatencyAttack, Sample.EffectMs);
+		}break;
+		default:
+		{
+		}break;
+	}
+}
+
+void UInputLatencySubsystem::LogStats() const
+{
+	const UEnum* ActionEnum = StaticEnum<EInputLatencyAction>();
+	for (int32 Action = 0; Action < (int32)EInputLatencyAction::Count; Action++)
+	{
+		TArray<float> EffectMs;
+		double HandlerSum = 0.0;
+		for (const FInputLatencySample& Sample : Samples)
+		{
+			if ((int32)Sample.Action != Action)	continue;
+			EffectMs.Add(Sample.EffectMs);
+			HandlerSum += Sample.HandlerMs;
+		}
+		if (EffectMs.Num() == 0)	continue;
+		EffectMs.Sort();
+		double EffectSum = 0.0;
+		for (float Value : EffectMs)
+		{
+			EffectSum += Value;
+		}
+		UE_LOG(LogCrustyPirate, Display, TEXT("%-6s %4d samples: to handler %.1f ms avg, to effect %.1f ms avg, %.1f ms p95"),
+			*ActionEnum->GetNameStringByValue(Action), EffectMs.Num(), HandlerSum / EffectMs.Num(), EffectSum / EffectMs.Num(),
+			EffectMs[FMath::Min(EffectMs.Num() - 1, EffectMs.Num() * 95 / 100)]);
+	}
+}
+
+void UInputLatencySubsystem::WriteCsv() const
+{
+	TArray<FString> Rows;
+	Rows.Reserve(Samples.Num() + 1);
+	Rows.Add(TEXT("Frame,Action,HandlerMs,EffectMs,LowLatency"));
+	const UEnum* ActionEnum = StaticEnum<EInputLatencyAction>();
+	// Oldest first once the sample ring has wrapped.
+	for (int32 i = 0; i < Samples.Num(); i++)
+	{
+		const FInputLatencySample& Sample = Samples[(NextSample + i) % Samples.Num()];
+		Rows.Add(FString::Printf(TEXT("%llu,%s,%.3f,%.3f,%d"), Sample.Frame, *ActionEnum->GetNameStringByValue((int64)Sample.Action),
+			Sample.HandlerMs, Sample.EffectMs, Sample.LowLatency ? 1 : 0));
+	}
+	FString FileName = FString::Printf(TEXT("InputLatency-%s.csv"), *FDateTime::Now().ToString());
+	FString FilePath = FPaths::ProfilingDir() / TEXT("CrustyPirate") / FileName;
+	if (FFileHelper::SaveStringArrayToFile(Rows, *FilePath))
+	{
+		UE_LOG(LogCrustyPirate, Display, TEXT("Wrote %d input latency samples to %s"), Samples.Num(), *FilePath);
+	}
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "InputLatencySubsystem.generated.h"
+
+class FInputLatencyProcessor;
+
+UENUM()
+enum class EInputLatencyAction : uint8
+{
+	Move,
+	Jump,
+	Attack,
+	Count UMETA(Hidden)
+};
+
+struct FInputLatencySample
+{
+	EInputLatencyAction Action = EInputLatencyAction::Move;
+	uint64 Frame = 0;
+	// Input event to the Enhanced Input handler, and input event to the state change it causes
+	// (movement applied for Move and Jump, hitbox enabled for Attack).
+	float HandlerMs = 0.0f;
+	float EffectMs = 0.0f;
+	bool LowLatency = false;
+};
+
+/**
+ * Traces input latency: a Slate input pre-processor timestamps raw key, button and stick events as soon as
+ * the platform delivers them, APlayerCharacter reports when the matching action is handled and when it
+ * takes effect. The last sample per action is shown in "stat CrustyPirate" and all samples can be written
+ * out with "CrustyPirate.InputLatencyCsv".
+ *
+ * Low latency mode turns off the render thread's one frame lag and enables the attack hitbox
+ * PredictedHitboxDelay after the input instead of waiting for the attack animation's notify.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UInputLatencySubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	bool UseLowLatencyMode = false;
+
+	UPROPERTY(Config)
+	float PredictedHitboxDelay = 0.1f;
+
+	// Input events older than this are not matched to an action any more.
+	UPROPERTY(Config)
+	float MaxInputAge = 0.25f;
+
+	UPROPERTY(Config)
+	int32 MaxSamples = 4096;
+
+	TSharedPtr<FInputLatencyProcessor> InputProcessor;
+	TArray<double> PendingInputTimes;
+	TArray<FInputLatencySample> Samples;
+	int32 NextSample = 0;
+	double ActionInputTime[(int32)EInputLatencyAction::Count] = {};
+	double ActionHandledTime[(int32)EInputLatencyAction::Count] = {};
+	uint64 LastMoveFrame = 0;
+	int32 DefaultOneFrameThreadLag = 1;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void SetLowLatencyMode(bool Enabled);
+
+	void NoteInputEvent(double Time);
+	void NoteActionHandled(EInputLatencyAction Action);
+	void NoteActionEffect(EInputLatencyAction Action);
+
+	void LogStats() const;
+	void WriteCsv() const;
+
+protected:
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void AddSample(EInputLatencyAction Action, double EffectTime);
+};
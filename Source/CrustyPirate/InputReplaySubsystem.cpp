@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InputReplaySubsystem.h"
+#include "CrustyPirate.h"
+#include "CrustyPirateGameInstance.h"
+#include "PlayerCharacter.h"
+#include "Enemy.h"
+#include "EngineUtils.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static const uint32 ReplayFileMagic = 0x43505250; // 'CPRP'
+static const uint32 ReplayFileVersion = 2;
+
+static FAutoConsoleCommandWithWorld StopInputRecordingCommand(
+	TEXT("CrustyPirate.StopInputRecording"),
+	TEXT("Stops the running input recording and writes it to disk."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UInputReplaySubsystem* Replay = GameInstance ? GameInstance->GetSubsystem<UInputReplaySubsystem>() : nullptr)
+		{
+			Replay->StopRecording();
+		}
+	}));
+
+void UInputReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FString FileName;
+	if (FParse::Value(CommandLine, TEXT("ReplayInput="), FileName))
+	{
+		FilePath = FPaths::IsRelative(FileName) ? FPaths::ProjectSavedDir() / TEXT("Replays") / FileName : FileName;
+		IsReplaying = LoadRecording();
+		if (!IsReplaying)
+		{
+			UE_LOG(LogCrustyPirate, Error, TEXT("Could not load input replay %s"), *FilePath);
+			FPlatformMisc::RequestExitWithStatus(false, 2);
+			return;
+		}
+		ReplayStartTime = FPlatformTime::Seconds();
+		FWorldDelegates::OnWorldTickStart.AddUObject(this, &UInputReplaySubsystem::OnWorldTickStart);
+	}
+	else if (FParse::Value(CommandLine, TEXT("RecordInput="), FileName))
+	{
+		FilePath = FPaths::IsRelative(FileName) ? FPaths::ProjectSavedDir() / TEXT("Replays") / FileName : FileName;
+		IsRecording = true;
+	}
+
+	if (IsReplaying || IsRecording || FParse::Param(CommandLine, TEXT("FixedStep")))
+	{
+		EnableFixedStep(FixedStepRate);
+	}
+}
+
+void UInputReplaySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.RemoveAll(this);
+	StopRecording();
+	Super::Deinitialize();
+}
+
+void UInputReplaySubsystem::Tick(float DeltaTime)
+{
+	// Loading takes a different number of frames every run, so the clock starts once the world has settled.
+	if (!IsWorldSettled())	return;
+	Frame++;
+	if (IsReplaying && Frame >= ReplayFrameCount)
+	{
+		FinishReplay();
+	}
+}
+
+void UInputReplaySubsystem::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	// Recorded inputs are fed in before the player controller ticks, matching when live input was handled.
+	if (!IsReplaying || World != GetGameInstance()->GetWorld() || !IsWorldSettled())	return;
+	while (Inputs.IsValidIndex(NextReplayEvent) && Inputs[NextReplayEvent].Frame <= Frame)
+	{
+		InjectInput(Inputs[NextReplayEvent]);
+		NextReplayEvent++;
+	}
+}
+
+bool UInputReplaySubsystem::IsWorldSettled() const
+{
+	UWorld* World = GetGameInstance()->GetWorld();
+	return World && World->HasBegunPlay() && !World->IsVisibilityRequestPending() && !IsAsyncLoading();
+}
+
+TStatId UInputReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInputReplaySubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType UInputReplaySubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+bool UInputReplaySubsystem::HandleInput(EReplayAction Action, float Value)
+{
+	if (IsReplaying)
+	{
+		return IsInjecting;
+	}
+	if (IsRecording)
+	{
+		FRecordedInput& Input = Inputs.AddDefaulted_GetRef();
+		Input.Frame = Frame;
+		Input.Action = Action;
+		Input.Value = Value;
+	}
+	return true;
+}
+
+void UInputReplaySubsystem::EnableFixedStep(float StepRate)
+{
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / StepRate);
+}
+
+bool UInputReplaySubsystem::IsDeterministicRun()
+{
+	FString FileName;
+	return FParse::Value(FCommandLine::Get(), TEXT("ReplayInput="), FileName) || FParse::Value(FCommandLine::Get(), TEXT("RecordInput="), FileName);
+}
+
+void UInputReplaySubsystem::StopRecording()
+{
+	if (!IsRecording)	return;
+	IsRecording = false;
+	RecordedState = CaptureFinalState();
+	ReplayFrameCount = Frame;
+	if (SaveRecording())
+	{
+		UE_LOG(LogCrustyPirate, Log, TEXT("Recorded %d inputs over %u frames to %s"), Inputs.Num(), Frame, *FilePath);
+	}
+}
+
+FReplayFinalState UInputReplaySubsystem::CaptureFinalState() const
+{
+	FReplayFinalState State;
+	UCrustyPirateGameInstance* MyGameInstance = Cast<UCrustyPirateGameInstance>(GetGameInstance());
+	if (MyGameInstance)
+	{
+		State.PlayerHP = MyGameInstance->PlayerHP;
+		State.DiamondCount = MyGameInstance->CollectedDiamondCount;
+		State.LevelIndex = MyGameInstance->CurrentLevelIndex;
+	}
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (World)
+	{
+		TArray<AEnemy*> Enemies;
+		for (TActorIterator<AEnemy> It(World); It; ++It)
+		{
+			Enemies.Add(*It);
+		}
+		Enemies.Sort([](const AEnemy& A, const AEnemy& B) { return A.GetFName().LexicalLess(B.GetFName()); });
+		for (AEnemy* Enemy : Enemies)
+		{
+			State.EnemyHP.Add(Enemy->HitPoints);
+		}
+	}
+	return State;
+}
+
+bool UInputReplaySubsystem::SaveRecording() const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	uint32 Magic = ReplayFileMagic;
+	uint32 Version = ReplayFileVersion;
+	float StepRate = FixedStepRate;
+	uint32 FrameCount = ReplayFrameCount;
+	FReplayFinalState State = RecordedState;
+	TArray<FRecordedInput> RecordedInputs = Inputs;
+	Writer << Magic << Version << StepRate << FrameCount << State << RecordedInputs;
+	return FFileHelper::SaveArrayToFile(Bytes, *FilePath);
+}
+
+bool UInputReplaySubsystem::LoadRecording()
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FilePath))	return false;
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic << Version;
+	if (Magic != ReplayFileMagic || Version != ReplayFileVersion)	return false;
+	Reader << FixedStepRate << ReplayFrameCount << RecordedState << Inputs;
+	return !Reader.IsError() && FixedStepRate > 0.0f;
+}
+
+void UInputReplaySubsystem::InjectInput(const FRecordedInput& Input)
+{
+	APlayerCharacter* Player = Cast<APlayerCharacter>(UGameplayStatics::GetPlayerCharacter(GetGameInstance()->GetWorld(), 0));
+	if (!Player)	return;
+
+	IsInjecting = true;
+	switch (Input.Action)
+	{
+		case EReplayAction::Move:
+		{
+			Player->Move(FInputActionValue(Input.Value));
+		}break;
+		case EReplayAction::JumpStarted:
+		{
+			Player->JumpStarted(FInputActionValue(true));
+		}break;
+		case EReplayAction::JumpEnded:
+		{
+			Player->JumpEnded(FInputActionValue(false));
+		}break;
+		case EReplayAction::Attack:
+		{
+			Player->Attack(FInputActionValue(true));
+		}break;
+		default:
+		{
+		}break;
+	}
+	IsInjecting = false;
+}
+
+void UInputReplaySubsystem::FinishReplay()
+{
+	IsReplaying = false;
+	double Seconds = FPlatformTime::Seconds() - ReplayStartTime;
+	FReplayFinalState State = CaptureFinalState();
+	bool Matches = State == RecordedState;
+	uint32 EnemyHash = FCrc::MemCrc32(State.EnemyHP.GetData(), State.EnemyHP.Num() * sizeof(int32));
+	uint32 RecordedEnemyHash = FCrc::MemCrc32(RecordedState.EnemyHP.GetData(), RecordedState.EnemyHP.Num() * sizeof(int32));
+	UE_LOG(LogCrustyPirate, Display, TEXT("Replay %s: %u frames in %.2f s (%.1f simulated fps). HP %d/%d, diamonds %d/%d, level %d/%d, enemies %d/%d, enemy HP hash %08x/%08x"),
+		Matches ? TEXT("PASSED") : TEXT("FAILED"), ReplayFrameCount, Seconds, ReplayFrameCount / FMath::Max(Seconds, 0.001),
+		State.PlayerHP, RecordedState.PlayerHP, State.DiamondCount, RecordedState.DiamondCount,
+		State.LevelIndex, RecordedState.LevelIndex, State.EnemyHP.Num(), RecordedState.EnemyHP.Num(), EnemyHash, RecordedEnemyHash);
+	for (int32 i = 0; i < FMath::Max(State.EnemyHP.Num(), RecordedState.EnemyHP.Num()); i++)
+	{
+		int32 HP = State.EnemyHP.IsValidIndex(i) ? State.EnemyHP[i] : INDEX_NONE;
+		int32 RecordedHP = RecordedState.EnemyHP.IsValidIndex(i) ? RecordedState.EnemyHP[i] : INDEX_NONE;
+		if (HP != RecordedHP)
+		{
+			UE_LOG(LogCrustyPirate, Display, TEXT("  enemy %d: HP %d, recorded %d"), i, HP, RecordedHP);
+		}
+	}
+	FPlatformMisc::RequestExitWithStatus(false, Matches ? 0 : 1);
+}
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "InputReplaySubsystem.generated.h"
+
+UENUM()
+enum class EReplayAction : uint8
+{
+	Move,
+	JumpStarted,
+	JumpEnded,
+	Attack
+};
+
+struct FRecordedInput
+{
+	uint32 Frame = 0;
+	EReplayAction Action = EReplayAction::Move;
+	float Value = 0.0f;
+
+	friend FArchive& operator<<(FArchive& Ar, FRecordedInput& Input)
+	{
+		return Ar << Input.Frame << Input.Action << Input.Value;
+	}
+};
+
+struct FReplayFinalState
+{
+	int32 PlayerHP = 0;
+	int32 DiamondCount = 0;
+	int32 LevelIndex = 0;
+	TArray<int32> EnemyHP;
+
+	bool operator==(const FReplayFinalState& Other) const
+	{
+		return PlayerHP == Other.PlayerHP && DiamondCount == Other.DiamondCount && LevelIndex == Other.LevelIndex && EnemyHP == Other.EnemyHP;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FReplayFinalState& State)
+	{
+		return Ar << State.PlayerHP << State.DiamondCount << State.LevelIndex << State.EnemyHP;
+	}
+};
+
+/**
+ * Fixed-timestep simulation with input recording and headless replay.
+ *
+ * -FixedStep                 run the game with a fixed delta time of 1 / FixedStepRate
+ * -RecordInput=<file>        record Move/Jump/Attack per frame and the final game state on exit
+ * -ReplayInput=<file>        ignore live input, feed the recording back at full speed, verify the
+ *                            final state and exit with a non-zero code on mismatch
+ *
+ * Replays are meant to be run as: CrustyPirate -ReplayInput=<file> -nullrhi -unattended -nosound
+ *
+ * Frames are only counted once the world has begun play and finished streaming. While recording or
+ * replaying, streamed level preloading, asset residency and off-screen animation culling are turned off
+ * because they depend on load times and rendering rather than on the simulation.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UInputReplaySubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	float FixedStepRate = 60.0f;
+
+	bool IsRecording = false;
+	bool IsReplaying = false;
+	bool IsInjecting = false;
+	uint32 Frame = 0;
+	int32 NextReplayEvent = 0;
+	uint32 ReplayFrameCount = 0;
+	double ReplayStartTime = 0.0;
+	FString FilePath;
+	TArray<FRecordedInput> Inputs;
+	FReplayFinalState RecordedState;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+
+	// Called by APlayerCharacter input handlers. Returns false when live input should be ignored.
+	bool HandleInput(EReplayAction Action, float Value);
+
+	void EnableFixedStep(float StepRate);
+	// True when -RecordInput or -ReplayInput is on the command line.
+	static bool IsDeterministicRun();
+	void StopRecording();
+	FReplayFinalState CaptureFinalState() const;
+
+protected:
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	bool IsWorldSettled() const;
+	bool SaveRecording() const;
+	bool LoadRecording();
+	void InjectInput(const FRecordedInput& Input);
+	void FinishReplay();
+};
@@ -0,0 +1,331 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LevelChunkSubsystem.h"
+#include "CrustyPirate.h"
+#include "CrustyPiratePerf.h"
+#include "PlayerCharacter.h"
+#include "Enemy.h"
+#include "CollectableItem.h"
+#include "ActorPoolSubsystem.h"
+#include "ProgressSaveSubsystem.h"
+#include "PaperTileMapActor.h"
+#include "Kismet/GameplayStatics.h"
+
+static const FName LevelChunkTag("LevelChunk");
+
+static FAutoConsoleCommandWithWorld ChunkStatsCommand(
+	TEXT("CrustyPirate.ChunkStats"),
+	TEXT("Logs loaded chunks, resident chunk actors and chunk load latency."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (ULevelChunkSubsystem* LevelChunks = World ? World->GetSubsystem<ULevelChunkSubsystem>() : nullptr)
+		{
+			LevelChunks->LogStats();
+		}
+	}));
+
+void ULevelChunkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	// Chunks follow the one local camera; in network games the replication graph culls per client.
+	if (!UseChunkStreaming || IsRetired || GetWorld()->GetNetMode() != NM_Standalone)	return;
+	CRUSTYPIRATE_SCOPE(ChunkStreaming);
+
+	if (!IsCaptured)
+	{
+		Player = Cast<APlayerCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
+		if (!Player)	return;
+		CaptureLevel();
+		IsCaptured = true;
+	}
+	if (!IsValid(Player) || Chunks.Num() == 0)	return;
+
+	float CameraX = Player->Camera->GetComponentLocation().X;
+	for (int32 Chunk = 0; Chunk < Chunks.Num(); Chunk++)
+	{
+		FLevelChunk& LevelChunk = Chunks[Chunk];
+		float Distance = GetDistanceToChunk(Chunk, CameraX);
+		if (!LevelChunk.IsLoaded && !LevelChunk.IsLoading && Distance <= LoadDistance)
+		{
+			LoadChunk(Chunk);
+		}
+		else if ((LevelChunk.IsLoaded || LevelChunk.IsLoading) && Distance > UnloadDistance)
+		{
+			UnloadChunk(Chunk);
+		}
+	}
+
+	// Spawning is spread over frames, closest chunk first.
+	int32 SpawnBudget = MaxSpawnsPerFrame;
+	int32 CameraChunk = FMath::FloorToInt(CameraX / ChunkWidth) - FirstChunkIndex;
+	for (int32 Offset = 0; SpawnBudget > 0 && Offset < Chunks.Num(); Offset++)
+	{
+		for (int32 Chunk : { CameraChunk - Offset, CameraChunk + Offset })
+		{
+			if (!Chunks.IsValidIndex(Chunk) || !Chunks[Chunk].IsLoading)	continue;
+			if (!SpawnRecords(Chunk, SpawnBudget))	break;
+
+			FLevelChunk& LevelChunk = Chunks[Chunk];
+			LevelChunk.IsLoading = false;
+			LevelChunk.IsLoaded = true;
+			double LatencyMs = (FPlatformTime::Seconds() - LevelChunk.LoadStartTime) * 1000.0;
+			NumChunkLoads++;
+			TotalLoadLatencyMs += LatencyMs;
+			MaxLoadLatencyMs = FMath::Max(MaxLoadLatencyMs, LatencyMs);
+			if (Offset == 0)	break;
+		}
+	}
+
+	{
+		CRUSTYPIRATE_SET_COUNTER(LoadedChunks, NumLoadedChunks);
+	}
+	{
+		CRUSTYPIRATE_SET_COUNTER(ResidentChunkActors, SpawnedRecords.Num());
+	}
+}
+
+TStatId ULevelChunkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULevelChunkSubsystem, STATGROUP_Tickables);
+}
+
+bool ULevelChunkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void ULevelChunkSubsystem::CaptureLevel()
+{
+	// Only what the level placed is streamed; pooled and runtime spawned actors are left alone.
+	TArray<AActor*> LevelActors;
+	TArray<AActor*> TileMaps;
+	float MinX = TNumericLimits<float>::Max();
+	float MaxX = -TNumericLimits<float>::Max();
+	for (AActor* Actor : GetWorld()->PersistentLevel->Actors)
+	{
+		if (!IsValid(Actor) || !Actor->IsNetStartupActor() || Actor->IsHidden())	continue;
+		bool IsTileMapChunk = Actor->IsA<APaperTileMapActor>() && Actor->ActorHasTag(LevelChunkTag);
+		if (!IsTileMapChunk && !Actor->IsA<AEnemy>() && !Actor->IsA<ACollectableItem>())	continue;
+		(IsTileMapChunk ? TileMaps : LevelActors).Add(Actor);
+		MinX = FMath::Min(MinX, (float)Actor->GetActorLocation().X);
+		MaxX = FMath::Max(MaxX, (float)Actor->GetActorLocation().X);
+	}
+	if (LevelActors.Num() == 0 && TileMaps.Num() == 0)	return;
+
+	FirstChunkIndex = FMath::FloorToInt(MinX / ChunkWidth);
+	Chunks.SetNum(FMath::FloorToInt(MaxX / ChunkWidth) - FirstChunkIndex + 1);
+	UProgressSaveSubsystem* Save = GetWorld()->GetGameInstance()->GetSubsystem<UProgressSaveSubsystem>();
+	LevelIndex = Save ? Save->GetLevelIndex(LevelActors.Num() > 0 ? LevelActors[0] : TileMaps[0]) : 0;
+
+	float CameraX = Player->Camera->GetComponentLocation().X;
+	for (AActor* TileMap : TileMaps)
+	{
+		Chunks[FMath::FloorToInt(TileMap->GetActorLocation().X / ChunkWidth) - FirstChunkIndex].TileMaps.Add(TileMap);
+	}
+	for (int32 Chunk = 0; Chunk < Chunks.Num(); Chunk++)
+	{
+		FLevelChunk& LevelChunk = Chunks[Chunk];
+		LevelChunk.IsLoaded = GetDistanceToChunk(Chunk, CameraX) <= LoadDistance;
+		NumLoadedChunks += LevelChunk.IsLoaded ? 1 : 0;
+		SetTileMapsResident(LevelChunk, LevelChunk.IsLoaded);
+	}
+
+	int32 NumEnemies = 0;
+	for (AActor* Actor : LevelActors)
+	{
+		NumEnemies += Actor->IsA<AEnemy>() ? 1 : 0;
+	}
+	if (Save)
+	{
+		Save->ReserveLevel(LevelIndex, LevelActors.Num() - NumEnemies, NumEnemies);
+	}
+
+	for (AActor* Actor : LevelActors)
+	{
+		int32 Chunk = FMath::FloorToInt(Actor->GetActorLocation().X / ChunkWidth) - FirstChunkIndex;
+		FLevelChunk& LevelChunk = Chunks[Chunk];
+		FLevelChunkRecord& Record = LevelChunk.Records.AddDefaulted_GetRef();
+		Record.Class = Actor->GetClass();
+		Record.Transform = Actor->GetActorTransform();
+		Record.Name = Actor->GetFName();
+		if (AEnemy* Enemy = Cast<AEnemy>(Actor))
+		{
+			Record.Archetype = Enemy->Archetype;
+			Record.HitPoints = Enemy->HitPoints;
+		}
+
+		// Nearby actors stay as they are; the rest are destroyed rather than pooled so memory only
+		// grows with the number of resident chunks.
+		if (LevelChunk.IsLoaded)
+		{
+			Record.Spawned = Actor;
+			SpawnedRecords.Add(Actor, FIntPoint(Chunk, LevelChunk.Records.Num() - 1));
+		}
+		else
+		{
+			Actor->Destroy();
+		}
+	}
+	UE_LOG(LogCrustyPirate, Log, TEXT("Level split into %d chunks: %d actors, %d tilemaps, %d resident"),
+		Chunks.Num(), LevelActors.Num(), TileMaps.Num(), SpawnedRecords.Num());
+}
+
+void ULevelChunkSubsystem::LoadChunk(int32 Chunk)
+{
+	FLevelChunk& LevelChunk = Chunks[Chunk];
+	LevelChunk.IsLoading = true;
+	LevelChunk.NextRecord = 0;
+	LevelChunk.LoadStartTime = FPlatformTime::Seconds();
+	NumLoadedChunks++;
+	// Terrain first, so nothing spawned into the chunk falls through it.
+	SetTileMapsResident(LevelChunk, true);
+}
+
+bool ULevelChunkSubsystem::SpawnRecords(int32 Chunk, int32& SpawnBudget)
+{
+	FLevelChunk& LevelChunk = Chunks[Chunk];
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+	while (LevelChunk.NextRecord < LevelChunk.Records.Num())
+	{
+		if (SpawnBudget <= 0)	return false;
+		int32 RecordIndex = LevelChunk.NextRecord++;
+		FLevelChunkRecord& Record = LevelChunk.Records[RecordIndex];
+		if (Record.IsGone || Record.Spawned)	continue;
+
+		AActor* Actor = NULL;
+		if (Pool)
+		{
+			Actor = Pool->Acquire(Record.Class, Record.Transform);
+		}
+		else
+		{
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			Actor = GetWorld()->SpawnActor<AActor>(Record.Class, Record.Transform, SpawnParams);
+		}
+		SpawnBudget--;
+		if (!Actor)	continue;
+
+		if (AEnemy* Enemy = Cast<AEnemy>(Actor))
+		{
+			if (Record.Archetype && Enemy->Archetype != Record.Archetype)
+			{
+				Enemy->SetArchetype(Record.Archetype);
+			}
+			Enemy->UpdateHP(Record.HitPoints);
+		}
+		Record.Spawned = Actor;
+		SpawnedRecords.Add(Actor, FIntPoint(Chunk, RecordIndex));
+	}
+	return true;
+}
+
+void ULevelChunkSubsystem::UnloadChunk(int32 Chunk)
+{
+	FLevelChunk& LevelChunk = Chunks[Chunk];
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+	for (int32 RecordIndex = 0; RecordIndex < LevelChunk.Records.Num(); RecordIndex++)
+	{
+		FLevelChunkRecord& Record = LevelChunk.Records[RecordIndex];
+		AActor* Actor = Record.Spawned;
+		Record.Spawned = NULL;
+		if (!Actor)	continue;
+		// The pool may have handed the actor to another record after someone else released it.
+		const FIntPoint* Owner = SpawnedRecords.Find(Actor);
+		if (!Owner || *Owner != FIntPoint(Chunk, RecordIndex))	continue;
+		SpawnedRecords.Remove(Actor);
+		if (!IsValid(Actor))
+		{
+			Record.IsGone = true;
+			continue;
+		}
+		// Released by its own code path without going through MarkActorGone; the pool owns it now.
+		if (Pool && Pool->IsInPool(Actor))	continue;
+
+		// Dead enemies were marked gone when they died, so only living ones get here.
+		if (AEnemy* Enemy = Cast<AEnemy>(Actor))
+		{
+			Record.Transform = Enemy->GetActorTransform();
+			Record.HitPoints = Enemy->HitPoints;
+		}
+		if (Pool)
+		{
+			Pool->Release(Actor);
+		}
+		else
+		{
+			Actor->Destroy();
+		}
+	}
+	LevelChunk.IsLoaded = false;
+	LevelChunk.IsLoading = false;
+	NumLoadedChunks--;
+	SetTileMapsResident(LevelChunk, false);
+}
+
+bool ULevelChunkSubsystem::MarkActorGone(AActor* Actor)
+{
+	FIntPoint Owner;
+	if (!SpawnedRecords.RemoveAndCopyValue(Actor, Owner))	return false;
+	FLevelChunkRecord& Record = Chunks[Owner.X].Records[Owner.Y];
+	Record.IsGone = true;
+	Record.Spawned = NULL;
+
+	// Respawned actors are not the ones the level placed, so the save is told the original name.
+	UProgressSaveSubsystem* Save = GetWorld()->GetGameInstance()->GetSubsystem<UProgressSaveSubsystem>();
+	if (!Save)	return true;
+	if (Actor->IsA<AEnemy>())
+	{
+		Save->MarkEnemyDefeated(LevelIndex, Record.Name);
+	}
+	else
+	{
+		Save->MarkItemCollected(LevelIndex, Record.Name);
+	}
+	return true;
+}
+
+void ULevelChunkSubsystem::Retire()
+{
+	IsRetired = true;
+	SpawnedRecords.Reset();
+	NumLoadedChunks = 0;
+	CRUSTYPIRATE_SET_COUNTER(LoadedChunks, 0);
+	CRUSTYPIRATE_SET_COUNTER(ResidentChunkActors, 0);
+}
+
+void ULevelChunkSubsystem::SetTileMapsResident(FLevelChunk& LevelChunk, bool Resident)
+{
+	for (AActor* TileMap : LevelChunk.TileMaps)
+	{
+		if (!IsValid(TileMap))	continue;
+		TileMap->SetActorHiddenInGame(!Resident);
+		TileMap->SetActorEnableCollision(Resident);
+	}
+}
+
+float ULevelChunkSubsystem::GetDistanceToChunk(int32 Chunk, float X) const
+{
+	float MinX = (FirstChunkIndex + Chunk) * ChunkWidth;
+	float MaxX = MinX + ChunkWidth;
+	return X < MinX ? MinX - X : (X > MaxX ? X - MaxX : 0.0f);
+}
+
+void ULevelChunkSubsystem::LogStats() const
+{
+	int32 NumRecords = 0;
+	int32 NumGone = 0;
+	for (const FLevelChunk& LevelChunk : Chunks)
+	{
+		NumRecords += LevelChunk.Records.Num();
+		for (const FLevelChunkRecord& Record : LevelChunk.Records)
+		{
+			NumGone += Record.IsGone ? 1 : 0;
+		}
+	}
+	UE_LOG(LogCrustyPirate, Display, TEXT("Chunks: %d of %d loaded, %d resident actors, %d of %d records gone"),
+		NumLoadedChunks, Chunks.Num(), SpawnedRecords.Num(), NumGone, NumRecords);
+	UE_LOG(LogCrustyPirate, Display, TEXT("Chunk loads: %d, latency avg %.2f ms, max %.2f ms"),
+		NumChunkLoads, NumChunkLoads > 0 ? TotalLoadLatencyMs / NumChunkLoads : 0.0, MaxLoadLatencyMs);
+}
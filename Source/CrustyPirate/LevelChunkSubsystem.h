@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LevelChunkSubsystem.generated.h"
+
+class APlayerCharacter;
+class UEnemyArchetype;
+
+USTRUCT()
+struct FLevelChunkRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UClass* Class = nullptr;
+
+	UPROPERTY()
+	UEnemyArchetype* Archetype = nullptr;
+
+	UPROPERTY()
+	AActor* Spawned = nullptr;
+
+	FTransform Transform;
+	// Name the level gave the actor, which is what the progress save knows it by.
+	FName Name;
+	int32 HitPoints = 0;
+	bool IsGone = false;
+};
+
+USTRUCT()
+struct FLevelChunk
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FLevelChunkRecord> Records;
+
+	UPROPERTY()
+	TArray<AActor*> TileMaps;
+
+	bool IsLoaded = false;
+	bool IsLoading = false;
+	int32 NextRecord = 0;
+	double LoadStartTime = 0.0;
+};
+
+/**
+ * Splits the persistent level into ChunkWidth wide chunks along X and only keeps the chunks around the
+ * player camera resident. Enemies and collectables of unloaded chunks live on as records and are spawned
+ * from (and released back to) the actor pool, so killed enemies and picked up items stay gone.
+ * Tilemap actors tagged LevelChunk (see UProceduralLevelCommandlet) are hidden and lose collision while
+ * their chunk is unloaded.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API ULevelChunkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	bool UseChunkStreaming = true;
+
+	UPROPERTY(Config)
+	float ChunkWidth = 4096.0f;
+
+	// Chunks closer than this to the camera are loaded, chunks further than UnloadDistance are unloaded.
+	UPROPERTY(Config)
+	float LoadDistance = 3000.0f;
+
+	UPROPERTY(Config)
+	float UnloadDistance = 5000.0f;
+
+	UPROPERTY(Config)
+	int32 MaxSpawnsPerFrame = 16;
+
+	UPROPERTY()
+	TArray<FLevelChunk> Chunks;
+
+	UPROPERTY()
+	APlayerCharacter* Player;
+
+	// Spawned actor to (chunk, record).
+	TMap<AActor*, FIntPoint> SpawnedRecords;
+	int32 FirstChunkIndex = 0;
+	int32 LevelIndex = 0;
+	bool IsCaptured = false;
+	// Set once the level has been left through a streamed transition; its actors are parked, not streamed.
+	bool IsRetired = false;
+	int32 NumLoadedChunks = 0;
+	int32 NumChunkLoads = 0;
+	double TotalLoadLatencyMs = 0.0;
+	double MaxLoadLatencyMs = 0.0;
+
+	// Called when an enemy or collectable is removed for good (killed or picked up). Marks it in the
+	// progress save under the name the level gave it; returns false when the actor has no record.
+	bool MarkActorGone(AActor* Actor);
+	void Retire();
+	void LogStats() const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void CaptureLevel();
+	void LoadChunk(int32 Chunk);
+	void UnloadChunk(int32 Chunk);
+	bool SpawnRecords(int32 Chunk, int32& SpawnBudget);
+	void SetTileMapsResident(FLevelChunk& LevelChunk, bool Resident);
+	float GetDistanceToChunk(int32 Chunk, float X) const;
+};
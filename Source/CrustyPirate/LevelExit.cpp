@@ -1,37 +1,62 @@
 
 
 #include "LevelExit.h"
+#include "CrustyPirate.h"
 #include "PlayerCharacter.h"
-#include "Kismet/GameplayStatics.h"
 #include "CrustyPirateGameInstance.h"
+#include "AssetResidencySubsystem.h"
+#include "GameplayEventBus.h"
+#include "GameplayAudioSubsystem.h"
+#include "CrustyPiratePerf.h"
 
 
 ALevelExit::ALevelExit()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 	BoxComponent = CreateDefaultSubobject<UBoxComponent>(TEXT("BoxComponent"));
 	SetRootComponent(BoxComponent);
 	DoorFlipbook = CreateDefaultSubobject<UPaperFlipbookComponent>(TEXT("DoorFlipbook"));
 	DoorFlipbook->SetupAttachment(RootComponent);
 	DoorFlipbook->SetPlayRate(0.0f);
 	DoorFlipbook->SetLooping(false);
+	PreloadTrigger = CreateDefaultSubobject<USphereComponent>(TEXT("PreloadTrigger"));
+	PreloadTrigger->SetupAttachment(RootComponent);
+	PreloadTrigger->SetSphereRadius(800.0f);
+#if UE_SERVER
+	DoorFlipbook->PrimaryComponentTick.bCanEverTick = false;
+#endif
 }
 
 void ALevelExit::BeginPlay()
 {
 	Super::BeginPlay();
-	BoxComponent->OnComponentBeginOverlap.AddDynamic(this, &ALevelExit::OverlapBegin);
+	CRUSTYPIRATE_ADD_DYNAMIC(BoxComponent->OnComponentBeginOverlap, this, &ALevelExit::OverlapBegin);
+	CRUSTYPIRATE_ADD_DYNAMIC(PreloadTrigger->OnComponentBeginOverlap, this, &ALevelExit::PreloadOverlapBegin);
 	DoorFlipbook->SetPlaybackPosition(0.0f, false);
+	if (USignificanceSubsystem* Significance = GetWorld()->GetSubsystem<USignificanceSubsystem>())
+	{
+		Significance->RegisterActor(this);
+	}
 }
 
-void ALevelExit::Tick(float DeltaTime)
+void ALevelExit::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (USignificanceSubsystem* Significance = GetWorld()->GetSubsystem<USignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
 
+void ALevelExit::SetSignificanceTier(ESignificanceTier Tier, float TickInterval)
+{
+	DoorFlipbook->SetComponentTickEnabled(Tier != ESignificanceTier::Dormant || !IsActive);
+	DoorFlipbook->SetComponentTickInterval(IsActive ? TickInterval : 0.0f);
 }
 
 void ALevelExit::OverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	if (!HasAuthority())	return;
 	APlayerCharacter* Player = Cast<APlayerCharacter>(OtherActor);
 	if (Player && Player->IsAlive)
 	{
@@ -39,14 +64,32 @@ void ALevelExit::OverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* Other
 		{
 			Player->Deactivate();
 			IsActive = false;
+			UGameplayEventBus::PublishEvent(this, EGameplayEventType::LevelExitReached, Player, this, LevelIndex);
 			DoorFlipbook->SetPlayRate(1.0f);
 			DoorFlipbook->PlayFromStart();
-			UGameplayStatics::PlaySound2D(GetWorld(), PlayerEnterSound);
+#if !UE_SERVER
+			if (UAssetResidencySubsystem* Residency = GetGameInstance()->GetSubsystem<UAssetResidencySubsystem>())
+			{
+				Residency->NoteAssetUse(PlayerEnterSound);
+			}
+			UGameplayAudioSubsystem::PlaySound2D(this, PlayerEnterSound);
+#endif
+			CRUSTYPIRATE_INC_COUNTER(TimersSet);
 			GetWorldTimerManager().SetTimer(WaitTimer, this, &ALevelExit::OnWaitTimerTimeout, 1.0f, false, WaitTimeInSeconds);
 		}
 	}
 }
 
+void ALevelExit::PreloadOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	APlayerCharacter* Player = Cast<APlayerCharacter>(OtherActor);
+	UCrustyPirateGameInstance* MyGameInstance = Cast<UCrustyPirateGameInstance>(GetGameInstance());
+	if (Player && MyGameInstance && IsActive)
+	{
+		MyGameInstance->PreloadLevel(LevelIndex);
+	}
+}
+
 void ALevelExit::OnWaitTimerTimeout()
 {
 	UCrustyPirateGameInstance* MyGameInstance = Cast<UCrustyPirateGameInstance>(GetGameInstance());
@@ -4,9 +4,11 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/BoxComponent.h"
+#include "Components/SphereComponent.h"
 #include "PaperFlipbookComponent.h"
 #include "Sound/SoundBase.h"
 #include "Engine/TimerHandle.h"
+#include "SignificanceSubsystem.h"
 #include "LevelExit.generated.h"
 
 UCLASS()
@@ -21,6 +23,9 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	UPaperFlipbookComponent* DoorFlipbook;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
+	USphereComponent* PreloadTrigger;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	USoundBase* PlayerEnterSound;
 
@@ -39,11 +44,16 @@ public:
 
 	virtual void BeginPlay() override;
 
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void SetSignificanceTier(ESignificanceTier Tier, float TickInterval);
 
 	void OnWaitTimerTimeout();
 
 	UFUNCTION()
 	void OverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 
+	UFUNCTION()
+	void PreloadOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
 };
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CachedNumberText.h"
+#include "NumberTextSubsystem.generated.h"
+
+/**
+ * Owns the number texts shown by enemy HP labels and the player HUD, so every enemy in a world shares
+ * one cache and worlds do not share theirs. Only used from the game thread.
+ */
+UCLASS()
+class CRUSTYPIRATE_API UNumberTextSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	FCachedNumberText HPTexts = FCachedNumberText(TEXT("HP: {0}"));
+	FCachedNumberText DiamondTexts = FCachedNumberText(TEXT("Diamonds: {0}"));
+	FCachedNumberText LevelTexts = FCachedNumberText(TEXT("Level: {0}"));
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
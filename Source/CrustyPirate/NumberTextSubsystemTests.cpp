@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NumberTextSubsystem.h"
+#include "Enemy.h"
+#include "PerfScenarioSubsystem.h"
+#include "CrustyPirateTestWorld.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNumberTextUpdatesTest, "CrustyPirate.Perf.NumberTextUpdates",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FNumberTextUpdatesTest::RunTest(const FString& Parameters)
+{
+	FCrustyPirateTestWorld TestWorld;
+	FCrustyPirateTestWorld OtherWorld;
+	UNumberTextSubsystem* NumberTexts = TestWorld.World->GetSubsystem<UNumberTextSubsystem>();
+	AEnemy* Enemy = TestWorld.SpawnEnemy(FVector::ZeroVector);
+	if (!TestNotNull(TEXT("Number texts"), NumberTexts) || !TestNotNull(TEXT("Enemy"), Enemy))
+	{
+		return false;
+	}
+	TestTrue(TEXT("Each world has its own texts"), NumberTexts != OtherWorld.World->GetSubsystem<UNumberTextSubsystem>());
+
+	// HP swinging between full and empty, as in a burst of hits and potions.
+	const int32 NumUpdates = 1000000;
+	const int32 MaxValue = 100;
+	bool WasCounting = UPerfScenarioSubsystem::GetAllocationCount() >= 0;
+	UPerfScenarioSubsystem::StartCountingAllocations();
+
+	// What the HUD and enemies did before: a new string and text per update.
+	int64 StartAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount();
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumUpdates; i++)
+	{
+		FText Text = FText::FromString(FString::Printf(TEXT("HP: %d"), i % MaxValue));
+	}
+	double PrintfMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	int64 PrintfAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount() - StartAllocations;
+
+	// The first pass over the values fills the cache.
+	for (int32 i = 0; i < MaxValue; i++)
+	{
+		NumberTexts->HPTexts.Get(i);
+	}
+	StartAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount();
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumUpdates; i++)
+	{
+		FText Text = NumberTexts->HPTexts.Get(i % MaxValue);
+	}
+	double CachedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	int64 CachedAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount() - StartAllocations;
+
+	// Through the enemy's label, which also pushes the text to its component.
+	StartAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount();
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumUpdates; i++)
+	{
+		Enemy->UpdateHP(i % MaxValue);
+	}
+	double EnemyMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	int64 EnemyAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount() - StartAllocations;
+	if (!WasCounting)
+	{
+		UPerfScenarioSubsystem::StopCountingAllocations();
+	}
+
+	AddInfo(FString::Printf(TEXT("%d updates: Printf %.1f ms, %lld allocations; cached %.1f ms, %lld allocations; enemy label %.1f ms, %lld allocations"),
+		NumUpdates, PrintfMs, PrintfAllocations, CachedMs, CachedAllocations, EnemyMs, EnemyAllocations));
+	TestEqual(TEXT("Cached texts do not allocate"), CachedAllocations, (int64)0);
+	TestTrue(TEXT("Enemy label allocates less than formatting"), EnemyAllocations < PrintfAllocations);
+	TestTrue(TEXT("Enemy label shows the last value"), Enemy->HPText->Text.EqualTo(NumberTexts->HPTexts.Get((NumUpdates - 1) % MaxValue)));
+	return !HasAnyErrors();
+}
+
+#endif
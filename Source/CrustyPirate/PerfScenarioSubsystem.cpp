@@ -0,0 +1,528 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PerfScenarioSubsystem.h"
+#include "CrustyPirate.h"
+#include "PlayerCharacter.h"
+#include "Enemy.h"
+#include "EnemyArchetypeSubsystem.h"
+#include "CollectableItem.h"
+#include "LevelExit.h"
+#include "ActorPoolSubsystem.h"
+#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Dom/JsonObject.h"
+#include "Engine/CollisionProfile.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include <atomic>
+
+/** Forwards everything to the real allocator and counts Malloc/Realloc calls, in total and on the game thread. */
+class FCountingMalloc : public FMalloc
+{
+public:
+	static std::atomic<int64> NumAllocations;
+	// Only ever written by the game thread.
+	static int64 NumGameThreadAllocations;
+
+	explicit FCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+	FMalloc* GetInner() const { return Inner; }
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Count, Alignment);
+	}
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->TryMalloc(Count, Alignment);
+	}
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->TryRealloc(Original, Count, Alignment);
+	}
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+private:
+	FMalloc* Inner;
+
+	void CountAllocation()
+	{
+		NumAllocations.fetch_add(1, std::memory_order_relaxed);
+		if (IsInGameThread())
+		{
+			NumGameThreadAllocations++;
+		}
+	}
+};
+
+std::atomic<int64> FCountingMalloc::NumAllocations(0);
+int64 FCountingMalloc::NumGameThreadAllocations = 0;
+// Never deleted: another thread can still be inside it right after GMalloc is switched back.
+static FCountingMalloc* CountingMalloc = nullptr;
+static bool IsCountingAllocations = false;
+
+void UPerfScenarioSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	FString ScenarioName;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("PerfScenario="), ScenarioName))	return;
+
+	int64 Value = StaticEnum<EPerfScenario>()->GetValueByNameString(ScenarioName);
+	if (Value == INDEX_NONE || Value == (int64)EPerfScenario::None)
+	{
+		UE_LOG(LogCrustyPirate, Error, TEXT("Unknown perf scenario %s"), *ScenarioName);
+		FPlatformMisc::RequestExitWithStatus(false, 2);
+		return;
+	}
+	Scenario = (EPerfScenario)Value;
+	WriteBaseline = FParse::Param(FCommandLine::Get(), TEXT("PerfWriteBaseline"));
+	FParse::Value(FCommandLine::Get(), TEXT("PerfEnemies="), NumEnemies);
+	FParse::Value(FCommandLine::Get(), TEXT("PerfEnemyArchetype="), EnemyArchetype);
+	FParse::Value(FCommandLine::Get(), TEXT("PerfCollectables="), NumCollectables);
+	FParse::Value(FCommandLine::Get(), TEXT("PerfLevelExits="), NumLevelExits);
+	FParse::Value(FCommandLine::Get(), TEXT("PerfFrames="), MeasuredFrames);
+	CheckZeroAllocations = FParse::Param(FCommandLine::Get(), TEXT("PerfZeroAlloc"));
+	CountAllocations = CheckZeroAllocations || FParse::Param(FCommandLine::Get(), TEXT("PerfCountAllocations"));
+	if (CountAllocations)
+	{
+		StartCountingAllocations();
+	}
+	FWorldDelegates::OnWorldTickStart.AddUObject(this, &UPerfScenarioSubsystem::OnWorldTickStart);
+	FCoreDelegates::OnEndFrame.AddUObject(this, &UPerfScenarioSubsystem::OnEndFrame);
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &UPerfScenarioSubsystem::OnPreGarbageCollect);
+	FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &UPerfScenarioSubsystem::OnPostGarbageCollect);
+}
+
+void UPerfScenarioSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.RemoveAll(this);
+	FCoreDelegates::OnEndFrame.RemoveAll(this);
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().RemoveAll(this);
+	FCoreUObjectDelegates::GetPostGarbageCollect().RemoveAll(this);
+	if (CountAllocations)
+	{
+		StopCountingAllocations();
+	}
+	Super::Deinitialize();
+}
+
+void UPerfScenarioSubsystem::Tick(float DeltaTime)
+{
+	double Now = FPlatformTime::Seconds();
+	if (!IsSetUp)
+	{
+		UWorld* World = GetGameInstance()->GetWorld();
+		Player = World ? Cast<APlayerCharacter>(UGameplayStatics::GetPlayerCharacter(World, 0)) : nullptr;
+		if (!Player || !World->HasBegunPlay())	return;
+		SetUpScenario(World);
+		// Growing the result arrays mid-run would show up in the allocation counts.
+		Results.GameThreadMs.Reserve(MeasuredFrames);
+		Results.FrameMs.Reserve(MeasuredFrames);
+		Results.Allocations.Reserve(MeasuredFrames);
+		Results.TickAllocations.Reserve(MeasuredFrames);
+		IsSetUp = true;
+		LastFrameTime = Now;
+		FrameStartAllocations = GetAllocationCount();
+		return;
+	}
+
+	Frame++;
+	int64 Allocations = GetAllocationCount();
+	if (Frame > WarmupFrames)
+	{
+		Results.FrameMs.Add((Now - LastFrameTime) * 1000.0);
+		Results.Allocations.Add(Allocations - FrameStartAllocations);
+		Results.PeakUsedPhysical = FMath::Max<uint64>(Results.PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+	}
+	LastFrameTime = Now;
+	FrameStartAllocations = Allocations;
+
+	if (Frame >= WarmupFrames + MeasuredFrames)
+	{
+		FinishScenario();
+	}
+}
+
+TStatId UPerfScenarioSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPerfScenarioSubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType UPerfScenarioSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+void UPerfScenarioSubsystem::StartCountingAllocations()
+{
+	check(IsInGameThread());
+	if (IsCountingAllocations)	return;
+	if (!CountingMalloc)
+	{
+		CountingMalloc = new FCountingMalloc(GMalloc);
+	}
+	FCountingMalloc::NumAllocations = 0;
+	FCountingMalloc::NumGameThreadAllocations = 0;
+	GMalloc = CountingMalloc;
+	IsCountingAllocations = true;
+}
+
+void UPerfScenarioSubsystem::StopCountingAllocations()
+{
+	check(IsInGameThread());
+	if (!IsCountingAllocations)	return;
+	GMalloc = CountingMalloc->GetInner();
+	IsCountingAllocations = false;
+}
+
+int64 UPerfScenarioSubsystem::GetAllocationCount()
+{
+	return IsCountingAllocations ? FCountingMalloc::NumAllocations.load(std::memory_order_relaxed) : -1;
+}
+
+int64 UPerfScenarioSubsystem::GetGameThreadAllocationCount()
+{
+	return IsCountingAllocations ? FCountingMalloc::NumGameThreadAllocations : -1;
+}
+
+void UPerfScenarioSubsystem::SetUpScenario(UWorld* World)
+{
+	// Everything is laid out on a flat floor running to the right of the player start.
+	FVector Origin = Player->GetActorLocation();
+	float FeetZ = Origin.Z - Player->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	int32 NumSlots = NumEnemies + NumCollectables + NumLevelExits;
+	float Length = SpawnSpacing * NumSlots + 4000.0f;
+
+	AActor* Floor = World->SpawnActor<AActor>();
+	UBoxComponent* FloorBox = NewObject<UBoxComponent>(Floor, TEXT("PerfFloor"));
+	FloorBox->SetBoxExtent(FVector(Length * 0.5f, 1000.0f, 50.0f));
+	FloorBox->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	Floor->SetRootComponent(FloorBox);
+	FloorBox->RegisterComponent();
+	Floor->SetActorLocation(FVector(Origin.X + Length * 0.5f - 2000.0f, Origin.Y, FeetZ - 50.0f));
+
+	// The player must survive the whole run for frames to stay comparable.
+	Player->IsInvulnerable = true;
+
+	UActorPoolSubsystem* Pool = World->GetSubsystem<UActorPoolSubsystem>();
+	UEnemyArchetypeSubsystem* Archetypes = EnemyArchetype.IsNone() ? nullptr : World->GetSubsystem<UEnemyArchetypeSubsystem>();
+	UClass* Enemy = EnemyClass.TryLoadClass<AEnemy>();
+	UClass* Collectable = CollectableClass.TryLoadClass<ACollectableItem>();
+	UClass* LevelExit = LevelExitClass.TryLoadClass<ALevelExit>();
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Populations are interleaved so every scenario crosses all three kinds of actors.
+	int32 Spawned[3] = { 0, 0, 0 };
+	int32 Wanted[3] = { NumEnemies, NumCollectables, NumLevelExits };
+	UClass* Classes[3] = { Enemy, Collectable, LevelExit };
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
+	{
+		int32 Kind = 0;
+		float Best = -1.0f;
+		for (int32 i = 0; i < 3; i++)
+		{
+			float Remaining = Wanted[i] > 0 ? 1.0f - (float)Spawned[i] / Wanted[i] : -1.0f;
+			if (Remaining > Best)
+			{
+				Best = Remaining;
+				Kind = i;
+			}
+		}
+		Spawned[Kind]++;
+		if (!Classes[Kind] && !(Kind == 0 && Archetypes))	continue;
+
+		FVector Location(Origin.X + 300.0f + Slot * SpawnSpacing, Origin.Y, Origin.Z);
+		// Chase keeps the player still, so enemies are placed on both sides within reach.
+		if (Scenario == EPerfScenario::Chase && Kind == 0)
+		{
+			Location.X = Origin.X + ((Slot & 1) ? -1.0f : 1.0f) * (200.0f + (Slot / 2) * SpawnSpacing * 0.25f);
+		}
+		AActor* Actor = nullptr;
+		if (Kind == 0 && Archetypes)
+		{
+			Actor = Archetypes->SpawnEnemy(EnemyArchetype, FTransform(Location));
+		}
+		else
+		{
+			Actor = Pool && Kind != 2 ? Pool->Acquire(Classes[Kind], FTransform(Location)) : World->SpawnActor<AActor>(Classes[Kind], FTransform(Location), SpawnParams);
+		}
+		if (ALevelExit* Exit = Cast<ALevelExit>(Actor))
+		{
+			// Level index 0 never loads another map.
+			Exit->LevelIndex = 0;
+		}
+	}
+	UE_LOG(LogCrustyPirate, Display, TEXT("Perf scenario %s: %d enemies, %d collectables, %d level exits"),
+		*StaticEnum<EPerfScenario>()->GetNameStringByValue((int64)Scenario), NumEnemies, NumCollectables, NumLevelExits);
+}
+
+void UPerfScenarioSubsystem::DriveScenario()
+{
+	if (!IsValid(Player))	return;
+	switch (Scenario)
+	{
+		case EPerfScenario::Chase:
+		{
+		}break;
+		case EPerfScenario::Attack:
+		{
+			Player->Move(FInputActionValue(1.0f));
+			if (Frame % 20 == 0)
+			{
+				Player->Attack(FInputActionValue(true));
+			}
+		}break;
+		case EPerfScenario::Pickup:
+		{
+			Player->Move(FInputActionValue(1.0f));
+		}break;
+		case EPerfScenario::LevelExit:
+		{
+			// Exits deactivate the player; keep running to the next one.
+			if (!Player->IsActive)
+			{
+				Player->Activate();
+			}
+			Player->Move(FInputActionValue(1.0f));
+		}break;
+		default:
+		{
+		}break;
+	}
+}
+
+void UPerfScenarioSubsystem::FinishScenario()
+{
+	FString ScenarioName = StaticEnum<EPerfScenario>()->GetNameStringByValue((int64)Scenario);
+	Scenario = EPerfScenario::None;
+
+	TSharedRef<FJsonObject> Json = MakeResultsJson();
+	Json->SetStringField(TEXT("scenario"), ScenarioName);
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Json, Writer);
+
+	FString ResultsPath = FPaths::ProjectSavedDir() / TEXT("Profiling/CrustyPirate") / FString::Printf(TEXT("Perf_%s.json"), *ScenarioName);
+	FFileHelper::SaveStringToFile(Output, *ResultsPath);
+	FString BaselinePath = FPaths::ProjectDir() / BaselineDirectory / ScenarioName + TEXT(".json");
+	if (WriteBaseline)
+	{
+		SaveBaseline(BaselinePath, Json);
+		UE_LOG(LogCrustyPirate, Display, TEXT("Perf scenario %s: baseline written to %s"), *ScenarioName, *BaselinePath);
+	}
+
+	bool Passed = CompareWithBaseline(ScenarioName, *Json->GetObjectField(TEXT("metrics")));
+	if (CheckZeroAllocations)
+	{
+		Passed &= CheckTickAllocations();
+	}
+	UE_LOG(LogCrustyPirate, Display, TEXT("Perf scenario %s %s, results in %s"), *ScenarioName, Passed ? TEXT("PASSED") : TEXT("FAILED"), *ResultsPath);
+	FPlatformMisc::RequestExitWithStatus(false, Passed ? 0 : 1);
+}
+
+TSharedRef<FJsonObject> UPerfScenarioSubsystem::MakeResultsJson() const
+{
+	auto Average = [](const auto& Values)
+	{
+		double Sum = 0.0;
+		for (auto Value : Values)
+		{
+			Sum += Value;
+		}
+		return Values.Num() > 0 ? Sum / Values.Num() : 0.0;
+	};
+	auto Percentile = [](auto Values, double Fraction)
+	{
+		if (Values.Num() == 0)	return 0.0;
+		Values.Sort();
+		return (double)Values[FMath::Min(Values.Num() - 1, FMath::FloorToInt(Values.Num() * Fraction))];
+	};
+
+	TSharedRef<FJsonObject> Metrics = MakeShared<FJsonObject>();
+	if (CountAllocations)
+	{
+		Metrics->SetNumberField(TEXT("AllocationsPerFrameAvg"), Average(Results.Allocations));
+		Metrics->SetNumberField(TEXT("AllocationsPerFrameMax"), Percentile(Results.Allocations, 1.0));
+		Metrics->SetNumberField(TEXT("TickAllocationsPerFrameAvg"), Average(Results.TickAllocations));
+		Metrics->SetNumberField(TEXT("TickAllocationsPerFrameMax"), Percentile(Results.TickAllocations, 1.0));
+	}
+	else
+	{
+		Metrics->SetNumberField(TEXT("GameThreadMsAvg"), Average(Results.GameThreadMs));
+		Metrics->SetNumberField(TEXT("GameThreadMsP95"), Percentile(Results.GameThreadMs, 0.95));
+		Metrics->SetNumberField(TEXT("FrameMsAvg"), Average(Results.FrameMs));
+		Metrics->SetNumberField(TEXT("PeakUsedPhysicalMB"), Results.PeakUsedPhysical / (1024.0 * 1024.0));
+		Metrics->SetNumberField(TEXT("GCMsTotal"), Results.GCMs);
+	}
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetStringField(TEXT("mode"), CountAllocations ? TEXT("allocations") : TEXT("timing"));
+	Json->SetNumberField(TEXT("frames"), Results.FrameMs.Num());
+	Json->SetNumberField(TEXT("enemies"), NumEnemies);
+	Json->SetNumberField(TEXT("collectables"), NumCollectables);
+	Json->SetNumberField(TEXT("levelExits"), NumLevelExits);
+	Json->SetNumberField(TEXT("garbageCollections"), Results.NumGCs);
+	Json->SetObjectField(TEXT("metrics"), Metrics);
+	return Json;
+}
+
+bool UPerfScenarioSubsystem::CompareWithBaseline(const FString& ScenarioName, const FJsonObject& Metrics) const
+{
+	FString BaselinePath = FPaths::ProjectDir() / BaselineDirectory / ScenarioName + TEXT(".json");
+	FString BaselineText;
+	TSharedPtr<FJsonObject> Baseline;
+	const TSharedPtr<FJsonObject>* BaselineMetrics = nullptr;
+	if (!FFileHelper::LoadFileToString(BaselineText, *BaselinePath)
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineText), Baseline) || !Baseline.IsValid()
+		|| !Baseline->TryGetObjectField(TEXT("metrics"), BaselineMetrics) || (*BaselineMetrics)->Values.Num() == 0)
+	{
+		UE_LOG(LogCrustyPirate, Error, TEXT("No perf baseline at %s; record one with -PerfWriteBaseline on the reference machine"), *BaselinePath);
+		return false;
+	}
+
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Entry : Metrics.Values)
+	{
+		if (!(*BaselineMetrics)->HasField(Entry.Key))
+		{
+			UE_LOG(LogCrustyPirate, Warning, TEXT("  %-24s %10.3f is not in the baseline and was not checked"), *Entry.Key, Entry.Value->AsNumber());
+		}
+	}
+	return CompareMetrics(**BaselineMetrics, Metrics, RegressionThresholdPercent);
+}
+
+bool UPerfScenarioSubsystem::CompareMetrics(const FJsonObject& BaselineMetrics, const FJsonObject& Metrics, float RegressionThresholdPercent)
+{
+	bool Passed = true;
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Entry : BaselineMetrics.Values)
+	{
+		double BaselineValue = Entry.Value->AsNumber();
+		double Value = 0.0;
+		// Timing runs do not report allocation metrics and the other way round.
+		if (!Metrics.TryGetNumberField(Entry.Key, Value))	continue;
+		double Limit = BaselineValue * (1.0 + RegressionThresholdPercent / 100.0);
+		bool Regressed = Value > Limit;
+		UE_LOG(LogCrustyPirate, Display, TEXT("  %-24s %10.3f (baseline %10.3f)%s"), *Entry.Key, Value, BaselineValue, Regressed ? TEXT("  REGRESSED") : TEXT(""));
+		Passed &= !Regressed;
+	}
+	return Passed;
+}
+
+void UPerfScenarioSubsystem::SaveBaseline(const FString& BaselinePath, const TSharedRef<FJsonObject>& Json) const
+{
+	// Metrics this run did not measure are kept from the existing baseline.
+	FString BaselineText;
+	TSharedPtr<FJsonObject> Baseline;
+	const TSharedPtr<FJsonObject>* BaselineMetrics = nullptr;
+	TSharedRef<FJsonObject> Metrics = MakeShared<FJsonObject>();
+	if (FFileHelper::LoadFileToString(BaselineText, *BaselinePath)
+		&& FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineText), Baseline) && Baseline.IsValid()
+		&& Baseline->TryGetObjectField(TEXT("metrics"), BaselineMetrics))
+	{
+		Metrics->Values = (*BaselineMetrics)->Values;
+	}
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Entry : Json->GetObjectField(TEXT("metrics"))->Values)
+	{
+		Metrics->SetField(Entry.Key, Entry.Value);
+	}
+
+	TSharedRef<FJsonObject> Output = MakeShared<FJsonObject>();
+	Output->Values = Json->Values;
+	Output->RemoveField(TEXT("mode"));
+	Output->SetObjectField(TEXT("metrics"), Metrics);
+	FString OutputText;
+	FJsonSerializer::Serialize(Output, TJsonWriterFactory<>::Create(&OutputText));
+	FFileHelper::SaveStringToFile(OutputText, *BaselinePath);
+}
+
+bool UPerfScenarioSubsystem::CheckTickAllocations() const
+{
+	int32 NumFramesOver = 0;
+	int64 MaxAllocations = 0;
+	int32 WorstFrame = INDEX_NONE;
+	for (int32 i = 0; i < Results.TickAllocations.Num(); i++)
+	{
+		if (Results.TickAllocations[i] > MaxTickAllocationsPerFrame)
+		{
+			NumFramesOver++;
+		}
+		if (Results.TickAllocations[i] > MaxAllocations)
+		{
+			MaxAllocations = Results.TickAllocations[i];
+			WorstFrame = i;
+		}
+	}
+	if (NumFramesOver == 0)
+	{
+		UE_LOG(LogCrustyPirate, Display, TEXT("  Steady state: at most %lld game thread allocations per frame over %d frames"), MaxAllocations, Results.TickAllocations.Num());
+		return true;
+	}
+	UE_LOG(LogCrustyPirate, Error, TEXT("  Steady state: %d of %d frames made more than %d game thread allocations per frame, worst %lld in measured frame %d"),
+		NumFramesOver, Results.TickAllocations.Num(), MaxTickAllocationsPerFrame, MaxAllocations, WorstFrame);
+	return false;
+}
+
+void UPerfScenarioSubsystem::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (!IsSetUp || World != GetGameInstance()->GetWorld())	return;
+	TickStartAllocations = GetGameThreadAllocationCount();
+	// Scripted input goes in before the world ticks, like live input would.
+	DriveScenario();
+	WorldTickStartTime = FPlatformTime::Seconds();
+}
+
+void UPerfScenarioSubsystem::OnEndFrame()
+{
+	// Closing the window here rather than after actor ticking also covers timers, tickables, latent actions
+	// and everything else the engine runs on the game thread once the world has ticked.
+	if (!IsRunning() || !IsSetUp || WorldTickStartTime <= 0.0)	return;
+	// Tick has already counted this frame, so the windows line up with FrameMs.
+	if (Frame > WarmupFrames)
+	{
+		int64 TickAllocations = GetGameThreadAllocationCount() - TickStartAllocations;
+		Results.GameThreadMs.Add((FPlatformTime::Seconds() - WorldTickStartTime) * 1000.0);
+		Results.TickAllocations.Add(TickAllocations);
+	}
+	WorldTickStartTime = 0.0;
+}
+
+void UPerfScenarioSubsystem::OnPreGarbageCollect()
+{
+	GCStartTime = FPlatformTime::Seconds();
+}
+
+void UPerfScenarioSubsystem::OnPostGarbageCollect()
+{
+	if (GCStartTime <= 0.0 || !IsSetUp || Frame < WarmupFrames)	return;
+	Results.GCMs += (FPlatformTime::Seconds() - GCStartTime) * 1000.0;
+	Results.NumGCs++;
+	GCStartTime = 0.0;
+}
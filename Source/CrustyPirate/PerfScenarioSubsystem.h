@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "PerfScenarioSubsystem.generated.h"
+
+class APlayerCharacter;
+class FJsonObject;
+
+UENUM()
+enum class EPerfScenario : uint8
+{
+	None,
+	Chase,
+	Attack,
+	Pickup,
+	LevelExit
+};
+
+struct FPerfScenarioResults
+{
+	TArray<double> GameThreadMs;
+	TArray<double> FrameMs;
+	TArray<int64> Allocations;
+	TArray<int64> TickAllocations;
+	double GCMs = 0.0;
+	int32 NumGCs = 0;
+	uint64 PeakUsedPhysical = 0;
+};
+
+/**
+ * Headless benchmark scenarios.
+ *
+ * -PerfScenario=<Chase|Attack|Pickup|LevelExit>   build a flat test floor next to the player, spawn the
+ *                                                 configured enemies, collectables and level exits and
+ *                                                 drive the player through the scenario
+ * -PerfWriteBaseline                              store the results as the new baseline
+ * -PerfEnemies=, -PerfCollectables=, -PerfLevelExits=   override the configured populations
+ * -PerfFrames=                                   override MeasuredFrames
+ * -PerfEnemyArchetype=<Name>                     spawn the enemies from this UEnemyArchetype
+ * -PerfCountAllocations                          count allocations instead of measuring time
+ * -PerfZeroAlloc                                 count allocations and fail when the game thread allocates
+ *                                                 more than MaxTickAllocationsPerFrame during a measured frame
+ *
+ * Game thread time and allocations are measured from the start of the world tick to the end of the engine
+ * frame, so timers, tickables and end of frame work count along with actor ticks.
+ * Counting allocations routes every allocation through a proxy allocator, which skews timings, so a run
+ * either measures time (game thread and frame ms, peak memory, GC time) or counts allocations, never both.
+ * Results are written as JSON to Saved/Profiling/CrustyPirate/Perf_<Scenario>.json and compared with
+ * <BaselineDirectory>/<Scenario>.json. The process exits with a non-zero code when a metric regresses by more
+ * than RegressionThresholdPercent or when there is no baseline. -PerfWriteBaseline only replaces the metrics
+ * the run measured, so timing and allocation runs fill in the same baseline file.
+ *
+ * Meant to be run as: CrustyPirate Level_1 -PerfScenario=Chase -UseFixedTimeStep -FPS=60 -nullrhi -unattended -nosound
+ * The steady state allocation check is 60 seconds of the Attack scenario:
+ *   CrustyPirate Level_1 -PerfScenario=Attack -PerfFrames=3600 -PerfZeroAlloc -UseFixedTimeStep -FPS=60 -nullrhi -unattended -nosound
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UPerfScenarioSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	FSoftClassPath EnemyClass;
+
+	// When set, enemies are spawned through UEnemyArchetypeSubsystem by this archetype name instead of EnemyClass.
+	UPROPERTY(Config)
+	FName EnemyArchetype;
+
+	UPROPERTY(Config)
+	FSoftClassPath CollectableClass;
+
+	UPROPERTY(Config)
+	FSoftClassPath LevelExitClass;
+
+	UPROPERTY(Config)
+	int32 NumEnemies = 200;
+
+	UPROPERTY(Config)
+	int32 NumCollectables = 1000;
+
+	UPROPERTY(Config)
+	int32 NumLevelExits = 20;
+
+	UPROPERTY(Config)
+	float SpawnSpacing = 150.0f;
+
+	UPROPERTY(Config)
+	int32 WarmupFrames = 60;
+
+	UPROPERTY(Config)
+	int32 MeasuredFrames = 600;
+
+	UPROPERTY(Config)
+	FString BaselineDirectory = TEXT("Perf/Baselines");
+
+	UPROPERTY(Config)
+	float RegressionThresholdPercent = 10.0f;
+
+	// Game thread allocations allowed between the start of a world tick and the end of the engine frame
+	// when running with -PerfZeroAlloc.
+	UPROPERTY(Config)
+	int32 MaxTickAllocationsPerFrame = 0;
+
+	EPerfScenario Scenario = EPerfScenario::None;
+	bool IsSetUp = false;
+	bool WriteBaseline = false;
+	bool CountAllocations = false;
+	bool CheckZeroAllocations = false;
+	int32 Frame = 0;
+	double LastFrameTime = 0.0;
+	double WorldTickStartTime = 0.0;
+	double GCStartTime = 0.0;
+	int64 FrameStartAllocations = 0;
+	int64 TickStartAllocations = 0;
+	FPerfScenarioResults Results;
+
+	UPROPERTY()
+	APlayerCharacter* Player;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return Scenario != EPerfScenario::None; }
+
+	bool IsRunning() const { return Scenario != EPerfScenario::None; }
+	// Routes GMalloc through a counting proxy until StopCountingAllocations.
+	static void StartCountingAllocations();
+	static void StopCountingAllocations();
+	// Allocations made by any thread while counting, or -1 when allocation counting is off.
+	static int64 GetAllocationCount();
+	// Allocations made by the game thread while counting, or -1 when allocation counting is off.
+	static int64 GetGameThreadAllocationCount();
+
+	TSharedRef<FJsonObject> MakeResultsJson() const;
+	// Fails when there is no baseline for the scenario.
+	bool CompareWithBaseline(const FString& ScenarioName, const FJsonObject& Metrics) const;
+	// Every metric is lower-is-better; a zero baseline has to stay zero.
+	static bool CompareMetrics(const FJsonObject& BaselineMetrics, const FJsonObject& Metrics, float RegressionThresholdPercent);
+	bool CheckTickAllocations() const;
+	// Closes the game thread window opened by OnWorldTickStart.
+	void OnEndFrame();
+
+protected:
+	void SetUpScenario(UWorld* World);
+	void DriveScenario();
+	void FinishScenario();
+	void SaveBaseline(const FString& BaselinePath, const TSharedRef<FJsonObject>& Json) const;
+
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+};
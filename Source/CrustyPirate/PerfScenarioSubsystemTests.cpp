@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PerfScenarioSubsystem.h"
+#include "Dom/JsonObject.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPerfCountingMallocTest, "CrustyPirate.Perf.CountingMalloc",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPerfCountingMallocTest::RunTest(const FString& Parameters)
+{
+	// A perf scenario running in this process keeps its counter.
+	bool WasCounting = UPerfScenarioSubsystem::GetAllocationCount() >= 0;
+	UPerfScenarioSubsystem::StartCountingAllocations();
+	int64 StartAllocations = UPerfScenarioSubsystem::GetAllocationCount();
+	int64 StartGameThreadAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount();
+	void* Memory = FMemory::Malloc(64);
+	Memory = FMemory::Realloc(Memory, 128);
+	FMemory::Free(Memory);
+	TestTrue(TEXT("Malloc and Realloc are counted"), UPerfScenarioSubsystem::GetAllocationCount() - StartAllocations >= 2);
+	TestTrue(TEXT("Game thread allocations are counted"), UPerfScenarioSubsystem::GetGameThreadAllocationCount() - StartGameThreadAllocations >= 2);
+
+	if (!WasCounting)
+	{
+		UPerfScenarioSubsystem::StopCountingAllocations();
+		TestEqual(TEXT("No count once stopped"), UPerfScenarioSubsystem::GetAllocationCount(), (int64)-1);
+	}
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPerfBaselineComparisonTest, "CrustyPirate.Perf.BaselineComparison",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPerfBaselineComparisonTest::RunTest(const FString& Parameters)
+{
+	FJsonObject Baseline;
+	Baseline.SetNumberField(TEXT("GameThreadMsAvg"), 4.0);
+	Baseline.SetNumberField(TEXT("TickAllocationsPerFrameMax"), 0.0);
+
+	FJsonObject Same;
+	Same.SetNumberField(TEXT("GameThreadMsAvg"), 4.0);
+	TestTrue(TEXT("Equal to the baseline passes"), UPerfScenarioSubsystem::CompareMetrics(Baseline, Same, 10.0f));
+
+	FJsonObject WithinThreshold;
+	WithinThreshold.SetNumberField(TEXT("GameThreadMsAvg"), 4.3);
+	TestTrue(TEXT("Within the threshold passes"), UPerfScenarioSubsystem::CompareMetrics(Baseline, WithinThreshold, 10.0f));
+
+	FJsonObject Slower;
+	Slower.SetNumberField(TEXT("GameThreadMsAvg"), 4.5);
+	TestFalse(TEXT("Over the threshold fails"), UPerfScenarioSubsystem::CompareMetrics(Baseline, Slower, 10.0f));
+
+	FJsonObject Allocating;
+	Allocating.SetNumberField(TEXT("TickAllocationsPerFrameMax"), 1.0);
+	TestFalse(TEXT("A zero baseline has to stay zero"), UPerfScenarioSubsystem::CompareMetrics(Baseline, Allocating, 10.0f));
+
+	FJsonObject Unrelated;
+	Unrelated.SetNumberField(TEXT("PeakUsedPhysicalMB"), 512.0);
+	TestTrue(TEXT("Metrics the run did not measure are skipped"), UPerfScenarioSubsystem::CompareMetrics(Baseline, Unrelated, 10.0f));
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPerfMissingBaselineTest, "CrustyPirate.Perf.MissingBaseline",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPerfMissingBaselineTest::RunTest(const FString& Parameters)
+{
+	UPerfScenarioSubsystem* Perf = NewObject<UPerfScenarioSubsystem>();
+	Perf->BaselineDirectory = TEXT("Perf/NoSuchBaselines");
+	FJsonObject Metrics;
+	Metrics.SetNumberField(TEXT("GameThreadMsAvg"), 4.0);
+	AddExpectedError(TEXT("No perf baseline"), EAutomationExpectedErrorFlags::Contains, 1);
+	TestFalse(TEXT("A run without a baseline fails"), Perf->CompareWithBaseline(TEXT("Chase"), Metrics));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPerfTickAllocationsTest, "CrustyPirate.Perf.TickAllocations",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPerfTickAllocationsTest::RunTest(const FString& Parameters)
+{
+	bool WasCounting = UPerfScenarioSubsystem::GetAllocationCount() >= 0;
+	UPerfScenarioSubsystem::StartCountingAllocations();
+
+	// A measured frame whose window OnWorldTickStart opened; the allocation stands in for a timer or tickable
+	// running after the actors have ticked.
+	UPerfScenarioSubsystem* Perf = NewObject<UPerfScenarioSubsystem>();
+	Perf->Scenario = EPerfScenario::Attack;
+	Perf->IsSetUp = true;
+	Perf->WarmupFrames = 0;
+	Perf->Frame = 1;
+	Perf->TickStartAllocations = UPerfScenarioSubsystem::GetGameThreadAllocationCount();
+	Perf->WorldTickStartTime = FPlatformTime::Seconds();
+	void* Memory = FMemory::Malloc(64);
+	FMemory::Free(Memory);
+	Perf->OnEndFrame();
+	Perf->Scenario = EPerfScenario::None;
+
+	if (!WasCounting)
+	{
+		UPerfScenarioSubsystem::StopCountingAllocations();
+	}
+	TestEqual(TEXT("The end of the frame closes the window"), Perf->Results.TickAllocations.Num(), 1);
+	TestEqual(TEXT("Game thread time is recorded with it"), Perf->Results.GameThreadMs.Num(), 1);
+	TestTrue(TEXT("Allocations up to the end of the frame are counted"), Perf->Results.TickAllocations.Num() == 1 && Perf->Results.TickAllocations[0] >= 1);
+
+	Perf->Results.TickAllocations = { 0, 0, 0 };
+	TestTrue(TEXT("A steady state without allocations passes"), Perf->CheckTickAllocations());
+	Perf->MaxTickAllocationsPerFrame = 2;
+	Perf->Results.TickAllocations = { 0, 2, 1 };
+	TestTrue(TEXT("Allocations within the allowance pass"), Perf->CheckTickAllocations());
+	Perf->Results.TickAllocations = { 0, 3, 1 };
+	AddExpectedError(TEXT("Steady state"), EAutomationExpectedErrorFlags::Contains, 1);
+	TestFalse(TEXT("A frame over the allowance fails"), Perf->CheckTickAllocations());
+	return !HasAnyErrors();
+}
+
+#endif
@@ -2,9 +2,23 @@
 
 
 #include "PlayerCharacter.h"
+#include "CrustyPirate.h"
 #include "Enemy.h"
 #include "Kismet/GameplayStatics.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "CrustyPiratePerf.h"
+#include "CombatQueueSubsystem.h"
+#include "StatusEffectSubsystem.h"
+#include "AssetResidencySubsystem.h"
+#include "GameplayEventBus.h"
+#include "GameplayAudioSubsystem.h"
+#include "GameFramework/GameModeBase.h"
+#include "Net/UnrealNetwork.h"
+
+static const FName StateMachineName("CaptainStateMachine");
+static const FName HitNodeName("JumpHit");
+static const FName DieNodeName("JumpDie");
+static const FName AttackSlotName("DefaultSlot");
 
 APlayerCharacter::APlayerCharacter()
 {
@@ -15,25 +29,23 @@ APlayerCharacter::APlayerCharacter()
 	Camera->SetupAttachment(SpringArm, USpringArmComponent::SocketName);
 	AttackCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("AttackCollisionBox"));
 	AttackCollisionBox->SetupAttachment(RootComponent);
+#if UE_SERVER
+	GetSprite()->PrimaryComponentTick.bCanEverTick = false;
+#endif
 }
 
 void APlayerCharacter::BeginPlay()
 {
 	Super::BeginPlay();
-	if(APlayerController* PlayerController = Cast<APlayerController>(Controller))
-	{
-		UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer());
-		if (Subsystem)
-		{
-			Subsystem->AddMappingContext(InputMappingContext, 0);
-		}
-	}
 	OnAttackOverrideEndDelegate.BindUObject(this, &APlayerCharacter::OnAttackOverrideAnimEnd);
-	AttackCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &APlayerCharacter::AttackBoxOverlapBegin);
+	CRUSTYPIRATE_ADD_DYNAMIC(AttackCollisionBox->OnComponentBeginOverlap, this, &APlayerCharacter::AttackBoxOverlapBegin);
 	EnableAttackCollisionBox(false);
 	
 	MyGameInstance = Cast<UCrustyPirateGameInstance>(GetGameInstance());
-	if (MyGameInstance)
+	InputReplay = GetGameInstance()->GetSubsystem<UInputReplaySubsystem>();
+	InputLatency = GetGameInstance()->GetSubsystem<UInputLatencySubsystem>();
+	// Progress lives in the game instance of each process, so in network games players start fresh.
+	if (MyGameInstance && GetNetMode() == NM_Standalone)
 	{
 		HitPoints = MyGameInstance->PlayerHP;
 		if (MyGameInstance->IsDoubleJumpUnlocked)
@@ -41,10 +53,57 @@ void APlayerCharacter::BeginPlay()
 			UnlockDoubleJump();
 		}
 	}
+	UpdateCombatState();
+	SetupLocalPlayer();
+}
+
+void APlayerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// A respawned pawn creates its own.
+	if (PlayerHUDWidget)
+	{
+		PlayerHUDWidget->RemoveFromParent();
+	}
+	if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+	{
+		StatusEffects->CancelAll(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void APlayerCharacter::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+}
+
+void APlayerCharacter::NotifyControllerChanged()
+{
+	Super::NotifyControllerChanged();
+	SetupLocalPlayer();
+}
+
+void APlayerCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(APlayerCharacter, CombatState);
+}
+
+void APlayerCharacter::SetupLocalPlayer()
+{
+	// Clients can get the controller after BeginPlay, so this runs from both.
+	APlayerController* PlayerController = Cast<APlayerController>(Controller);
+	if (!PlayerController || !PlayerController->IsLocalController())	return;
+	UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer());
+	if (Subsystem)
+	{
+		Subsystem->AddMappingContext(InputMappingContext, 0);
+	}
 	
-	if (PlayerHUDClass)
+#if !UE_SERVER
+	// Widgets need a local player; controllers spawned without one (tests, bots) get no HUD.
+	if (PlayerHUDClass && !PlayerHUDWidget && MyGameInstance && PlayerController->GetLocalPlayer())
 	{
-		PlayerHUDWidget = CreateWidget<UPlayerHUD>(UGameplayStatics::GetPlayerController(GetWorld(), 0), PlayerHUDClass);
+		PlayerHUDWidget = CreateWidget<UPlayerHUD>(PlayerController, PlayerHUDClass);
 		if (PlayerHUDWidget)
 		{
 			PlayerHUDWidget->AddToPlayerScreen();
@@ -53,11 +112,7 @@ void APlayerCharacter::BeginPlay()
 			PlayerHUDWidget->SetLevel(MyGameInstance->CurrentLevelIndex);
 		}
 	}
-}
-
-void APlayerCharacter::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
+#endif
 }
 
 void APlayerCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -77,36 +132,83 @@ void APlayerCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCom
 void APlayerCharacter::Move(const FInputActionValue& Value)
 {
 	float MoveActionValue = Value.Get<float>();
+	if (InputReplay && !InputReplay->HandleInput(EReplayAction::Move, MoveActionValue))	return;
 	if (IsAlive && CanMove && !IsStunned)
 	{
 		FVector Direction = FVector(1.0f, 0.0f, 0.0f);
 		AddMovementInput(Direction, MoveActionValue);
 		UpdateDirection(MoveActionValue);
+		if (InputLatency)
+		{
+			InputLatency->NoteActionHandled(EInputLatencyAction::Move);
+		}
 	}
 }
 
 void APlayerCharacter::JumpStarted(const FInputActionValue& Value)
 {
+	if (InputReplay && !InputReplay->HandleInput(EReplayAction::JumpStarted, 1.0f))	return;
 	if (IsAlive && CanMove && !IsStunned)
 	{
 		Jump();
+		if (InputLatency)
+		{
+			InputLatency->NoteActionHandled(EInputLatencyAction::Jump);
+		}
 	}
 }
 
 void APlayerCharacter::JumpEnded(const FInputActionValue& Value)
 {
+	if (InputReplay && !InputReplay->HandleInput(EReplayAction::JumpEnded, 0.0f))	return;
 	StopJumping();
 }
 
 void APlayerCharacter::Attack(const FInputActionValue& Value)
 {
-	if (IsAlive && CanMove && !IsStunned)
+	if (InputReplay && !InputReplay->HandleInput(EReplayAction::Attack, 1.0f))	return;
+	// The client plays the swing right away; the server runs its own, which owns the hitbox.
+	if (StartAttack() && !HasAuthority())
 	{
-		CanMove = false;
-		CanAttack = false;
-		// EnableAttackCollisionBox(true);
-		GetAnimInstance()->PlayAnimationOverride(AttackAnimSequence, FName("DefaultSlot"), 1.0f, 0.0f, OnAttackOverrideEndDelegate);
+		ServerAttack();
+	}
+}
+
+bool APlayerCharacter::StartAttack()
+{
+	if (!IsAlive || !CanMove || IsStunned)	return false;
+	CanMove = false;
+	CanAttack = false;
+	// EnableAttackCollisionBox(true);
+	if (UAssetResidencySubsystem* Residency = GetGameInstance()->GetSubsystem<UAssetResidencySubsystem>())
+	{
+		Residency->NoteAssetUse(AttackAnimSequence);
+	}
+	GetAnimInstance()->PlayAnimationOverride(AttackAnimSequence, AttackSlotName, 1.0f, 0.0f, OnAttackOverrideEndDelegate);
+	if (InputLatency && IsLocallyControlled())
+	{
+		InputLatency->NoteActionHandled(EInputLatencyAction::Attack);
 	}
+	// The anim notify still enables the box later, which is a no-op while it is already enabled.
+	if (InputLatency && InputLatency->UseLowLatencyMode)
+	{
+		UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>();
+		if (StatusEffects && InputLatency->PredictedHitboxDelay > 0.0f)
+		{
+			StatusEffects->Schedule(this, EStatusEffect::PredictedHitbox, InputLatency->PredictedHitboxDelay);
+		}
+		else
+		{
+			EnableAttackCollisionBox(true);
+		}
+	}
+	UpdateCombatState();
+	return true;
+}
+
+void APlayerCharacter::ServerAttack_Implementation()
+{
+	StartAttack();
 }
 
 void APlayerCharacter::UpdateDirection(float MoveDirection)
@@ -135,13 +237,20 @@ void APlayerCharacter::OnAttackOverrideAnimEnd(bool Completed)
 		CanAttack = true;
 		CanMove = true;
 	}
-
+	UpdateCombatState();
 }
 
 void APlayerCharacter::AttackBoxOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CRUSTYPIRATE_SCOPE(PlayerAttackOverlap);
+	if (!HasAuthority())	return;
 	AEnemy* Enemy = Cast<AEnemy>(OtherActor);
-	if (Enemy)
+	if (!Enemy)	return;
+	if (UCombatQueueSubsystem* Combat = GetWorld()->GetSubsystem<UCombatQueueSubsystem>())
+	{
+		Combat->QueueDamage(this, Enemy, AttackDamage, AttackStunDuration, SwingId);
+	}
+	else
 	{
 		Enemy->TakeDamage(AttackDamage, AttackStunDuration);
 	}
@@ -149,8 +258,24 @@ void APlayerCharacter::AttackBoxOverlapBegin(UPrimitiveComponent* OverlappedComp
 
 void APlayerCharacter::EnableAttackCollisionBox(bool Enabled)
 {
+	bool WasEnabled = AttackCollisionBox->GetCollisionEnabled() != ECollisionEnabled::NoCollision;
+	if (WasEnabled && !Enabled)
+	{
+		if (UCombatQueueSubsystem* Combat = GetWorld()->GetSubsystem<UCombatQueueSubsystem>())
+		{
+			Combat->EndSwing(this);
+		}
+	}
 	if (Enabled)
 	{
+		if (!WasEnabled)
+		{
+			SwingId++;
+			if (InputLatency)
+			{
+				InputLatency->NoteActionEffect(EInputLatencyAction::Attack);
+			}
+		}
 		AttackCollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		AttackCollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Overlap);
 	}
@@ -158,47 +283,114 @@ void APlayerCharacter::EnableAttackCollisionBox(bool Enabled)
 	{
 		AttackCollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		AttackCollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Ignore);
+		if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+		{
+			StatusEffects->Cancel(this, EStatusEffect::PredictedHitbox);
+		}
 	}
 }
 
 void APlayerCharacter::UpdateHP(int NewHP)
 {
 	HitPoints = NewHP;
-	PlayerHUDWidget->SetHp(HitPoints);
-	MyGameInstance->SetPlayerHP(HitPoints);
+	if (PlayerHUDWidget)
+	{
+		PlayerHUDWidget->SetHp(HitPoints);
+	}
+	if (IsLocallyControlled())
+	{
+		MyGameInstance->SetPlayerHP(HitPoints);
+	}
 }
 
 void APlayerCharacter::TakeDamage(int DamageAmount, float StunDuration)
 {
-	if (!IsAlive)	return;
-	if (!IsActive)	return;
-	UpdateHP(HitPoints - DamageAmount);
+	if (!CanReceiveDamage())	return;
+	ApplyDamageResult(FMath::Max(HitPoints - DamageAmount, 0), StunDuration);
+}
+
+bool APlayerCharacter::IsInvulnerableAfterHit() const
+{
+	// Matches ApplyDamageResult, which only grants invulnerability through the status effect subsystem.
+	return InvulnerabilityDuration > 0.0f && GetWorld()->GetSubsystem<UStatusEffectSubsystem>();
+}
+
+void APlayerCharacter::ApplyDamageResult(int NewHitPoints, float StunDuration)
+{
+	CRUSTYPIRATE_SCOPE(PlayerTakeDamage);
+	UGameplayEventBus::PublishEvent(this, EGameplayEventType::DamageApplied, nullptr, this, HitPoints - NewHitPoints);
+	UpdateHP(NewHitPoints);
 	Stun(StunDuration);
+	CombatState.NoteHit();
 	if (HitPoints <= 0)
 	{
-		UpdateHP(0);
+		UGameplayEventBus::PublishEvent(this, EGameplayEventType::PlayerDied, nullptr, this, 0);
 		IsAlive = false;
 		CanMove = false;
 		CanAttack = false;
-		GetAnimInstance()->JumpToNode(FName("JumpDie"), FName("CaptainStateMachine"));
+		GetAnimInstance()->JumpToNode(DieNodeName, StateMachineName);
 		EnableAttackCollisionBox(false);
 		float RestartDelay = 3.0f;
-		GetWorldTimerManager().SetTimer(RestartGameTimer, this, &APlayerCharacter::OnRestartGameTimerTimeout, 1.0f, false, RestartDelay);
+		if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+		{
+			StatusEffects->Schedule(this, EStatusEffect::RestartDelay, RestartDelay);
+		}
 	}
 	else{
-		GetAnimInstance()->JumpToNode(FName("JumpHit"), FName("CaptainStateMachine"));
+		GetAnimInstance()->JumpToNode(HitNodeName, StateMachineName);
+		if (InvulnerabilityDuration > 0.0f)
+		{
+			if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
+			{
+				IsInvulnerable = true;
+				StatusEffects->Schedule(this, EStatusEffect::Invulnerability, InvulnerabilityDuration);
+			}
+		}
 	}
+	UpdateCombatState();
+}
+
+void APlayerCharacter::UpdateCombatState()
+{
+	if (!HasAuthority())	return;
+	CombatState.Set(HitPoints, IsAlive, IsStunned, IsAlive && !CanAttack && IsActive);
+}
+
+void APlayerCharacter::OnRep_CombatState(const FCombatNetState& PreviousState)
+{
+	bool WasAlive = IsAlive;
+	IsAlive = CombatState.HasFlag(FCombatNetState::Flag_Alive);
+	IsStunned = CombatState.HasFlag(FCombatNetState::Flag_Stunned);
+	UpdateHP(CombatState.HitPoints);
+	if (!IsAlive && WasAlive)
+	{
+		CanMove = false;
+		CanAttack = false;
+		GetAnimInstance()->StopAllAnimationOverrides();
+		GetAnimInstance()->JumpToNode(DieNodeName, StateMachineName);
+	}
+	else if (IsAlive && CombatState.HitCount != PreviousState.HitCount)
+	{
+		GetAnimInstance()->StopAllAnimationOverrides();
+		GetAnimInstance()->JumpToNode(HitNodeName, StateMachineName);
+	}
+	// The owning client already played its own swing when the input came in.
+	if (IsAlive && !IsLocallyControlled() && CombatState.HasFlag(FCombatNetState::Flag_Attacking) && !PreviousState.HasFlag(FCombatNetState::Flag_Attacking))
+	{
+		GetAnimInstance()->PlayAnimationOverride(AttackAnimSequence, AttackSlotName);
+	}
+	UpdateCombatState();
 }
 
 void APlayerCharacter::Stun(float DurationInSeconds)
 {
+	CRUSTYPIRATE_SCOPE(PlayerStun);
 	IsStunned = true;
-	bool IsTimerAlreadyActive = GetWorldTimerManager().IsTimerActive(StunTimer);
-	if (IsTimerAlreadyActive)
+	if (UStatusEffectSubsystem* StatusEffects = GetWorld()->GetSubsystem<UStatusEffectSubsystem>())
 	{
-		GetWorldTimerManager().ClearTimer(StunTimer);
+		StatusEffects->Schedule(this, EStatusEffect::Stun, DurationInSeconds);
 	}
-	GetWorldTimerManager().SetTimer(StunTimer, this, &APlayerCharacter::OnStunTimerTimeout, 1.0f, false, DurationInSeconds);
+	UpdateCombatState();
 	GetAnimInstance()->StopAllAnimationOverrides();
 	EnableAttackCollisionBox(false);
 }
@@ -206,31 +398,60 @@ void APlayerCharacter::Stun(float DurationInSeconds)
 void APlayerCharacter::OnStunTimerTimeout()
 {
 	IsStunned = false;
+	UpdateCombatState();
 }
 
 void APlayerCharacter::CollectItem(CollectableType ItemType)
 {
-	UGameplayStatics::PlaySound2D(GetWorld(), ItemPickupSound);
+	CRUSTYPIRATE_SCOPE(CollectItem);
+	// The server applies the pickup to the pawn; sound, HUD and progress belong to the owning client.
+	if (HasAuthority() && !IsLocallyControlled())
+	{
+		ClientCollectItem(ItemType);
+	}
+	bool IsLocal = IsLocallyControlled();
+#if !UE_SERVER
+	if (IsLocal)
+	{
+		if (UAssetResidencySubsystem* Residency = GetGameInstance()->GetSubsystem<UAssetResidencySubsystem>())
+		{
+			Residency->NoteAssetUse(ItemPickupSound);
+		}
+		UGameplayAudioSubsystem::PlaySound2D(this, ItemPickupSound);
+	}
+#endif
 
 	switch (ItemType)
 	{
 		case CollectableType::HealthPotion:
 		{
-			int HealAmount = 25;
-			UpdateHP(HitPoints + HealAmount);
+			// HP reaches the owning client through CombatState.
+			if (HasAuthority())
+			{
+				int HealAmount = 25;
+				UpdateHP(HitPoints + HealAmount);
+				UpdateCombatState();
+			}
 		}break;
 		case CollectableType::Diamond:
 		{
-			MyGameInstance->AddDiamond(1);
-			PlayerHUDWidget->SetDiamonds(MyGameInstance->CollectedDiamondCount);
+			if (IsLocal)
+			{
+				MyGameInstance->AddDiamond(1);
+				if (PlayerHUDWidget)
+				{
+					PlayerHUDWidget->SetDiamonds(MyGameInstance->CollectedDiamondCount);
+				}
+			}
 		}break;
 		case CollectableType::DoubleJumpUpgrade:
 		{
-			if (!MyGameInstance->IsDoubleJumpUnlocked)
+			// Both sides need the jump count for movement to agree.
+			if (IsLocal)
 			{
 				MyGameInstance->IsDoubleJumpUnlocked = true;
-				UnlockDoubleJump();
 			}
+			UnlockDoubleJump();
 		}break;
 		default:
 		{
@@ -238,6 +459,11 @@ void APlayerCharacter::CollectItem(CollectableType ItemType)
 	}
 }
 
+void APlayerCharacter::ClientCollectItem_Implementation(CollectableType ItemType)
+{
+	CollectItem(ItemType);
+}
+
 void APlayerCharacter::UnlockDoubleJump()
 {
 	JumpMaxCount = 2;
@@ -245,9 +471,53 @@ void APlayerCharacter::UnlockDoubleJump()
 
 void APlayerCharacter::OnRestartGameTimerTimeout()
 {
+	if (GetNetMode() != NM_Standalone)
+	{
+		// The others keep playing; only this player starts over.
+		AController* OwningController = Controller;
+		AGameModeBase* GameMode = GetWorld()->GetAuthGameMode();
+		if (OwningController && GameMode)
+		{
+			OwningController->UnPossess();
+			Destroy();
+			GameMode->RestartPlayer(OwningController);
+		}
+		return;
+	}
 	MyGameInstance->RestartGame();
 }
 
+void APlayerCharacter::OnStatusEffectExpired(EStatusEffect Effect)
+{
+	switch (Effect)
+	{
+		case EStatusEffect::Stun:
+		{
+			OnStunTimerTimeout();
+		}break;
+		case EStatusEffect::Invulnerability:
+		{
+			IsInvulnerable = false;
+			UpdateCombatState();
+		}break;
+		case EStatusEffect::RestartDelay:
+		{
+			OnRestartGameTimerTimeout();
+		}break;
+		case EStatusEffect::PredictedHitbox:
+		{
+			// Only if the swing was not interrupted in the meantime.
+			if (IsAlive && !CanAttack && !IsStunned)
+			{
+				EnableAttackCollisionBox(true);
+			}
+		}break;
+		default:
+		{
+		}break;
+	}
+}
+
 void APlayerCharacter::Deactivate()
 {
 	if (IsActive)
@@ -256,10 +526,30 @@ void APlayerCharacter::Deactivate()
 		CanMove = false;
 		CanAttack = false;
 		GetCharacterMovement()->StopMovementImmediately();
+		UpdateCombatState();
+	}
+}
+
+void APlayerCharacter::Activate()
+{
+	if (!IsActive)
+	{
+		IsActive = true;
+		CanMove = true;
+		CanAttack = true;
+		UpdateCombatState();
+	}
+	if (PlayerHUDWidget)
+	{
+		PlayerHUDWidget->SetLevel(MyGameInstance->CurrentLevelIndex);
 	}
 }
 
 void APlayerCharacter::QuitGame()
 {
+	if (InputReplay)
+	{
+		InputReplay->StopRecording();
+	}
 	UKismetSystemLibrary::QuitGame(GetWorld(), UGameplayStatics::GetPlayerController(GetWorld(), 0), EQuitPreference::Quit, false);
 }
@@ -13,18 +13,22 @@
 #include "GameFramework/Controller.h"
 #include "PaperZDAnimInstance.h"
 #include "Components/BoxComponent.h"
-#include "Engine/TimerHandle.h"
 #include "PlayerHUD.h"
 #include "CrustyPirateGameInstance.h"
 #include "CollectableItem.h"
+#include "InputReplaySubsystem.h"
+#include "InputLatencySubsystem.h"
 #include "Sound/SoundBase.h"
+#include "Combatant.h"
+#include "StatusEffectTarget.h"
+#include "CombatNetState.h"
 #include "PlayerCharacter.generated.h"
 
 /**
  * 
  */
 UCLASS()
-class CRUSTYPIRATE_API APlayerCharacter : public APaperZDCharacter
+class CRUSTYPIRATE_API APlayerCharacter : public APaperZDCharacter, public ICombatant, public IStatusEffectTarget
 {
 	GENERATED_BODY()
 	
@@ -78,9 +82,19 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float AttackStunDuration = 0.3f;
 
+	// Time after a hit during which the player cannot be damaged again. Zero disables it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float InvulnerabilityDuration = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool IsInvulnerable = false;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	int HitPoints = 100;
 
+	UPROPERTY(ReplicatedUsing = OnRep_CombatState)
+	FCombatNetState CombatState;
+
 	UPROPERTY(EditAnywhere)
 	TSubclassOf<UPlayerHUD> PlayerHUDClass;
 
@@ -93,19 +107,31 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	UCrustyPirateGameInstance* MyGameInstance;
 
+	UPROPERTY()
+	UInputReplaySubsystem* InputReplay;
+
+	UPROPERTY()
+	UInputLatencySubsystem* InputLatency;
+
 	FZDOnAnimationOverrideEndSignature OnAttackOverrideEndDelegate;
-	FTimerHandle StunTimer;
-	FTimerHandle RestartGameTimer;
+	uint32 SwingId = 0;
 
 	APlayerCharacter();
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
 	virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
+	virtual void NotifyControllerChanged() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	void SetupLocalPlayer();
 
 	void Move(const FInputActionValue& Value);
 	void JumpStarted(const FInputActionValue& Value);
 	void JumpEnded(const FInputActionValue& Value);
 	void Attack(const FInputActionValue& Value);
+	bool StartAttack();
+	UFUNCTION(Server, Reliable)
+	void ServerAttack();
 
 	void UpdateDirection(float MoveDirection);
 	void OnAttackOverrideAnimEnd(bool Completed);
@@ -117,13 +143,25 @@ public:
 	void EnableAttackCollisionBox(bool Enabled);
 
 	void TakeDamage(int DamageAmount, float StunDuration);
+	virtual bool CanReceiveDamage() const override { return IsAlive && IsActive && !IsInvulnerable; }
+	virtual bool IsInvulnerableAfterHit() const override;
+	virtual int GetCombatHitPoints() const override { return HitPoints; }
+	virtual void ApplyDamageResult(int NewHitPoints, float StunDuration) override;
+	virtual const UPrimitiveComponent* GetAttackBox() const override { return AttackCollisionBox; }
+	void UpdateCombatState();
+	UFUNCTION()
+	void OnRep_CombatState(const FCombatNetState& PreviousState);
 	void UpdateHP(int NewHP);
 	void Stun(float DurationInSeconds);
 	void OnStunTimerTimeout();
 	void CollectItem(CollectableType ItemType);
+	UFUNCTION(Client, Reliable)
+	void ClientCollectItem(CollectableType ItemType);
 	void UnlockDoubleJump();
 	void OnRestartGameTimerTimeout();
+	virtual void OnStatusEffectExpired(EStatusEffect Effect) override;
 	UFUNCTION(BlueprintCallable)
 	void Deactivate();
+	void Activate();
 	void QuitGame();
 };
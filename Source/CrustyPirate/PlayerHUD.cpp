@@ -2,21 +2,56 @@
 
 
 #include "PlayerHUD.h"
+#include "CrustyPiratePerf.h"
+#include "NumberTextSubsystem.h"
 
 void UPlayerHUD::SetHp(int NewHp)
 {
-	FString Str = FString::Printf(TEXT("HP: %d"), NewHp);
-	HPText->SetText(FText::FromString(Str));
+	PendingHp = NewHp;
+	IsDirty = true;
 }
 
 void UPlayerHUD::SetDiamonds(int Amount)
 {
-	FString Str = FString::Printf(TEXT("Diamonds: %d"), Amount);
-	DiamondsText->SetText(FText::FromString(Str));
+	PendingDiamonds = Amount;
+	IsDirty = true;
 }
 
 void UPlayerHUD::SetLevel(int Index)
 {
-	FString Str = FString::Printf(TEXT("Level: %d"), Index);
-	LevelText->SetText(FText::FromString(Str));
+	PendingLevel = Index;
+	IsDirty = true;
+}
+
+void UPlayerHUD::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+{
+	Super::NativeTick(MyGeometry, InDeltaTime);
+	if (IsDirty)
+	{
+		FlushUpdates();
+	}
+}
+
+void UPlayerHUD::FlushUpdates()
+{
+	CRUSTYPIRATE_SCOPE(HUDUpdate);
+	UNumberTextSubsystem* NumberTexts = GetWorld()->GetSubsystem<UNumberTextSubsystem>();
+	if (!NumberTexts)	return;
+
+	IsDirty = false;
+	if (PendingHp != ShownHp)
+	{
+		ShownHp = PendingHp;
+		HPText->SetText(NumberTexts->HPTexts.Get(ShownHp));
+	}
+	if (PendingDiamonds != ShownDiamonds)
+	{
+		ShownDiamonds = PendingDiamonds;
+		DiamondsText->SetText(NumberTexts->DiamondTexts.Get(ShownDiamonds));
+	}
+	if (PendingLevel != ShownLevel)
+	{
+		ShownLevel = PendingLevel;
+		LevelText->SetText(NumberTexts->LevelTexts.Get(ShownLevel));
+	}
 }
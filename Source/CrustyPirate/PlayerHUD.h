@@ -8,7 +8,7 @@
 #include "PlayerHUD.generated.h"
 
 /**
- * 
+ * Setters only record the latest values; the widget pushes them to the text blocks at most once per frame.
  */
 UCLASS()
 class CRUSTYPIRATE_API UPlayerHUD : public UUserWidget
@@ -24,7 +24,18 @@ public:
 	UPROPERTY(EditAnywhere, meta = (BindWidget))
 	UTextBlock* LevelText;
 
+	int PendingHp = 0;
+	int PendingDiamonds = 0;
+	int PendingLevel = 0;
+	int ShownHp = INDEX_NONE;
+	int ShownDiamonds = INDEX_NONE;
+	int ShownLevel = INDEX_NONE;
+	bool IsDirty = false;
+
 	void SetHp(int NewHp);
 	void SetDiamonds(int Amount);
 	void SetLevel(int Index);
+	void FlushUpdates();
+
+	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
 };
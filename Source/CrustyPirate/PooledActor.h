@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "PooledActor.generated.h"
+
+UINTERFACE(MinimalAPI)
+class UPooledActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Actors implementing this are recycled by UActorPoolSubsystem instead of being destroyed.
+ */
+class CRUSTYPIRATE_API IPooledActor
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnAcquiredFromPool() {}
+	virtual void OnReleasedToPool() {}
+};
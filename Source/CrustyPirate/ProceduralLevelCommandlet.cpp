@@ -0,0 +1,307 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProceduralLevelCommandlet.h"
+#include "CrustyPirate.h"
+#include "Enemy.h"
+#include "CollectableItem.h"
+#include "LevelExit.h"
+#include "PaperTileLayer.h"
+#include "PaperTileMap.h"
+#include "PaperTileMapActor.h"
+#include "PaperTileMapComponent.h"
+#include "PaperTileSet.h"
+#include "GameFramework/PlayerStart.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Async/ParallelFor.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+UProceduralLevelCommandlet::UProceduralLevelCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UProceduralLevelCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	int32 Seed = 1;
+	int32 Width = 2000;
+	int32 Height = 50;
+	int32 FirstLevelIndex = 100;
+	int32 Count = 1;
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Width="), Width);
+	FParse::Value(*Params, TEXT("Height="), Height);
+	FParse::Value(*Params, TEXT("FirstLevelIndex="), FirstLevelIndex);
+	FParse::Value(*Params, TEXT("Count="), Count);
+	FParse::Value(*Params, TEXT("Enemies="), EnemiesPerHundredColumns);
+
+	if (Width < 32 || Height < 8 || Count <= 0 || FirstLevelIndex <= 0)
+	{
+		UE_LOG(LogCrustyPirate, Error, TEXT("ProceduralLevel: invalid parameters (Width >= 32, Height >= 8, Count > 0, FirstLevelIndex > 0)"));
+		return 1;
+	}
+
+	// The default FirstLevelIndex is far from the hand-made levels, but a typo must not replace one of them.
+	bool Overwrite = FParse::Param(*Params, TEXT("Overwrite"));
+	int32 NumExisting = 0;
+	for (int32 LevelIndex = FirstLevelIndex; LevelIndex < FirstLevelIndex + Count && !Overwrite; LevelIndex++)
+	{
+		FString PackageName = FString::Printf(TEXT("/Game/Levels/Level_%d"), LevelIndex);
+		if (FPackageName::DoesPackageExist(PackageName))
+		{
+			UE_LOG(LogCrustyPirate, Error, TEXT("ProceduralLevel: %s already exists"), *PackageName);
+			NumExisting++;
+		}
+	}
+	if (NumExisting > 0)
+	{
+		UE_LOG(LogCrustyPirate, Error, TEXT("ProceduralLevel: nothing generated, pass -Overwrite to replace existing levels"));
+		return 1;
+	}
+
+	int32 Failed = 0;
+	for (int32 i = 0; i < Count; i++)
+	{
+		int32 LevelIndex = FirstLevelIndex + i;
+		int32 NextLevelIndex = i + 1 < Count ? LevelIndex + 1 : FirstLevelIndex;
+		if (!GenerateLevel(Seed + i, Width, Height, LevelIndex, NextLevelIndex))
+		{
+			Failed++;
+		}
+	}
+	return Failed > 0 ? 1 : 0;
+#else
+	UE_LOG(LogCrustyPirate, Error, TEXT("ProceduralLevel can only run in editor builds"));
+	return 1;
+#endif
+}
+
+void UProceduralLevelCommandlet::GenerateLayout(FRandomStream& Random, FLevelLayout& Layout) const
+{
+	const int32 Width = Layout.Width;
+	const int32 Height = Layout.Height;
+	Layout.GroundRow.SetNumUninitialized(Width);
+	Layout.PlatformRow.Init(INDEX_NONE, Width);
+
+	// Ground is a random walk; the first and last columns stay flat so the start and exit are safe.
+	const int32 SafeColumns = 8;
+	int32 Row = Height * 2 / 3;
+	int32 PitLeft = 0;
+	for (int32 X = 0; X < Width; X++)
+	{
+		bool IsSafe = X < SafeColumns || X >= Width - SafeColumns;
+		if (!IsSafe && PitLeft == 0 && Random.FRand() < PitChance)
+		{
+			PitLeft = Random.RandRange(1, FMath::Max(MaxPitWidth, 1));
+		}
+		if (!IsSafe && PitLeft > 0)
+		{
+			PitLeft--;
+			Layout.GroundRow[X] = INDEX_NONE;
+			continue;
+		}
+		if (!IsSafe && Random.FRand() < 0.15f)
+		{
+			Row = FMath::Clamp(Row + (Random.FRand() < 0.5f ? -1 : 1), Height / 3, Height - 2);
+		}
+		Layout.GroundRow[X] = Row;
+	}
+
+	int32 NumPlatforms = FMath::RoundToInt(Width * PlatformsPerHundredColumns / 100.0f);
+	for (int32 i = 0; i < NumPlatforms; i++)
+	{
+		int32 Length = Random.RandRange(3, 6);
+		int32 Start = Random.RandRange(SafeColumns, Width - SafeColumns - Length);
+		int32 Highest = Height;
+		for (int32 X = Start; X < Start + Length; X++)
+		{
+			if (Layout.GroundRow[X] != INDEX_NONE)
+			{
+				Highest = FMath::Min(Highest, Layout.GroundRow[X]);
+			}
+		}
+		int32 PlatformRow = FMath::Max(Highest - Random.RandRange(3, 5), 1);
+		for (int32 X = Start; X < Start + Length; X++)
+		{
+			Layout.PlatformRow[X] = PlatformRow;
+		}
+	}
+}
+
+void UProceduralLevelCommandlet::FillChunk(const FLevelLayout& Layout, int32 FirstColumn, UPaperTileLayer* Layer, UPaperTileSet* Terrain, UPaperTileSet* Platforms) const
+{
+	FPaperTileInfo Surface;
+	Surface.TileSet = Terrain;
+	Surface.PackedTileIndex = SurfaceTileIndex;
+	FPaperTileInfo Fill;
+	Fill.TileSet = Terrain;
+	Fill.PackedTileIndex = FillTileIndex;
+	FPaperTileInfo Platform;
+	Platform.TileSet = Platforms;
+	Platform.PackedTileIndex = PlatformTileIndex;
+
+	const int32 NumColumns = Layer->GetLayerWidth();
+	for (int32 LocalX = 0; LocalX < NumColumns; LocalX++)
+	{
+		const int32 X = FirstColumn + LocalX;
+		const int32 GroundRow = Layout.GroundRow[X];
+		const int32 PlatformRow = Layout.PlatformRow[X];
+		if (PlatformRow != INDEX_NONE)
+		{
+			Layer->SetCell(LocalX, PlatformRow, Platform);
+		}
+		if (GroundRow == INDEX_NONE)	continue;
+		Layer->SetCell(LocalX, GroundRow, Surface);
+		for (int32 Y = GroundRow + 1; Y < Layout.Height; Y++)
+		{
+			Layer->SetCell(LocalX, Y, Fill);
+		}
+	}
+}
+
+bool UProceduralLevelCommandlet::GenerateLevel(int32 Seed, int32 Width, int32 Height, int32 LevelIndex, int32 NextLevelIndex)
+{
+#if WITH_EDITOR
+	UPaperTileSet* Terrain = Cast<UPaperTileSet>(TerrainTileSet.TryLoad());
+	UPaperTileSet* Platforms = Cast<UPaperTileSet>(PlatformTileSet.TryLoad());
+	if (!Terrain || !Platforms)
+	{
+		UE_LOG(LogCrustyPirate, Error, TEXT("ProceduralLevel: could not load tilesets %s and %s"), *TerrainTileSet.ToString(), *PlatformTileSet.ToString());
+		return false;
+	}
+	UClass* Enemy = EnemyClass.TryLoadClass<AEnemy>();
+	UClass* LevelExit = LevelExitClass.TryLoadClass<ALevelExit>();
+
+	double StartTime = FPlatformTime::Seconds();
+	FRandomStream Random(Seed);
+	FLevelLayout Layout;
+	Layout.Width = Width;
+	Layout.Height = Height;
+	GenerateLayout(Random, Layout);
+
+	FString LevelName = FString::Printf(TEXT("Level_%d"), LevelIndex);
+	FString PackageName = TEXT("/Game/Levels/") + LevelName;
+	UPackage* Package = CreatePackage(*PackageName);
+	UWorld* World = UWorld::CreateWorld(EWorldType::Inactive, false, FName(*LevelName), Package);
+	World->SetFlags(RF_Public | RF_Standalone);
+
+	// Tilemaps are UObjects, so they are created on the game thread and only their cells are filled in parallel.
+	const int32 NumChunks = FMath::DivideAndRoundUp(Width, ChunkWidth);
+	const float TileSize = Terrain->GetTileSize().X / PixelsPerUnrealUnit;
+	TArray<UPaperTileMap*> Maps;
+	TArray<FTransform> ChunkTransforms;
+	for (int32 Chunk = 0; Chunk < NumChunks; Chunk++)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Name = FName(*FString::Printf(TEXT("Chunk_%d"), Chunk));
+		FTransform ChunkTransform(FVector(Chunk * ChunkWidth * TileSize, 0.0f, 0.0f));
+		APaperTileMapActor* ChunkActor = World->SpawnActor<APaperTileMapActor>(APaperTileMapActor::StaticClass(), ChunkTransform, SpawnParams);
+		ChunkActor->SetActorLabel(SpawnParams.Name.ToString());
+		ChunkActor->Tags.Add(TEXT("LevelChunk"));
+
+		UPaperTileMapComponent* TileMapComponent = ChunkActor->GetRenderComponent();
+		TileMapComponent->CreateNewOwnedTileMap();
+		UPaperTileMap* Map = TileMapComponent->TileMap;
+		Map->TileWidth = Terrain->GetTileSize().X;
+		Map->TileHeight = Terrain->GetTileSize().Y;
+		Map->PixelsPerUnrealUnit = PixelsPerUnrealUnit;
+		Map->SelectedTileSet = Terrain;
+		Map->ResizeMap(FMath::Min(ChunkWidth, Width - Chunk * ChunkWidth), Height);
+		Maps.Add(Map);
+		ChunkTransforms.Add(ChunkTransform);
+	}
+
+	ParallelFor(NumChunks, [&](int32 Chunk)
+	{
+		FillChunk(Layout, Chunk * ChunkWidth, Maps[Chunk]->TileLayers[0], Terrain, Platforms);
+	});
+
+	for (UPaperTileMap* Map : Maps)
+	{
+		Map->RebuildCollision();
+		UPaperTileMapComponent* TileMapComponent = CastChecked<UPaperTileMapComponent>(Map->GetOuter());
+		TileMapComponent->RecreatePhysicsState();
+		TileMapComponent->MarkRenderStateDirty();
+	}
+	double TilesMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	// Location standing on top of the given tile row of a column.
+	auto GetStandingLocation = [&](int32 X, int32 Row)
+	{
+		int32 Chunk = X / ChunkWidth;
+		FVector TileCenter = Maps[Chunk]->GetTileCenterInLocalSpace(X - Chunk * ChunkWidth, Row - 2);
+		return ChunkTransforms[Chunk].TransformPosition(TileCenter);
+	};
+	auto PickGroundColumn = [&]()
+	{
+		for (int32 Attempt = 0; Attempt < 16; Attempt++)
+		{
+			int32 X = Random.RandRange(10, Width - 10);
+			if (Layout.GroundRow[X] != INDEX_NONE)	return X;
+		}
+		return 10;
+	};
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	World->SpawnActor<APlayerStart>(APlayerStart::StaticClass(), FTransform(GetStandingLocation(2, Layout.GroundRow[2])), SpawnParams);
+
+	int32 NumEnemies = Enemy ? FMath::RoundToInt(Width * EnemiesPerHundredColumns / 100.0f) : 0;
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		int32 X = PickGroundColumn();
+		FTransform Transform(GetStandingLocation(X, Layout.GroundRow[X]));
+		World->SpawnActor(Enemy, &Transform, SpawnParams);
+	}
+
+	int32 NumCollectables = 0;
+	for (const FProceduralCollectableSpawn& Spawn : Collectables)
+	{
+		UClass* Collectable = Spawn.Class.TryLoadClass<ACollectableItem>();
+		if (!Collectable)	continue;
+		int32 SpawnCount = FMath::RoundToInt(Width * Spawn.PerHundredColumns / 100.0f);
+		for (int32 i = 0; i < SpawnCount; i++)
+		{
+			int32 X = PickGroundColumn();
+			// Reward the jump onto platforms half of the time.
+			bool OnPlatform = Layout.PlatformRow[X] != INDEX_NONE && Random.FRand() < 0.5f;
+			int32 Row = OnPlatform ? Layout.PlatformRow[X] : Layout.GroundRow[X];
+			FTransform Transform(GetStandingLocation(X, Row));
+			World->SpawnActor(Collectable, &Transform, SpawnParams);
+		}
+		NumCollectables += SpawnCount;
+	}
+
+	if (LevelExit)
+	{
+		int32 X = Width - 4;
+		FTransform Transform(GetStandingLocation(X, Layout.GroundRow[X]));
+		if (ALevelExit* Exit = Cast<ALevelExit>(World->SpawnActor(LevelExit, &Transform, SpawnParams)))
+		{
+			Exit->LevelIndex = NextLevelIndex;
+		}
+	}
+	double GenerateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	FAssetRegistryModule::AssetCreated(World);
+	Package->MarkPackageDirty();
+	FString FileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetMapPackageExtension());
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Standalone;
+	bool Saved = UPackage::SavePackage(Package, World, *FileName, SaveArgs);
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+
+	UE_LOG(LogCrustyPirate, Display, TEXT("%s: %d x %d tiles in %d chunks (%.1f ms), %d enemies, %d collectables, exit to Level_%d, generated in %.1f ms%s"),
+		*LevelName, Width, Height, NumChunks, TilesMs, NumEnemies, NumCollectables, NextLevelIndex, GenerateMs, Saved ? TEXT("") : TEXT(", SAVE FAILED"));
+	return Saved;
+#else
+	return false;
+#endif
+}
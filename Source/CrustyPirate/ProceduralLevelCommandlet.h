@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ProceduralLevelCommandlet.generated.h"
+
+class UPaperTileLayer;
+class UPaperTileSet;
+
+USTRUCT()
+struct FProceduralCollectableSpawn
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	FSoftClassPath Class;
+
+	UPROPERTY(Config)
+	float PerHundredColumns = 0.0f;
+};
+
+/**
+ * Generates seeded stress-test levels from the existing tilesets.
+ *
+ * UnrealEditor-Cmd CrustyPirate -run=ProceduralLevel -Seed=1 -Width=2000 -Height=50 -FirstLevelIndex=100 -Count=3
+ *
+ * Each level is saved as /Game/Levels/Level_<Index> and its ALevelExit points at the next generated level
+ * (the last one loops back to the first). The terrain is split into one tilemap actor per ChunkWidth columns
+ * and the chunks are filled in parallel. Nothing is generated when one of the levels already exists, unless
+ * -Overwrite is passed.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UProceduralLevelCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	FSoftObjectPath TerrainTileSet;
+
+	UPROPERTY(Config)
+	FSoftObjectPath PlatformTileSet;
+
+	UPROPERTY(Config)
+	int32 SurfaceTileIndex = 0;
+
+	UPROPERTY(Config)
+	int32 FillTileIndex = 0;
+
+	UPROPERTY(Config)
+	int32 PlatformTileIndex = 0;
+
+	UPROPERTY(Config)
+	float PixelsPerUnrealUnit = 0.5f;
+
+	UPROPERTY(Config)
+	int32 ChunkWidth = 64;
+
+	UPROPERTY(Config)
+	FSoftClassPath EnemyClass;
+
+	UPROPERTY(Config)
+	FSoftClassPath LevelExitClass;
+
+	UPROPERTY(Config)
+	float EnemiesPerHundredColumns = 4.0f;
+
+	UPROPERTY(Config)
+	float PlatformsPerHundredColumns = 6.0f;
+
+	// Chance per column of starting a pit, pits are at most MaxPitWidth columns wide.
+	UPROPERTY(Config)
+	float PitChance = 0.02f;
+
+	UPROPERTY(Config)
+	int32 MaxPitWidth = 3;
+
+	// One entry per collectable Blueprint, so every CollectableType can be given its own density.
+	UPROPERTY(Config)
+	TArray<FProceduralCollectableSpawn> Collectables;
+
+	UProceduralLevelCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	struct FLevelLayout
+	{
+		int32 Width = 0;
+		int32 Height = 0;
+		// Row of the topmost ground tile per column, or INDEX_NONE over a pit.
+		TArray<int32> GroundRow;
+		// Row of a floating platform per column, or INDEX_NONE.
+		TArray<int32> PlatformRow;
+	};
+
+	void GenerateLayout(FRandomStream& Random, FLevelLayout& Layout) const;
+	void FillChunk(const FLevelLayout& Layout, int32 FirstColumn, UPaperTileLayer* Layer, UPaperTileSet* Terrain, UPaperTileSet* Platforms) const;
+	bool GenerateLevel(int32 Seed, int32 Width, int32 Height, int32 LevelIndex, int32 NextLevelIndex);
+};
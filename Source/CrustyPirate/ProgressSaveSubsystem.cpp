@@ -0,0 +1,302 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProgressSaveSubsystem.h"
+#include "CrustyPirate.h"
+#include "CrustyPirateGameInstance.h"
+#include "InputReplaySubsystem.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static const uint32 SaveFileMagic = 0x43505356; // 'CPSV'
+static const uint32 SaveFileVersion = 1;
+static const int32 SaveFileHeaderSize = 4 * sizeof(uint32);
+
+void UProgressSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UInputReplaySubsystem* Replay = Collection.InitializeDependency<UInputReplaySubsystem>();
+	// Replays and perf scenarios must start from the same state every run.
+	FString PerfScenario;
+	IsEnabled = !FParse::Param(FCommandLine::Get(), TEXT("NoSave")) && !(Replay && (Replay->IsRecording || Replay->IsReplaying))
+		&& !FParse::Value(FCommandLine::Get(), TEXT("PerfScenario="), PerfScenario);
+	FilePath = FPaths::ProjectSavedDir() / TEXT("SaveGames") / SaveFileName;
+	if (IsEnabled)
+	{
+		HasLoadedSave = LoadProgress();
+	}
+}
+
+void UProgressSaveSubsystem::Deinitialize()
+{
+	if (IsEnabled)
+	{
+		FlushProgress();
+	}
+	Super::Deinitialize();
+}
+
+void UProgressSaveSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceSave += DeltaTime;
+	if (IsWriteInFlight())	return;
+	FinishPendingWrite();
+	if (TimeSinceSave >= AutoSaveInterval)
+	{
+		SaveProgress();
+	}
+}
+
+TStatId UProgressSaveSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProgressSaveSubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType UProgressSaveSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+void UProgressSaveSubsystem::RegisterLevelPackage(FName PackageName, int32 LevelIndex)
+{
+	LevelPackageIndices.Add(PackageName, LevelIndex);
+}
+
+void UProgressSaveSubsystem::MarkItemCollected(const AActor* Item)
+{
+	MarkItemCollected(GetLevelIndex(Item), Item->GetFName());
+}
+
+void UProgressSaveSubsystem::MarkEnemyDefeated(const AActor* Enemy)
+{
+	MarkEnemyDefeated(GetLevelIndex(Enemy), Enemy->GetFName());
+}
+
+void UProgressSaveSubsystem::MarkItemCollected(int32 LevelIndex, FName ItemName)
+{
+	if (LevelIndex <= 0)	return;
+	EditLevel(LevelIndex).CollectedItems.Add(ItemName);
+	IsDirty = true;
+}
+
+void UProgressSaveSubsystem::MarkEnemyDefeated(int32 LevelIndex, FName EnemyName)
+{
+	if (LevelIndex <= 0)	return;
+	EditLevel(LevelIndex).DefeatedEnemies.Add(EnemyName);
+	IsDirty = true;
+}
+
+void UProgressSaveSubsystem::ReserveLevel(int32 LevelIndex, int32 NumItems, int32 NumEnemies)
+{
+	if (LevelIndex <= 0)	return;
+	FLevelProgress& Progress = EditLevel(LevelIndex);
+	Progress.CollectedItems.Reserve(NumItems);
+	Progress.DefeatedEnemies.Reserve(NumEnemies);
+}
+
+bool UProgressSaveSubsystem::IsItemCollected(const AActor* Item) const
+{
+	const TSharedRef<FLevelProgress>* Progress = Levels.Find(GetLevelIndex(Item));
+	return Progress && (*Progress)->CollectedItems.Contains(Item->GetFName());
+}
+
+bool UProgressSaveSubsystem::IsEnemyDefeated(const AActor* Enemy) const
+{
+	const TSharedRef<FLevelProgress>* Progress = Levels.Find(GetLevelIndex(Enemy));
+	return Progress && (*Progress)->DefeatedEnemies.Contains(Enemy->GetFName());
+}
+
+void UProgressSaveSubsystem::ResetProgress()
+{
+	Levels.Reset();
+	IsDirty = true;
+}
+
+bool UProgressSaveSubsystem::LoadProgress()
+{
+	if (!IFileManager::Get().FileExists(*FilePath))	return false;
+
+	double StartTime = FPlatformTime::Seconds();
+	FProgressSnapshot Snapshot;
+	if (!ReadSnapshot(FilePath, Snapshot))
+	{
+		UE_LOG(LogCrustyPirate, Warning, TEXT("Ignoring corrupted save %s"), *FilePath);
+		return false;
+	}
+
+	UCrustyPirateGameInstance* MyGameInstance = Cast<UCrustyPirateGameInstance>(GetGameInstance());
+	if (!MyGameInstance)	return false;
+	// A save taken after dying would otherwise load straight into a dead player.
+	if (Snapshot.PlayerHP <= 0)	return false;
+
+	MyGameInstance->PlayerHP = Snapshot.PlayerHP;
+	MyGameInstance->CollectedDiamondCount = Snapshot.CollectedDiamondCount;
+	MyGameInstance->IsDoubleJumpUnlocked = Snapshot.IsDoubleJumpUnlocked;
+	MyGameInstance->CurrentLevelIndex = Snapshot.CurrentLevelIndex;
+	Levels = MoveTemp(Snapshot.Levels);
+	LastSavedStats = CaptureSnapshot(false);
+	IsDirty = false;
+	UE_LOG(LogCrustyPirate, Log, TEXT("Loaded save %s (level %d, %d tracked levels) in %.2f ms"),
+		*FilePath, Snapshot.CurrentLevelIndex, Levels.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+void UProgressSaveSubsystem::SaveProgress()
+{
+	if (!IsEnabled || IsWriteInFlight())	return;
+	FinishPendingWrite();
+
+	FProgressSnapshot Stats = CaptureSnapshot(false);
+	if (!IsDirty && Stats.HasSameStats(LastSavedStats))	return;
+
+	TimeSinceSave = 0.0f;
+	IsDirty = false;
+	LastSavedStats = Stats;
+	PendingWriteStartTime = FPlatformTime::Seconds();
+	PendingWrite = Async(EAsyncExecution::ThreadPool, [Snapshot = CaptureSnapshot(true), Path = FilePath]() mutable
+	{
+		// Drops the shared levels before the future is ready, so the game thread can edit them in place again.
+		FProgressSnapshot WrittenSnapshot = MoveTemp(Snapshot);
+		return WriteSnapshot(WrittenSnapshot, Path);
+	});
+}
+
+void UProgressSaveSubsystem::FlushProgress()
+{
+	if (PendingWrite.IsValid())
+	{
+		PendingWrite.Wait();
+		FinishPendingWrite();
+	}
+	SaveProgress();
+	if (PendingWrite.IsValid())
+	{
+		PendingWrite.Wait();
+		FinishPendingWrite();
+	}
+}
+
+int32 UProgressSaveSubsystem::GetLevelIndexFromMapName(const FString& MapName)
+{
+	FString Name = UWorld::RemovePIEPrefix(MapName);
+	if (!Name.StartsWith(TEXT("Level_")))	return 0;
+	return FCString::Atoi(*Name.RightChop(6));
+}
+
+bool UProgressSaveSubsystem::WriteSnapshot(FProgressSnapshot& Snapshot, const FString& Path)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter PayloadWriter(Payload);
+	PayloadWriter << Snapshot;
+
+	TArray<uint8> Bytes;
+	Bytes.Reserve(SaveFileHeaderSize + Payload.Num());
+	FMemoryWriter Writer(Bytes);
+	uint32 Magic = SaveFileMagic;
+	uint32 Version = SaveFileVersion;
+	uint32 PayloadSize = Payload.Num();
+	uint32 Crc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+	Writer << Magic << Version << PayloadSize << Crc;
+	Writer.Serialize(Payload.GetData(), Payload.Num());
+
+	// Write next to the real file first so a crash mid-write never leaves a half-written save behind.
+	FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath))	return false;
+	return IFileManager::Get().Move(*Path, *TempPath, true, true);
+}
+
+bool UProgressSaveSubsystem::ReadSnapshot(const FString& Path, FProgressSnapshot& OutSnapshot)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))	return false;
+	if (Bytes.Num() < SaveFileHeaderSize)	return false;
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	uint32 PayloadSize = 0;
+	uint32 Crc = 0;
+	Reader << Magic << Version << PayloadSize << Crc;
+	if (Magic != SaveFileMagic || Version != SaveFileVersion)	return false;
+	if (PayloadSize != (uint32)(Bytes.Num() - SaveFileHeaderSize))	return false;
+	if (FCrc::MemCrc32(Bytes.GetData() + SaveFileHeaderSize, PayloadSize) != Crc)	return false;
+
+	FProgressSnapshot Snapshot;
+	Reader << Snapshot;
+	if (Reader.IsError() || Reader.Tell() != Bytes.Num())	return false;
+	OutSnapshot = MoveTemp(Snapshot);
+	return true;
+}
+
+int32 UProgressSaveSubsystem::GetLevelIndex(const AActor* Actor) const
+{
+	// Pooled and runtime-spawned actors have no stable name to key on.
+	if (!Actor || !Actor->IsNetStartupActor())	return 0;
+	ULevel* Level = Actor->GetLevel();
+	if (!Level)	return 0;
+	if (const int32* LevelIndex = LevelPackageIndices.Find(Level->GetOutermost()->GetFName()))
+	{
+		return *LevelIndex;
+	}
+	if (Level->IsPersistentLevel())
+	{
+		return GetLevelIndexFromMapName(Actor->GetWorld()->GetMapName());
+	}
+	return 0;
+}
+
+FProgressSnapshot UProgressSaveSubsystem::CaptureSnapshot(bool IncludeLevels) const
+{
+	FProgressSnapshot Snapshot;
+	if (UCrustyPirateGameInstance* MyGameInstance = Cast<UCrustyPirateGameInstance>(GetGameInstance()))
+	{
+		Snapshot.PlayerHP = MyGameInstance->PlayerHP;
+		Snapshot.CollectedDiamondCount = MyGameInstance->CollectedDiamondCount;
+		Snapshot.IsDoubleJumpUnlocked = MyGameInstance->IsDoubleJumpUnlocked;
+		Snapshot.CurrentLevelIndex = MyGameInstance->CurrentLevelIndex;
+	}
+	if (IncludeLevels)
+	{
+		Snapshot.Levels = Levels;
+	}
+	return Snapshot;
+}
+
+FLevelProgress& UProgressSaveSubsystem::EditLevel(int32 LevelIndex)
+{
+	TSharedRef<FLevelProgress>* Progress = Levels.Find(LevelIndex);
+	if (!Progress)
+	{
+		return *Levels.Add(LevelIndex, MakeShared<FLevelProgress>());
+	}
+	if (!Progress->IsUnique())
+	{
+		*Progress = MakeShared<FLevelProgress>(**Progress);
+	}
+	return **Progress;
+}
+
+bool UProgressSaveSubsystem::IsWriteInFlight() const
+{
+	return PendingWrite.IsValid() && !PendingWrite.IsReady();
+}
+
+void UProgressSaveSubsystem::FinishPendingWrite()
+{
+	if (!PendingWrite.IsValid())	return;
+	bool Success = PendingWrite.Consume();
+	if (!Success)
+	{
+		UE_LOG(LogCrustyPirate, Warning, TEXT("Failed to write save %s"), *FilePath);
+		IsDirty = true;
+		return;
+	}
+	UE_LOG(LogCrustyPirate, Verbose, TEXT("Saved progress in %.2f ms"), (FPlatformTime::Seconds() - PendingWriteStartTime) * 1000.0);
+}
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "ProgressSaveSubsystem.generated.h"
+
+struct FLevelProgress
+{
+	TSet<FName> CollectedItems;
+	TSet<FName> DefeatedEnemies;
+
+	friend FArchive& operator<<(FArchive& Ar, FLevelProgress& Progress)
+	{
+		return Ar << Progress.CollectedItems << Progress.DefeatedEnemies;
+	}
+};
+
+struct FProgressSnapshot
+{
+	int32 PlayerHP = 100;
+	int32 CollectedDiamondCount = 0;
+	bool IsDoubleJumpUnlocked = false;
+	int32 CurrentLevelIndex = 1;
+	// Shared with the subsystem, which copies a level before changing it while a snapshot still holds it.
+	TMap<int32, TSharedRef<FLevelProgress>> Levels;
+
+	bool HasSameStats(const FProgressSnapshot& Other) const
+	{
+		return PlayerHP == Other.PlayerHP && CollectedDiamondCount == Other.CollectedDiamondCount
+			&& IsDoubleJumpUnlocked == Other.IsDoubleJumpUnlocked && CurrentLevelIndex == Other.CurrentLevelIndex;
+	}
+
+	// Levels are written in the same layout as a TMap<int32, FLevelProgress>.
+	friend FArchive& operator<<(FArchive& Ar, FProgressSnapshot& Snapshot)
+	{
+		Ar << Snapshot.PlayerHP << Snapshot.CollectedDiamondCount << Snapshot.IsDoubleJumpUnlocked << Snapshot.CurrentLevelIndex;
+		int32 NumLevels = Snapshot.Levels.Num();
+		Ar << NumLevels;
+		if (Ar.IsLoading())
+		{
+			Snapshot.Levels.Reset();
+			if (NumLevels < 0)
+			{
+				Ar.SetError();
+			}
+			for (int32 i = 0; i < NumLevels && !Ar.IsError(); i++)
+			{
+				int32 LevelIndex = 0;
+				TSharedRef<FLevelProgress> Progress = MakeShared<FLevelProgress>();
+				Ar << LevelIndex << *Progress;
+				Snapshot.Levels.Add(LevelIndex, Progress);
+			}
+		}
+		else
+		{
+			for (TPair<int32, TSharedRef<FLevelProgress>>& Level : Snapshot.Levels)
+			{
+				Ar << Level.Key << *Level.Value;
+			}
+		}
+		return Ar;
+	}
+};
+
+/**
+ * Persists UCrustyPirateGameInstance progress plus the items collected and enemies defeated in each level.
+ * Only level-placed actors are tracked, keyed by their name. Saves are snapshotted on the game thread and
+ * written on a background thread whenever something changed; the snapshot shares each level's sets
+ * instead of copying them. The file has a magic, version and CRC so truncated or corrupted saves are
+ * rejected on load.
+ * Disabled with -NoSave and while recording or replaying input.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UProgressSaveSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	FString SaveFileName = TEXT("CrustyPirate.sav");
+
+	UPROPERTY(Config)
+	float AutoSaveInterval = 2.0f;
+
+	bool IsEnabled = true;
+	bool IsDirty = false;
+	bool HasLoadedSave = false;
+	float TimeSinceSave = 0.0f;
+	FString FilePath;
+	TMap<int32, TSharedRef<FLevelProgress>> Levels;
+	TMap<FName, int32> LevelPackageIndices;
+	FProgressSnapshot LastSavedStats;
+	TFuture<bool> PendingWrite;
+	double PendingWriteStartTime = 0.0;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return IsEnabled; }
+	virtual bool IsTickableWhenPaused() const override { return true; }
+
+	// Streamed level instances get unique package names, so the game instance tells us which level they are.
+	void RegisterLevelPackage(FName PackageName, int32 LevelIndex);
+
+	void MarkItemCollected(const AActor* Item);
+	void MarkEnemyDefeated(const AActor* Enemy);
+	// For actors that were respawned from chunk state under a different name than the level gave them.
+	void MarkItemCollected(int32 LevelIndex, FName ItemName);
+	void MarkEnemyDefeated(int32 LevelIndex, FName EnemyName);
+	bool IsItemCollected(const AActor* Item) const;
+	bool IsEnemyDefeated(const AActor* Enemy) const;
+	// Sizes a level's sets for everything it places, so marking items and enemies during play does not allocate.
+	void ReserveLevel(int32 LevelIndex, int32 NumItems, int32 NumEnemies);
+
+	void ResetProgress();
+	bool LoadProgress();
+	// Starts a background write if anything changed since the last one.
+	void SaveProgress();
+	// Waits for the running write and writes any remaining changes synchronously.
+	void FlushProgress();
+
+	int32 GetLevelIndex(const AActor* Actor) const;
+	static int32 GetLevelIndexFromMapName(const FString& MapName);
+	static bool WriteSnapshot(FProgressSnapshot& Snapshot, const FString& Path);
+	static bool ReadSnapshot(const FString& Path, FProgressSnapshot& OutSnapshot);
+
+protected:
+	FProgressSnapshot CaptureSnapshot(bool IncludeLevels) const;
+	// The level's progress, copied first if a snapshot being written still holds it.
+	FLevelProgress& EditLevel(int32 LevelIndex);
+	bool IsWriteInFlight() const;
+	void FinishPendingWrite();
+};
@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProgressSaveSubsystem.h"
+#include "CrustyPirateGameInstance.h"
+#include "CrustyPirateTestWorld.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Magic, version, payload size and CRC, one uint32 each.
+static const int32 TestSaveHeaderSize = 16;
+
+static bool HasSameLevels(const FProgressSnapshot& A, const FProgressSnapshot& B)
+{
+	if (A.Levels.Num() != B.Levels.Num())	return false;
+	for (const TPair<int32, TSharedRef<FLevelProgress>>& Level : A.Levels)
+	{
+		const TSharedRef<FLevelProgress>* Other = B.Levels.Find(Level.Key);
+		if (!Other)	return false;
+		if (!Level.Value->CollectedItems.Includes((*Other)->CollectedItems) || !(*Other)->CollectedItems.Includes(Level.Value->CollectedItems))	return false;
+		if (!Level.Value->DefeatedEnemies.Includes((*Other)->DefeatedEnemies) || !(*Other)->DefeatedEnemies.Includes(Level.Value->DefeatedEnemies))	return false;
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProgressSaveFileTest, "CrustyPirate.Save.CorruptedFiles",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProgressSaveFileTest::RunTest(const FString& Parameters)
+{
+	FProgressSnapshot Snapshot;
+	Snapshot.PlayerHP = 75;
+	Snapshot.CollectedDiamondCount = 42;
+	Snapshot.IsDoubleJumpUnlocked = true;
+	Snapshot.CurrentLevelIndex = 3;
+	for (int32 LevelIndex = 1; LevelIndex <= 2; LevelIndex++)
+	{
+		TSharedRef<FLevelProgress> Progress = MakeShared<FLevelProgress>();
+		for (int32 i = 0; i < 10; i++)
+		{
+			Progress->CollectedItems.Add(FName(TEXT("BP_Diamond"), i));
+			Progress->DefeatedEnemies.Add(FName(TEXT("BP_Enemy"), i * LevelIndex));
+		}
+		Snapshot.Levels.Add(LevelIndex, Progress);
+	}
+
+	const FString Path = FPaths::AutomationTransientDir() / TEXT("ProgressSaveTest.sav");
+	if (!TestTrue(TEXT("Write"), UProgressSaveSubsystem::WriteSnapshot(Snapshot, Path)))	return false;
+
+	FProgressSnapshot Loaded;
+	TestTrue(TEXT("Read"), UProgressSaveSubsystem::ReadSnapshot(Path, Loaded));
+	TestTrue(TEXT("Stats round-trip"), Loaded.HasSameStats(Snapshot));
+	TestTrue(TEXT("Levels round-trip"), HasSameLevels(Loaded, Snapshot));
+
+	TArray<uint8> Good;
+	if (!TestTrue(TEXT("Load bytes"), FFileHelper::LoadFileToArray(Good, *Path)))	return false;
+	const int32 PayloadSize = Good.Num() - TestSaveHeaderSize;
+	TestTrue(TEXT("Has a payload"), PayloadSize > 0);
+
+	// One flipped byte in the magic, version, payload size, CRC and at both ends of the payload.
+	for (int32 Offset : { 0, 4, 8, 12, TestSaveHeaderSize, TestSaveHeaderSize + PayloadSize / 2, Good.Num() - 1 })
+	{
+		TArray<uint8> Bytes = Good;
+		Bytes[Offset] ^= 0xFF;
+		FFileHelper::SaveArrayToFile(Bytes, *Path);
+		FProgressSnapshot Corrupted;
+		TestFalse(FString::Printf(TEXT("Byte %d flipped is rejected"), Offset), UProgressSaveSubsystem::ReadSnapshot(Path, Corrupted));
+	}
+
+	// Cut at every header field boundary and inside the payload.
+	for (int32 Length : { 0, 4, 8, 12, TestSaveHeaderSize, TestSaveHeaderSize + PayloadSize / 2, Good.Num() - 1 })
+	{
+		TArray<uint8> Bytes(Good.GetData(), Length);
+		FFileHelper::SaveArrayToFile(Bytes, *Path);
+		FProgressSnapshot Truncated;
+		TestFalse(FString::Printf(TEXT("Cut at %d bytes is rejected"), Length), UProgressSaveSubsystem::ReadSnapshot(Path, Truncated));
+	}
+
+	TArray<uint8> Extended = Good;
+	Extended.Add(0);
+	FFileHelper::SaveArrayToFile(Extended, *Path);
+	FProgressSnapshot Trailing;
+	TestFalse(TEXT("Trailing bytes are rejected"), UProgressSaveSubsystem::ReadSnapshot(Path, Trailing));
+
+	FProgressSnapshot Missing;
+	IFileManager::Get().Delete(*Path);
+	TestFalse(TEXT("Missing file is rejected"), UProgressSaveSubsystem::ReadSnapshot(Path, Missing));
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProgressSaveLatencyTest, "CrustyPirate.Perf.SaveLatency",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FProgressSaveLatencyTest::RunTest(const FString& Parameters)
+{
+	FCrustyPirateTestWorld TestWorld;
+	UProgressSaveSubsystem* Save = TestWorld.GameInstance->GetSubsystem<UProgressSaveSubsystem>();
+	if (!TestNotNull(TEXT("Save"), Save))	return false;
+	Save->FilePath = FPaths::AutomationTransientDir() / TEXT("ProgressSaveLatency.sav");
+	Save->IsEnabled = true;
+
+	// 100k tracked actors over ten levels, half of them items and half enemies.
+	const int32 NumLevels = 10;
+	const int32 NumEntries = 100000;
+	for (int32 i = 0; i < NumEntries; i++)
+	{
+		int32 LevelIndex = 1 + i % NumLevels;
+		if (i & 1)
+		{
+			Save->MarkEnemyDefeated(LevelIndex, FName(TEXT("BP_Enemy"), i));
+		}
+		else
+		{
+			Save->MarkItemCollected(LevelIndex, FName(TEXT("BP_Diamond"), i));
+		}
+	}
+
+	// The game thread only pays for the snapshot; the write itself runs on the thread pool.
+	double StartTime = FPlatformTime::Seconds();
+	Save->SaveProgress();
+	double SaveCallMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	TestTrue(TEXT("A write was started"), Save->PendingWrite.IsValid());
+
+	// Marking while the write runs copies only the one level it lands in.
+	StartTime = FPlatformTime::Seconds();
+	Save->MarkItemCollected(1, FName(TEXT("BP_Potion"), 1));
+	double MarkDuringWriteMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	Save->FlushProgress();
+	double FlushMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	TestTrue(TEXT("Load"), Save->LoadProgress());
+	double LoadMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	int32 NumLoaded = 0;
+	for (const TPair<int32, TSharedRef<FLevelProgress>>& Level : Save->Levels)
+	{
+		NumLoaded += Level.Value->CollectedItems.Num() + Level.Value->DefeatedEnemies.Num();
+	}
+	TestEqual(TEXT("Every entry and the one marked during the write were saved"), NumLoaded, NumEntries + 1);
+
+	AddInfo(FString::Printf(TEXT("%d entries: SaveProgress %.3f ms, mark during write %.3f ms, flush %.2f ms, load %.2f ms"),
+		NumEntries, SaveCallMs, MarkDuringWriteMs, FlushMs, LoadMs));
+	Save->IsEnabled = false;
+	IFileManager::Get().Delete(*Save->FilePath);
+	return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerMetricsSubsystem.h"
+#include "CrustyPirate.h"
+#include "EnemyCrowdSubsystem.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/NetDriver.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+static FAutoConsoleCommandWithWorld ServerMetricsCommand(
+	TEXT("CrustyPirate.ServerMetrics"),
+	TEXT("Logs tick time, CPU and memory of this server instance since the last report."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		UServerMetricsSubsystem* Metrics = GameInstance ? GameInstance->GetSubsystem<UServerMetricsSubsystem>() : nullptr;
+		if (Metrics)
+		{
+			Metrics->ReportMetrics();
+		}
+	}));
+
+bool UServerMetricsSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UServerMetricsSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	FParse::Value(FCommandLine::Get(), TEXT("ServerTickRate="), ServerTickRate);
+	if (ServerTickRate > 0.0f && GEngine)
+	{
+		// The engine sleeps out the rest of each frame and every tick sees the same delta time.
+		GEngine->bUseFixedFrameRate = true;
+		GEngine->FixedFrameRate = ServerTickRate;
+	}
+	IntervalStartTime = FPlatformTime::Seconds();
+	LastTickTime = IntervalStartTime;
+	// The first call only starts the CPU time interval.
+	FPlatformTime::GetCPUTime();
+}
+
+void UServerMetricsSubsystem::Tick(float DeltaTime)
+{
+	double Now = FPlatformTime::Seconds();
+	double BusyTime = FMath::Max(Now - LastTickTime - FApp::GetIdleTime(), 0.0);
+	LastTickTime = Now;
+	NumFrames++;
+	BusySeconds += BusyTime;
+	MaxBusySeconds = FMath::Max(MaxBusySeconds, BusyTime);
+	if (ServerTickRate > 0.0f && BusyTime > 1.0 / ServerTickRate)
+	{
+		NumFramesOverBudget++;
+	}
+	// The net driver caps the server at its own rate, so keep it in line with a command line override.
+	UWorld* World = GetGameInstance()->GetWorld();
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	if (NetDriver && ServerTickRate > 0.0f && NetDriver->GetNetServerMaxTickRate() != FMath::RoundToInt(ServerTickRate))
+	{
+		NetDriver->SetNetServerMaxTickRate(FMath::RoundToInt(ServerTickRate));
+	}
+	if (MetricsInterval > 0.0f && Now - IntervalStartTime >= MetricsInterval)
+	{
+		ReportMetrics();
+	}
+}
+
+TStatId UServerMetricsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UServerMetricsSubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType UServerMetricsSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+void UServerMetricsSubsystem::ReportMetrics()
+{
+	double Now = FPlatformTime::Seconds();
+	double IntervalSeconds = FMath::Max(Now - IntervalStartTime, UE_SMALL_NUMBER);
+	FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	float UsedMB = MemoryStats.UsedPhysical / (1024.0f * 1024.0f);
+	float PeakMB = MemoryStats.PeakUsedPhysical / (1024.0f * 1024.0f);
+	// Percent of one core, averaged since the previous report.
+	float CpuPercent = FPlatformTime::GetCPUTime().CPUTimePctRelative;
+	float AvgBusyMs = NumFrames > 0 ? BusySeconds * 1000.0 / NumFrames : 0.0f;
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	UEnemyCrowdSubsystem* Crowd = World ? World->GetSubsystem<UEnemyCrowdSubsystem>() : nullptr;
+	int32 NumPlayers = World ? World->GetNumPlayerControllers() : 0;
+	int32 NumEnemies = Crowd ? Crowd->Enemies.Num() : 0;
+
+	UE_LOG(LogCrustyPirate, Log, TEXT("ServerMetrics: %.1f Hz (target %.0f), busy %.2f ms avg / %.2f ms max, %d frames over budget, cpu %.1f%%, memory %.0f MB (peak %.0f MB), %d players, %d enemies"),
+		NumFrames / IntervalSeconds, ServerTickRate, AvgBusyMs, MaxBusySeconds * 1000.0, NumFramesOverBudget, CpuPercent, UsedMB, PeakMB, NumPlayers, NumEnemies);
+	if (MemoryBudgetMB > 0 && UsedMB > MemoryBudgetMB)
+	{
+		UE_LOG(LogCrustyPirate, Warning, TEXT("ServerMetrics: memory %.0f MB is over the %d MB budget"), UsedMB, MemoryBudgetMB);
+	}
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetNumberField(TEXT("processId"), FPlatformProcess::GetCurrentProcessId());
+	Json->SetNumberField(TEXT("port"), World ? World->URL.Port : 0);
+	Json->SetNumberField(TEXT("targetTickRate"), ServerTickRate);
+	Json->SetNumberField(TEXT("tickRate"), NumFrames / IntervalSeconds);
+	Json->SetNumberField(TEXT("avgBusyMs"), AvgBusyMs);
+	Json->SetNumberField(TEXT("maxBusyMs"), MaxBusySeconds * 1000.0);
+	Json->SetNumberField(TEXT("framesOverBudget"), NumFramesOverBudget);
+	Json->SetNumberField(TEXT("cpuPercent"), CpuPercent);
+	Json->SetNumberField(TEXT("usedPhysicalMB"), UsedMB);
+	Json->SetNumberField(TEXT("peakUsedPhysicalMB"), PeakMB);
+	Json->SetNumberField(TEXT("memoryBudgetMB"), MemoryBudgetMB);
+	Json->SetNumberField(TEXT("players"), NumPlayers);
+	Json->SetNumberField(TEXT("enemies"), NumEnemies);
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Json, Writer);
+	FString MetricsPath = FPaths::ProjectSavedDir() / TEXT("Metrics") / FString::Printf(TEXT("Server_%u.json"), FPlatformProcess::GetCurrentProcessId());
+	FFileHelper::SaveStringToFile(Output, *MetricsPath);
+
+	IntervalStartTime = Now;
+	NumFrames = 0;
+	NumFramesOverBudget = 0;
+	BusySeconds = 0.0;
+	MaxBusySeconds = 0.0;
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "ServerMetricsSubsystem.generated.h"
+
+/**
+ * Dedicated servers only. Locks the server to ServerTickRate (-ServerTickRate= overrides it) and every
+ * MetricsInterval seconds logs and writes Saved/Metrics/Server_<pid>.json with this instance's tick
+ * time, CPU use and memory, so a host can be packed with as many instances as its budgets allow.
+ * "CrustyPirate.ServerMetrics" logs the current values.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UServerMetricsSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	float ServerTickRate = 30.0f;
+
+	UPROPERTY(Config)
+	float MetricsInterval = 10.0f;
+
+	// Exceeding it is logged as a warning; nothing is enforced.
+	UPROPERTY(Config)
+	int32 MemoryBudgetMB = 512;
+
+	double IntervalStartTime = 0.0;
+	double LastTickTime = 0.0;
+	int32 NumFrames = 0;
+	int32 NumFramesOverBudget = 0;
+	double BusySeconds = 0.0;
+	double MaxBusySeconds = 0.0;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+
+	void ReportMetrics();
+};
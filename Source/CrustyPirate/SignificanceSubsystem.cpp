@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SignificanceSubsystem.h"
+#include "Enemy.h"
+#include "CollectableItem.h"
+#include "LevelExit.h"
+#include "PlayerCharacter.h"
+
+DECLARE_STATS_GROUP(TEXT("CrustyPirate Significance"), STATGROUP_CrustyPirateSignificance, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Update Tiers"), STAT_SignificanceUpdateTiers, STATGROUP_CrustyPirateSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Near Actors"), STAT_SignificanceNearActors, STATGROUP_CrustyPirateSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Mid Actors"), STAT_SignificanceMidActors, STATGROUP_CrustyPirateSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dormant Actors"), STAT_SignificanceDormantActors, STATGROUP_CrustyPirateSignificance);
+
+void USignificanceSubsystem::RegisterActor(AActor* Actor)
+{
+	if (!Actor || ActorIndices.Contains(Actor))	return;
+	ActorIndices.Add(Actor, Actors.Add(Actor));
+	Tiers.Add(ESignificanceTier::Near);
+	// Pooled actors come back with whatever tier they were released in.
+	ApplyTier(Actor, ESignificanceTier::Near);
+}
+
+void USignificanceSubsystem::UnregisterActor(AActor* Actor)
+{
+	int32 Index;
+	if (!ActorIndices.RemoveAndCopyValue(Actor, Index))	return;
+	Actors.RemoveAtSwap(Index);
+	Tiers.RemoveAtSwap(Index);
+	if (Actors.IsValidIndex(Index))
+	{
+		ActorIndices.Add(Actors[Index], Index);
+	}
+}
+
+void USignificanceSubsystem::Wake(AActor* Actor)
+{
+	const int32* Index = ActorIndices.Find(Actor);
+	if (Index && Tiers[*Index] != ESignificanceTier::Near)
+	{
+		Tiers[*Index] = ESignificanceTier::Near;
+		ApplyTier(Actor, ESignificanceTier::Near);
+	}
+}
+
+ESignificanceTier USignificanceSubsystem::GetTier(const AActor* Actor) const
+{
+	const int32* Index = ActorIndices.Find(Actor);
+	return Index ? Tiers[*Index] : ESignificanceTier::Near;
+}
+
+void USignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate >= UpdateInterval)
+	{
+		TimeSinceUpdate = 0.0f;
+		UpdateTiers();
+	}
+}
+
+TStatId USignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USignificanceSubsystem, STATGROUP_Tickables);
+}
+
+bool USignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void USignificanceSubsystem::UpdateTiers()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdateTiers);
+	// The server has to keep everything near any player going, not just near the first one.
+	TArray<FVector, TInlineAllocator<8>> CameraLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (APlayerCharacter* Player = Cast<APlayerCharacter>((*It)->GetPawn()))
+		{
+			CameraLocations.Add(Player->Camera->GetComponentLocation());
+		}
+	}
+	if (CameraLocations.Num() == 0)	return;
+
+	const float NearDistanceSq = NearDistance * NearDistance;
+	const float MidDistanceSq = MidDistance * MidDistance;
+	int32 TierCounts[3] = { 0, 0, 0 };
+	for (int32 i = 0; i < Actors.Num(); i++)
+	{
+		AActor* Actor = Actors[i];
+		const FVector Location = Actor->GetActorLocation();
+		float DistSq = UE_BIG_NUMBER;
+		for (const FVector& CameraLocation : CameraLocations)
+		{
+			DistSq = FMath::Min(DistSq, FMath::Square(Location.X - CameraLocation.X) + FMath::Square(Location.Z - CameraLocation.Z));
+		}
+		ESignificanceTier Tier = ESignificanceTier::Dormant;
+		if (DistSq <= NearDistanceSq)
+		{
+			Tier = ESignificanceTier::Near;
+		}
+		else if (DistSq <= MidDistanceSq)
+		{
+			Tier = ESignificanceTier::Mid;
+		}
+
+		AEnemy* Enemy = Cast<AEnemy>(Actor);
+		if (Enemy && Enemy->FollowTarget)
+		{
+			Tier = ESignificanceTier::Near;
+		}
+
+		if (Tiers[i] != Tier)
+		{
+			Tiers[i] = Tier;
+			ApplyTier(Actor, Tier);
+		}
+		TierCounts[(int32)Tier]++;
+	}
+	SET_DWORD_STAT(STAT_SignificanceNearActors, TierCounts[(int32)ESignificanceTier::Near]);
+	SET_DWORD_STAT(STAT_SignificanceMidActors, TierCounts[(int32)ESignificanceTier::Mid]);
+	SET_DWORD_STAT(STAT_SignificanceDormantActors, TierCounts[(int32)ESignificanceTier::Dormant]);
+}
+
+void USignificanceSubsystem::ApplyTier(AActor* Actor, ESignificanceTier Tier)
+{
+	const float TickInterval = Tier == ESignificanceTier::Mid ? MidTickInterval : 0.0f;
+	if (AEnemy* Enemy = Cast<AEnemy>(Actor))
+	{
+		Enemy->SetSignificanceTier(Tier, TickInterval);
+	}
+	else if (ACollectableItem* Item = Cast<ACollectableItem>(Actor))
+	{
+		Item->SetSignificanceTier(Tier, TickInterval);
+	}
+	else if (ALevelExit* LevelExit = Cast<ALevelExit>(Actor))
+	{
+		LevelExit->SetSignificanceTier(Tier, TickInterval);
+	}
+}
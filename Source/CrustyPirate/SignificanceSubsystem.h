@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SignificanceSubsystem.generated.h"
+
+UENUM(BlueprintType)
+enum class ESignificanceTier : uint8
+{
+	Near,
+	Mid,
+	Dormant
+};
+
+/**
+ * Buckets enemies, collectables and level exits into tiers by their distance to the player camera
+ * and throttles their component ticks accordingly.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API USignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	float NearDistance = 1500.0f;
+
+	UPROPERTY(Config)
+	float MidDistance = 4000.0f;
+
+	UPROPERTY(Config)
+	float MidTickInterval = 0.1f;
+
+	UPROPERTY(Config)
+	float UpdateInterval = 0.25f;
+
+	UPROPERTY()
+	TArray<AActor*> Actors;
+
+	TArray<ESignificanceTier> Tiers;
+	TMap<AActor*, int32> ActorIndices;
+	float TimeSinceUpdate = 0.0f;
+
+	void RegisterActor(AActor* Actor);
+	void UnregisterActor(AActor* Actor);
+	void Wake(AActor* Actor);
+	ESignificanceTier GetTier(const AActor* Actor) const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void UpdateTiers();
+	void ApplyTier(AActor* Actor, ESignificanceTier Tier);
+};
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SignificanceSubsystem.h"
+#include "Enemy.h"
+#include "PlayerCharacter.h"
+#include "EnemyAnimationSubsystem.h"
+#include "CrustyPirateTestWorld.h"
+#include "PaperZDAnimationComponent.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSignificanceTiersTest, "CrustyPirate.Significance.Tiers",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSignificanceTiersTest::RunTest(const FString& Parameters)
+{
+	FCrustyPirateTestWorld TestWorld;
+	USignificanceSubsystem* Significance = TestWorld.World->GetSubsystem<USignificanceSubsystem>();
+	UEnemyAnimationSubsystem* Animation = TestWorld.World->GetSubsystem<UEnemyAnimationSubsystem>();
+	APlayerCharacter* Player = TestWorld.SpawnPlayer(FVector::ZeroVector);
+	if (!TestNotNull(TEXT("Significance"), Significance) || !TestNotNull(TEXT("Player"), Player))
+	{
+		return false;
+	}
+
+	// Distances are measured from the camera on the X/Z plane.
+	const FVector CameraLocation = Player->Camera->GetComponentLocation();
+	const float Distances[] = { Significance->NearDistance * 0.5f, (Significance->NearDistance + Significance->MidDistance) * 0.5f, Significance->MidDistance * 2.0f };
+	const ESignificanceTier ExpectedTiers[] = { ESignificanceTier::Near, ESignificanceTier::Mid, ESignificanceTier::Dormant };
+	AEnemy* Enemies[3];
+	for (int32 i = 0; i < 3; i++)
+	{
+		Enemies[i] = TestWorld.SpawnEnemy(FVector(CameraLocation.X + Distances[i], 0.0f, CameraLocation.Z));
+		if (!TestNotNull(TEXT("Enemy"), Enemies[i]))	return false;
+		// An enemy chasing the player stays Near wherever it is.
+		Enemies[i]->FollowTarget = NULL;
+	}
+	Significance->Tick(Significance->UpdateInterval);
+
+	// Mid tier sprites are advanced by the animation batch instead of their own tick.
+	const bool MidSpriteTicks = !Animation || !Animation->UseParallelAnimation;
+	for (int32 i = 0; i < 3; i++)
+	{
+		AEnemy* Enemy = Enemies[i];
+		ESignificanceTier Tier = ExpectedTiers[i];
+		const FString Context = FString::Printf(TEXT("Enemy at %.0f"), Distances[i]);
+		TestEqual(Context + TEXT(" tier"), (uint8)Significance->GetTier(Enemy), (uint8)Tier);
+		TestEqual(Context + TEXT(" enemy tier"), (uint8)Enemy->SignificanceTier, (uint8)Tier);
+
+		bool SpriteTicks = Tier == ESignificanceTier::Near || (Tier == ESignificanceTier::Mid && MidSpriteTicks);
+		TestEqual(Context + TEXT(" sprite tick"), Enemy->GetSprite()->IsComponentTickEnabled(), SpriteTicks);
+		if (UPaperZDAnimationComponent* AnimationComponent = Enemy->GetAnimationComponent())
+		{
+			TestEqual(Context + TEXT(" anim tick"), AnimationComponent->IsComponentTickEnabled(), Tier != ESignificanceTier::Dormant);
+			float ExpectedInterval = Tier == ESignificanceTier::Mid ? Significance->MidTickInterval : 0.0f;
+			TestEqual(Context + TEXT(" anim tick interval"), AnimationComponent->GetComponentTickInterval(), ExpectedInterval);
+		}
+		if (Animation && Animation->UseParallelAnimation)
+		{
+			bool Batched = Animation->Enemies.IsValidIndex(Enemy->AnimIndex) && Animation->Enemies[Enemy->AnimIndex] == Enemy
+				&& Animation->IsBatched[Enemy->AnimIndex];
+			TestEqual(Context + TEXT(" batched"), Batched, Tier == ESignificanceTier::Mid);
+		}
+	}
+
+	// Coming back into range wakes the dormant enemy up again.
+	AEnemy* Dormant = Enemies[2];
+	Dormant->SetActorLocation(FVector(CameraLocation.X + Distances[0], 0.0f, CameraLocation.Z));
+	Dormant->FollowTarget = NULL;
+	Significance->Tick(Significance->UpdateInterval);
+	TestEqual(TEXT("Woken tier"), (uint8)Significance->GetTier(Dormant), (uint8)ESignificanceTier::Near);
+	TestTrue(TEXT("Woken sprite tick"), Dormant->GetSprite()->IsComponentTickEnabled());
+	if (UPaperZDAnimationComponent* AnimationComponent = Dormant->GetAnimationComponent())
+	{
+		TestTrue(TEXT("Woken anim tick"), AnimationComponent->IsComponentTickEnabled());
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StatusEffectSubsystem.h"
+#include "StatusEffectTarget.h"
+#include "CrustyPiratePerf.h"
+
+void UStatusEffectSubsystem::Schedule(UObject* Owner, EStatusEffect Effect, float DurationInSeconds)
+{
+	if (!Owner)	return;
+	uint32 OwnerId = Owner->GetUniqueID();
+	Owners.FindOrAdd(OwnerId) = Owner;
+	CRUSTYPIRATE_INC_COUNTER(TimersSet);
+	Wheel.Schedule(FStatusEffectKey{ OwnerId, Effect }, DurationInSeconds);
+}
+
+void UStatusEffectSubsystem::Cancel(UObject* Owner, EStatusEffect Effect)
+{
+	if (!Owner)	return;
+	Wheel.Cancel(FStatusEffectKey{ Owner->GetUniqueID(), Effect });
+}
+
+void UStatusEffectSubsystem::CancelAll(UObject* Owner)
+{
+	if (!Owner)	return;
+	Wheel.CancelAll(Owner->GetUniqueID());
+	Owners.Remove(Owner->GetUniqueID());
+}
+
+bool UStatusEffectSubsystem::IsActive(const UObject* Owner, EStatusEffect Effect) const
+{
+	return Owner && Wheel.IsActive(FStatusEffectKey{ Owner->GetUniqueID(), Effect });
+}
+
+float UStatusEffectSubsystem::GetRemainingTime(const UObject* Owner, EStatusEffect Effect) const
+{
+	return Owner ? Wheel.GetRemainingTime(FStatusEffectKey{ Owner->GetUniqueID(), Effect }) : 0.0f;
+}
+
+void UStatusEffectSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Wheel.TicksPerSecond = TicksPerSecond;
+}
+
+void UStatusEffectSubsystem::Tick(float DeltaTime)
+{
+	Expired.Reset();
+	Wheel.Advance(DeltaTime, Expired);
+	for (const FStatusEffectKey& Key : Expired)
+	{
+		TWeakObjectPtr<UObject>* Owner = Owners.Find(Key.OwnerId);
+		if (!Owner)	continue;
+		if (IStatusEffectTarget* Target = Cast<IStatusEffectTarget>(Owner->Get()))
+		{
+			Target->OnStatusEffectExpired(Key.Effect);
+		}
+	}
+}
+
+TStatId UStatusEffectSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStatusEffectSubsystem, STATGROUP_Tickables);
+}
+
+bool UStatusEffectSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StatusEffectWheel.h"
+#include "StatusEffectSubsystem.generated.h"
+
+/**
+ * Schedules gameplay status effects (stun, attack cooldown, invulnerability, restart delay, corpse time)
+ * on a timing wheel instead of one FTimerManager timer per actor. Effects are addressed by owner and
+ * effect type; expiries are collected for the whole frame and then dispatched to IStatusEffectTarget.
+ * Pooled and destroyed actors are cleared with CancelAll.
+ */
+UCLASS(Config = Game)
+class CRUSTYPIRATE_API UStatusEffectSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	float TicksPerSecond = 120.0f;
+
+	FStatusEffectWheel Wheel;
+	TMap<uint32, TWeakObjectPtr<UObject>> Owners;
+	TArray<FStatusEffectKey> Expired;
+
+	void Schedule(UObject* Owner, EStatusEffect Effect, float DurationInSeconds);
+	void Cancel(UObject* Owner, EStatusEffect Effect);
+	void CancelAll(UObject* Owner);
+	bool IsActive(const UObject* Owner, EStatusEffect Effect) const;
+	float GetRemainingTime(const UObject* Owner, EStatusEffect Effect) const;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
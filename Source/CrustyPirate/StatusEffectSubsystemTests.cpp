@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StatusEffectSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "TimerManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+struct FStatusEffectBench
+{
+	int32 NumEffects = 0;
+	int32 Frame = 0;
+	TArray<float> Durations;
+	FStatusEffectWheel Wheel;
+	TArray<FStatusEffectKey> Expired;
+	int32 NumWheelExpired = 0;
+	FTimerManager TimerManager;
+	TArray<FTimerHandle> Handles;
+	FTimerDelegate Delegate;
+	int32 NumTimersFired = 0;
+	double WheelSeconds = 0.0;
+	double TimerManagerSeconds = 0.0;
+};
+
+// FTimerManager only ticks once per engine frame, so both sides step one simulated 60 Hz frame per
+// engine frame and only the work inside the step is timed.
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FStatusEffectBenchFrames, TSharedRef<FStatusEffectBench>, Bench, FAutomationTestBase*, Test);
+
+bool FStatusEffectBenchFrames::Update()
+{
+	const int32 NumFrames = 300;
+	const float DeltaTime = 1.0f / 60.0f;
+
+	// Every frame a tenth of the effects is restarted, like stuns on combatants that keep getting hit.
+	double FrameStart = FPlatformTime::Seconds();
+	for (int32 i = Bench->Frame % 10; i < Bench->NumEffects; i += 10)
+	{
+		Bench->Wheel.Schedule(FStatusEffectKey{ (uint32)i, EStatusEffect::Stun }, Bench->Durations[i]);
+	}
+	Bench->Expired.Reset();
+	Bench->Wheel.Advance(DeltaTime, Bench->Expired);
+	Bench->WheelSeconds += FPlatformTime::Seconds() - FrameStart;
+	Bench->NumWheelExpired += Bench->Expired.Num();
+
+	FrameStart = FPlatformTime::Seconds();
+	for (int32 i = Bench->Frame % 10; i < Bench->NumEffects; i += 10)
+	{
+		if (Bench->TimerManager.IsTimerActive(Bench->Handles[i]))
+		{
+			Bench->TimerManager.ClearTimer(Bench->Handles[i]);
+		}
+		Bench->TimerManager.SetTimer(Bench->Handles[i], Bench->Delegate, Bench->Durations[i], false);
+	}
+	Bench->TimerManager.Tick(DeltaTime);
+	Bench->TimerManagerSeconds += FPlatformTime::Seconds() - FrameStart;
+
+	if (++Bench->Frame < NumFrames)	return false;
+	Test->AddInfo(FString::Printf(TEXT("%d concurrent effects over %d frames: timing wheel %.2f ms (%d expired), FTimerManager %.2f ms (%d fired)"),
+		Bench->NumEffects, NumFrames, Bench->WheelSeconds * 1000.0, Bench->NumWheelExpired, Bench->TimerManagerSeconds * 1000.0, Bench->NumTimersFired));
+	Test->TestTrue(TEXT("Effects expired on the wheel"), Bench->NumWheelExpired > 0);
+	Test->TestTrue(TEXT("Timers fired"), Bench->NumTimersFired > 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStatusEffectPerfTest, "CrustyPirate.Perf.StatusEffects",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FStatusEffectPerfTest::RunTest(const FString& Parameters)
+{
+	const int32 NumEffects = 10000;
+	TSharedRef<FStatusEffectBench> Bench = MakeShared<FStatusEffectBench>();
+	Bench->NumEffects = NumEffects;
+	Bench->Delegate = FTimerDelegate::CreateLambda([Counter = &Bench->NumTimersFired]() { (*Counter)++; });
+	Bench->Handles.SetNum(NumEffects);
+	FRandomStream Random(1234);
+	for (int32 i = 0; i < NumEffects; i++)
+	{
+		Bench->Durations.Add(Random.FRandRange(0.1f, 3.0f));
+	}
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumEffects; i++)
+	{
+		Bench->Wheel.Schedule(FStatusEffectKey{ (uint32)i, EStatusEffect::Stun }, Bench->Durations[i]);
+	}
+	Bench->WheelSeconds += FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumEffects; i++)
+	{
+		Bench->TimerManager.SetTimer(Bench->Handles[i], Bench->Delegate, Bench->Durations[i], false);
+	}
+	Bench->TimerManagerSeconds += FPlatformTime::Seconds() - StartTime;
+	TestEqual(TEXT("Every effect is running"), Bench->Wheel.GetNumActive(), NumEffects);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FStatusEffectBenchFrames(Bench, this));
+	return true;
+}
+
+#endif
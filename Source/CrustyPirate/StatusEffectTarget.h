@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "StatusEffectWheel.h"
+#include "StatusEffectTarget.generated.h"
+
+UINTERFACE(MinimalAPI)
+class UStatusEffectTarget : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Receives the expiry callbacks of effects scheduled through UStatusEffectSubsystem.
+ */
+class CRUSTYPIRATE_API IStatusEffectTarget
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnStatusEffectExpired(EStatusEffect Effect) {}
+};
@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StatusEffectWheel.h"
+
+FStatusEffectWheel::FStatusEffectWheel()
+{
+	BucketHeads.Init(INDEX_NONE, NumSlots * 2);
+}
+
+void FStatusEffectWheel::Schedule(const FStatusEffectKey& Key, float DurationInSeconds)
+{
+	int32 NodeIndex = INDEX_NONE;
+	if (int32* Existing = NodesByKey.Find(MakeKey(Key)))
+	{
+		NodeIndex = *Existing;
+		Unlink(NodeIndex);
+	}
+	else
+	{
+		NodeIndex = FreeNodes.Num() > 0 ? FreeNodes.Pop(EAllowShrinking::No) : Nodes.AddDefaulted();
+		NodesByKey.Add(MakeKey(Key), NodeIndex);
+	}
+	FNode& Node = Nodes[NodeIndex];
+	Node.Key = Key;
+	// Never expire on the tick the effect was scheduled on.
+	Node.ExpireTick = CurrentTick + FMath::Max<uint64>(1, (uint64)FMath::CeilToDouble(DurationInSeconds * TicksPerSecond - PendingTicks));
+	Insert(NodeIndex);
+}
+
+bool FStatusEffectWheel::Cancel(const FStatusEffectKey& Key)
+{
+	int32 NodeIndex = INDEX_NONE;
+	if (!NodesByKey.RemoveAndCopyValue(MakeKey(Key), NodeIndex))	return false;
+	Unlink(NodeIndex);
+	FreeNode(NodeIndex);
+	return true;
+}
+
+void FStatusEffectWheel::CancelAll(uint32 OwnerId)
+{
+	for (uint8 Effect = 0; Effect < (uint8)EStatusEffect::Count; Effect++)
+	{
+		Cancel(FStatusEffectKey{ OwnerId, (EStatusEffect)Effect });
+	}
+}
+
+bool FStatusEffectWheel::IsActive(const FStatusEffectKey& Key) const
+{
+	return NodesByKey.Contains(MakeKey(Key));
+}
+
+float FStatusEffectWheel::GetRemainingTime(const FStatusEffectKey& Key) const
+{
+	const int32* NodeIndex = NodesByKey.Find(MakeKey(Key));
+	if (!NodeIndex)	return 0.0f;
+	return ((double)(Nodes[*NodeIndex].ExpireTick - CurrentTick) - PendingTicks) / TicksPerSecond;
+}
+
+void FStatusEffectWheel::Reset()
+{
+	Nodes.Reset();
+	FreeNodes.Reset();
+	NodesByKey.Reset();
+	BucketHeads.Init(INDEX_NONE, NumSlots * 2);
+	PendingTicks = 0.0;
+}
+
+void FStatusEffectWheel::Advance(float DeltaTime, TArray<FStatusEffectKey>& OutExpired)
+{
+	PendingTicks += DeltaTime * TicksPerSecond;
+	// Tolerate float error so a fixed step that is a whole number of ticks never drifts by one.
+	while (PendingTicks >= 1.0 - UE_KINDA_SMALL_NUMBER)
+	{
+		PendingTicks = FMath::Max(PendingTicks - 1.0, 0.0);
+		TickOnce(OutExpired);
+	}
+}
+
+void FStatusEffectWheel::Insert(int32 NodeIndex)
+{
+	FNode& Node = Nodes[NodeIndex];
+	uint64 Delta = Node.ExpireTick - CurrentTick;
+	int32 Bucket = INDEX_NONE;
+	if (Delta < NumSlots)
+	{
+		Bucket = Node.ExpireTick & SlotMask;
+	}
+	else
+	{
+		// Anything beyond the outer wheel is parked in its slot and re-inserted on every cascade until due.
+		Bucket = NumSlots + ((Node.ExpireTick >> SlotBits) & SlotMask);
+		if (Delta >= (uint64)NumSlots * NumSlots)
+		{
+			Bucket = NumSlots + (((CurrentTick >> SlotBits) + NumSlots - 1) & SlotMask);
+		}
+	}
+	Node.Bucket = Bucket;
+	Node.Prev = INDEX_NONE;
+	Node.Next = BucketHeads[Bucket];
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = NodeIndex;
+	}
+	BucketHeads[Bucket] = NodeIndex;
+}
+
+void FStatusEffectWheel::Unlink(int32 NodeIndex)
+{
+	FNode& Node = Nodes[NodeIndex];
+	if (Node.Bucket == INDEX_NONE)	return;
+	if (Node.Prev != INDEX_NONE)
+	{
+		Nodes[Node.Prev].Next = Node.Next;
+	}
+	else
+	{
+		BucketHeads[Node.Bucket] = Node.Next;
+	}
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Node.Prev;
+	}
+	Node.Prev = INDEX_NONE;
+	Node.Next = INDEX_NONE;
+	Node.Bucket = INDEX_NONE;
+}
+
+void FStatusEffectWheel::FreeNode(int32 NodeIndex)
+{
+	FreeNodes.Add(NodeIndex);
+}
+
+int32 FStatusEffectWheel::DetachBucket(int32 Bucket)
+{
+	int32 Head = BucketHeads[Bucket];
+	BucketHeads[Bucket] = INDEX_NONE;
+	return Head;
+}
+
+void FStatusEffectWheel::TickOnce(TArray<FStatusEffectKey>& OutExpired)
+{
+	CurrentTick++;
+
+	if ((CurrentTick & SlotMask) == 0)
+	{
+		int32 NodeIndex = DetachBucket(NumSlots + ((CurrentTick >> SlotBits) & SlotMask));
+		while (NodeIndex != INDEX_NONE)
+		{
+			int32 Next = Nodes[NodeIndex].Next;
+			Nodes[NodeIndex].Bucket = INDEX_NONE;
+			Insert(NodeIndex);
+			NodeIndex = Next;
+		}
+	}
+
+	int32 NodeIndex = DetachBucket(CurrentTick & SlotMask);
+	while (NodeIndex != INDEX_NONE)
+	{
+		FNode& Node = Nodes[NodeIndex];
+		int32 Next = Node.Next;
+		Node.Bucket = INDEX_NONE;
+		if (Node.ExpireTick <= CurrentTick)
+		{
+			OutExpired.Add(Node.Key);
+			NodesByKey.Remove(MakeKey(Node.Key));
+			FreeNode(NodeIndex);
+		}
+		else
+		{
+			Insert(NodeIndex);
+		}
+		NodeIndex = Next;
+	}
+}
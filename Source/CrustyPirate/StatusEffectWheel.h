@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EStatusEffect : uint8
+{
+	Stun,
+	AttackCooldown,
+	Invulnerability,
+	RestartDelay,
+	Corpse,
+	PredictedHitbox,
+	Count
+};
+
+struct FStatusEffectKey
+{
+	uint32 OwnerId = 0;
+	EStatusEffect Effect = EStatusEffect::Stun;
+};
+
+/**
+ * Two-level hierarchical timing wheel. Time advances in fixed ticks; the inner wheel holds effects due
+ * within the next 256 ticks, the outer wheel everything up to 65536 ticks out and is cascaded into the
+ * inner wheel every 256 ticks. Effects live in intrusive lists inside a node pool and are found by
+ * (owner, effect), so scheduling and cancelling are O(1) and need no handles.
+ * An owner has at most one running instance of each effect; scheduling it again restarts it.
+ */
+class CRUSTYPIRATE_API FStatusEffectWheel
+{
+public:
+	static const int32 SlotBits = 8;
+	static const int32 NumSlots = 1 << SlotBits;
+	static const int32 SlotMask = NumSlots - 1;
+
+	struct FNode
+	{
+		uint64 ExpireTick = 0;
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+		int32 Bucket = INDEX_NONE;
+		FStatusEffectKey Key;
+	};
+
+	float TicksPerSecond = 120.0f;
+	uint64 CurrentTick = 0;
+	double PendingTicks = 0.0;
+
+	TArray<FNode> Nodes;
+	TArray<int32> FreeNodes;
+	TArray<int32> BucketHeads;
+	TMap<uint64, int32> NodesByKey;
+
+	FStatusEffectWheel();
+
+	void Schedule(const FStatusEffectKey& Key, float DurationInSeconds);
+	bool Cancel(const FStatusEffectKey& Key);
+	void CancelAll(uint32 OwnerId);
+	bool IsActive(const FStatusEffectKey& Key) const;
+	float GetRemainingTime(const FStatusEffectKey& Key) const;
+	int32 GetNumActive() const { return NodesByKey.Num(); }
+	void Reset();
+
+	// Advances the wheel and appends everything that expired, in expiry order.
+	void Advance(float DeltaTime, TArray<FStatusEffectKey>& OutExpired);
+
+protected:
+	static uint64 MakeKey(const FStatusEffectKey& Key) { return ((uint64)Key.OwnerId << 8) | (uint8)Key.Effect; }
+
+	void Insert(int32 NodeIndex);
+	void Unlink(int32 NodeIndex);
+	void FreeNode(int32 NodeIndex);
+	int32 DetachBucket(int32 Bucket);
+	void TickOnce(TArray<FStatusEffectKey>& OutExpired);
+};
@@ -0,0 +1,17 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class CrustyPirateServerTarget : TargetRules
+{
+	public CrustyPirateServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.V5;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_5;
+		ExtraModuleNames.Add("CrustyPirate");
+		// Server instances are packed onto shared hosts and read through their logs.
+		bUseLoggingInShipping = true;
+	}
+}